@@ -2,21 +2,32 @@
 // BoydEngine - Standard vertex shader - Forward rendering stage
 precision mediump float;
 
-uniform mat4 u_ModelViewProjection;
+uniform mat4 u_ViewProjection;
+uniform bool u_OctahedralNormals; // Are normals octahedral-encoded (in `vi_Normal.xy`)?
 
 layout(location = 0) in vec3 vi_Position;
 layout(location = 1) in vec3 vi_Normal;
 layout(location = 2) in vec4 vi_Tint;
 layout(location = 3) in vec2 vi_TexCoord;
+layout(location = 4) in mat4 vi_Model; // (Per-instance; locations 4 to 7)
 
 out vec3 vo_Normal;
 out vec4 vo_Tint;
 out vec2 vo_TexCoord;
 
+vec3 DecodeOctahedral(vec2 oct)
+{
+    vec3 normal = vec3(oct, 1.0 - abs(oct.x) - abs(oct.y));
+    float t = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -t : t;
+    normal.y += normal.y >= 0.0 ? -t : t;
+    return normalize(normal);
+}
+
 void main()
 {
-    vo_Normal = vi_Normal;
+    vo_Normal = u_OctahedralNormals ? DecodeOctahedral(vi_Normal.xy) : vi_Normal;
     vo_Tint = vi_Tint;
     vo_TexCoord = vi_TexCoord;
-    gl_Position = u_ModelViewProjection * vec4(vi_Position, 1.0);
+    gl_Position = u_ViewProjection * vi_Model * vec4(vi_Position, 1.0);
 }
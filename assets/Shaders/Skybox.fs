@@ -0,0 +1,16 @@
+#version 300 es
+// BoydEngine - Skybox fragment shader - Skybox rendering stage
+precision mediump float;
+
+uniform samplerCube u_EnvironmentMap;
+
+in vec3 vo_Direction;
+
+out vec4 fo_FragColor;
+
+void main()
+{
+    vec3 radiance = texture(u_EnvironmentMap, vo_Direction).rgb;
+    // The environment is linear, while the forward stage outputs its (sRGB) texture colors as they are
+    fo_FragColor = vec4(pow(radiance, vec3(1.0 / 2.2)), 1.0);
+}
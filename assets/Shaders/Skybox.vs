@@ -0,0 +1,16 @@
+#version 300 es
+// BoydEngine - Skybox vertex shader - Skybox rendering stage
+precision highp float; // (Unprojecting through an inverse matrix needs the precision)
+
+uniform mat4 u_InvViewProjection; // Inverse of projection * view - with no translation in the view!
+
+out vec3 vo_Direction;
+
+void main()
+{
+    // A triangle that covers the whole screen, on the far plane (z = w), from vertex ids 0..2
+    vec2 ndc = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+    vec4 world = u_InvViewProjection * vec4(ndc, 0.0, 1.0);
+    vo_Direction = world.xyz / world.w; // (The camera is at the origin, so this is the view ray)
+    gl_Position = vec4(ndc, 1.0, 1.0);
+}
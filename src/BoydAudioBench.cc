@@ -0,0 +1,92 @@
+// BoydAudioBench: measures how fast the Audio module's software mixer (see Modules/Audio/Mixer.hh) mixes voices.
+//
+// Usage: BoydAudioBench [<voices> [<seconds>]]
+//
+// Mixes `voices` clips at once (BOYD_AUDIO_VOICES by default) for `seconds` of audio (10 by default), a 60 Hz frame's
+// worth at a time as the Audio module does, and prints how many voices it mixed (for one frame) per millisecond of CPU
+// time - and so how many voices it could mix in real time.
+// Half of the clips are mono, at a rate other than the mixer's (so resampled and panned, at different distances);
+// the other half are stereo, at the mixer's rate.
+
+#include "BoydEngine.hh"
+#include "Modules/Audio/Mixer.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <vector>
+
+using namespace boyd;
+
+/// Returns a one-second sine wave clip.
+static Wave MakeSine(unsigned channels, unsigned sampleRate, float frequency)
+{
+    Wave wave;
+    wave.sampleCount = sampleRate;
+    wave.sampleRate = sampleRate;
+    wave.sampleSize = 16;
+    wave.channels = channels;
+    wave.dataSize = wave.PcmSize();
+    wave.data = std::shared_ptr<uint8_t>(new uint8_t[wave.dataSize], std::default_delete<uint8_t[]>());
+
+    auto *samples = reinterpret_cast<int16_t *>(wave.data.get());
+    for(unsigned i = 0; i < wave.sampleCount; i++)
+    {
+        const auto sample = int16_t(std::sin(6.2831853f * frequency * float(i) / float(sampleRate)) * 16384.0f);
+        for(unsigned channel = 0; channel < channels; channel++)
+        {
+            samples[i * channels + channel] = sample;
+        }
+    }
+    return wave;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc > 3)
+    {
+        fprintf(stderr, "Usage: %s [<voices> [<seconds>]]\n", argv[0]);
+        return 1;
+    }
+    const unsigned nVoices = (argc > 1) ? unsigned(std::atoi(argv[1])) : unsigned(BOYD_AUDIO_VOICES);
+    const float seconds = (argc > 2) ? float(std::atof(argv[2])) : 10.0f;
+    if(nVoices == 0 || seconds <= 0.0f)
+    {
+        fprintf(stderr, "Need at least one voice, for some time\n");
+        return 1;
+    }
+
+    const unsigned sampleRate = BOYD_AUDIO_MIXER_RATE;
+    audio::Mixer mixer{nVoices, std::make_unique<audio::NullSink>(sampleRate)};
+    const Wave mono = MakeSine(1, 44100, 440.0f), stereo = MakeSine(2, sampleRate, 220.0f);
+
+    std::vector<std::shared_ptr<void>> voices;
+    for(unsigned i = 0; i < nVoices; i++)
+    {
+        const bool isMono = (i % 2 == 0);
+        const glm::vec3 position{std::cos(float(i)) * float(i), 0.0f, std::sin(float(i)) * float(i)};
+        const audio::Backend::Clip clip{isMono ? mono : stereo, isMono ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16,
+                                        0.0f, true, false, true, position};
+        voices.push_back(mixer.Play(clip));
+    }
+
+    // Mix a frame's worth of audio at a time, like the Audio module does
+    const size_t framesPerUpdate = sampleRate / 60, nUpdates = size_t(seconds * 60.0f);
+    std::vector<float> output(framesPerUpdate * 2);
+    // (CPU time of the process, not wall-clock time: not skewed by the bench being scheduled out)
+    const std::clock_t start = std::clock();
+    for(size_t i = 0; i < nUpdates; i++)
+    {
+        mixer.Mix(output.data(), framesPerUpdate);
+    }
+    const float elapsedMs = float(std::clock() - start) * 1000.0f / float(CLOCKS_PER_SEC);
+
+    const float voicesPerMs = float(nVoices) * float(nUpdates) / elapsedMs;
+    printf("Mixed %u voices for %zu updates (%.1f s of audio) in %.1f ms of CPU time: %.1f voices per ms, "
+           "enough for %.0f voices in real time\n",
+           nVoices, nUpdates, seconds, elapsedMs, voicesPerMs, voicesPerMs * 1000.0f / 60.0f);
+    return 0;
+}
@@ -0,0 +1,357 @@
+// BoydCooker: converts source assets (GLTF, images, WAV...) to engine-native cooked files.
+// See Modules/AssetLoader/CookedFormat.hh for the format.
+//
+// Usage: BoydCooker <source assets dir> <cooked assets dir> [<archive>]
+//
+// The source directory tree is mirrored to the cooked one, keeping all file names as they are: the loaders tell
+// cooked files apart by their magic number, so the same asset paths work with either. Files that can't be cooked are
+// copied verbatim; files whose cooked version is already up to date are skipped.
+// If given, all cooked files are then packed to `archive` (see Core/Archive.hh), with paths that start with the name
+// of the cooked assets dir - i.e. "assets/...", as the engine requests them.
+
+#include "Core/Archive.hh"
+#include "Debug/Log.hh"
+
+#include "Components/ComponentLoadRequest.hh"
+#include "Modules/AssetLoader/Loaders/AllLoaders.hh"
+
+#include "Modules/AssetLoader/CookedFormat.hh"
+#include "Modules/AssetLoader/Loaders/AudioClip.hh"
+#include "Modules/AssetLoader/Loaders/Gltf.hh" // (Also has the stb_image implementation)
+#include "Modules/Gfx/VertexPacking.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+using namespace boyd;
+
+/// Writes `bytes` to `path`, creating its parent directories. Returns false on error.
+static bool WriteFile(const fs::path &path, const std::vector<uint8_t> &bytes)
+{
+    std::error_code err;
+    fs::create_directories(path.parent_path(), err);
+    std::ofstream outfile{path, std::ios::binary | std::ios::trunc};
+    outfile.write(reinterpret_cast<const char *>(bytes.data()), std::streamsize(bytes.size()));
+    return bool(outfile);
+}
+
+/// Cooks a .glb to a `cooked::Model`.
+static bool CookModel(const fs::path &inPath, const fs::path &outPath)
+{
+    // Load it exactly like the engine would (including mesh optimizations, if enabled)...
+    auto loaded = Loader<comp::Gltf>::Load(inPath.string());
+    const auto *model = dynamic_cast<const LoadedGltfModel *>(loaded.get());
+    if(!model)
+    {
+        return false;
+    }
+
+    // ... then store each distinct mesh/texture/material once (drawables that share them share their data)
+    cooked::Writer writer{cooked::AssetType::Model};
+    const uint64_t modelOffset = writer.Append(cooked::Model{});
+
+    std::vector<cooked::Mesh> meshes;
+    std::vector<cooked::Texture> textures;
+    std::vector<cooked::Material> materials;
+    std::vector<cooked::Drawable> drawables;
+    std::unordered_map<const comp::Mesh::Data *, uint32_t> meshIndices;
+    std::unordered_map<const comp::Texture::Data *, uint32_t> textureIndices;
+    std::unordered_map<int32_t, uint32_t> materialIndices; ///< Diffuse map -> material
+
+    for(const auto &drawable : model->drawables)
+    {
+        const comp::Mesh::Data *meshData = drawable.mesh.data.Get();
+        auto meshIt = meshIndices.find(meshData);
+        if(meshIt == meshIndices.end())
+        {
+            meshes.push_back(writer.AppendMesh(*meshData));
+            meshIt = meshIndices.emplace(meshData, uint32_t(meshes.size() - 1)).first;
+        }
+
+        int32_t diffuseMap = -1;
+        const auto &parameters = drawable.material.data->parameters;
+        auto paramIt = parameters.find("DiffuseMap");
+        const auto *texture = paramIt != parameters.end()
+                                  ? std::get_if<comp::Texture>(&paramIt->second)
+                                  : nullptr;
+        if(texture)
+        {
+            const comp::Texture::Data *textureData = texture->data.Get();
+            auto textureIt = textureIndices.find(textureData);
+            if(textureIt == textureIndices.end())
+            {
+                textures.push_back(writer.AppendTexture(*textureData));
+                textureIt = textureIndices.emplace(textureData, uint32_t(textures.size() - 1)).first;
+            }
+            diffuseMap = int32_t(textureIt->second);
+        }
+        auto materialIt = materialIndices.find(diffuseMap);
+        if(materialIt == materialIndices.end())
+        {
+            materials.push_back({diffuseMap, 0});
+            materialIt = materialIndices.emplace(diffuseMap, uint32_t(materials.size() - 1)).first;
+        }
+
+        cooked::Drawable cookedDrawable{};
+        std::memcpy(cookedDrawable.transform, &drawable.transform, sizeof(cookedDrawable.transform));
+        cookedDrawable.mesh = meshIt->second;
+        cookedDrawable.material = materialIt->second;
+        drawables.push_back(cookedDrawable);
+    }
+
+    cooked::Model cookedModel{};
+    cookedModel.nMeshes = uint32_t(meshes.size());
+    cookedModel.nTextures = uint32_t(textures.size());
+    cookedModel.nMaterials = uint32_t(materials.size());
+    cookedModel.nDrawables = uint32_t(drawables.size());
+    cookedModel.meshesOffset = writer.Append(meshes.data(), meshes.size());
+    cookedModel.texturesOffset = writer.Append(textures.data(), textures.size());
+    cookedModel.materialsOffset = writer.Append(materials.data(), materials.size());
+    cookedModel.drawablesOffset = writer.Append(drawables.data(), drawables.size());
+    writer.Patch(modelOffset, cookedModel);
+
+    BOYD_LOG(Info, "{}: {} meshes, {} textures, {} materials, {} drawables", inPath.string(), meshes.size(),
+             textures.size(), materials.size(), drawables.size());
+    return WriteFile(outPath, writer.Finish());
+}
+
+/// Cooks an image to a `cooked::Texture`. HDR images are stored as half floats.
+static bool CookTexture(const fs::path &inPath, const fs::path &outPath)
+{
+    static constexpr comp::Texture::Format FORMATS_8[] = {
+        comp::Texture::R8, comp::Texture::RG8, comp::Texture::RGB8, comp::Texture::RGBA8};
+    static constexpr comp::Texture::Format FORMATS_16F[] = {
+        comp::Texture::R16F, comp::Texture::RG16F, comp::Texture::RGB16F, comp::Texture::RGBA16F};
+
+    const std::string path = inPath.string();
+    comp::Texture::Data data;
+    int width = 0, height = 0, nComponents = 0;
+    if(stbi_is_hdr(path.c_str()))
+    {
+        float *pixels = stbi_loadf(path.c_str(), &width, &height, &nComponents, 0);
+        if(!pixels)
+        {
+            BOYD_LOG(Error, "{}: {}", path, stbi_failure_reason());
+            return false;
+        }
+        const size_t nValues = size_t(width) * size_t(height) * size_t(nComponents);
+        data.pixels.resize(nValues * sizeof(uint16_t));
+        for(size_t i = 0; i < nValues; i++)
+        {
+            const uint16_t half = FloatToHalf(pixels[i]);
+            std::memcpy(data.pixels.data() + i * sizeof(uint16_t), &half, sizeof(half));
+        }
+        stbi_image_free(pixels);
+        data.format = FORMATS_16F[nComponents - 1];
+    }
+    else
+    {
+        uint8_t *pixels = stbi_load(path.c_str(), &width, &height, &nComponents, 0);
+        if(!pixels)
+        {
+            BOYD_LOG(Error, "{}: {}", path, stbi_failure_reason());
+            return false;
+        }
+        data.pixels.assign(pixels, pixels + size_t(width) * size_t(height) * size_t(nComponents));
+        stbi_image_free(pixels);
+        data.format = FORMATS_8[nComponents - 1];
+    }
+    data.width = unsigned(width);
+    data.height = unsigned(height);
+    data.minFilter = comp::Texture::Trilinear;
+    data.magFilter = comp::Texture::Bilinear;
+    data.usage = comp::Texture::Static;
+#ifdef BOYD_COMPRESS_TEXTURES
+    kernels::PrepareTexture(data, true);
+#else
+    kernels::PrepareTexture(data, false);
+#endif
+
+    cooked::Writer writer{cooked::AssetType::Texture};
+    const uint64_t textureOffset = writer.Append(cooked::Texture{});
+    writer.Patch(textureOffset, writer.AppendTexture(data));
+    return WriteFile(outPath, writer.Finish());
+}
+
+/// Cooks a .wav to a `cooked::Wave`.
+static bool CookWave(const fs::path &inPath, const fs::path &outPath)
+{
+    auto loaded = Loader<comp::AudioClip>::Load(inPath.string());
+    const auto *clip = dynamic_cast<const LoadedAsset<comp::AudioClip> *>(loaded.get());
+    if(!clip || !clip->asset.wave.data)
+    {
+        return false;
+    }
+    const Wave &wave = clip->asset.wave;
+    if((wave.channels != 1 && wave.channels != 2) || (wave.sampleSize != 8 && wave.sampleSize != 16))
+    {
+        // (Cooked waves are PCM only: the engine would refuse to load anything else - see `LoadCooked()`)
+        BOYD_LOG(Error, "{}: only 8-bit or 16-bit mono or stereo waves can be cooked", inPath.string());
+        return false;
+    }
+
+    cooked::Writer writer{cooked::AssetType::Wave};
+    const uint64_t waveOffset = writer.Append(cooked::Wave{});
+    cooked::Wave cookedWave{wave.sampleCount, wave.sampleRate, wave.sampleSize, wave.channels, 0, 0};
+    cookedWave.dataSize = uint64_t(wave.sampleCount) * wave.channels * (wave.sampleSize / 8);
+    cookedWave.dataOffset = writer.Append(wave.data.get(), size_t(cookedWave.dataSize));
+    writer.Patch(waveOffset, cookedWave);
+    return WriteFile(outPath, writer.Finish());
+}
+
+using CookFunc = bool (*)(const fs::path &inPath, const fs::path &outPath);
+
+/// Maps (lowercase) file extensions to the function that cooks them.
+static const std::unordered_map<std::string, CookFunc> COOKERS{
+    {".glb", &CookModel},   {".png", &CookTexture}, {".jpg", &CookTexture}, {".jpeg", &CookTexture},
+    {".tga", &CookTexture}, {".bmp", &CookTexture}, {".hdr", &CookTexture}, {".wav", &CookWave},
+    // (.flac files are copied verbatim: they are smaller than PCM, and the engine decodes them itself)
+};
+
+/// Returns true if `outPath` is newer than `inPath` and - if it is a cooked file - if it is of the current version.
+static bool IsUpToDate(const fs::path &inPath, const fs::path &outPath, bool cooked)
+{
+    std::error_code inErr, outErr;
+    const auto inTime = fs::last_write_time(inPath, inErr);
+    const auto outTime = fs::last_write_time(outPath, outErr);
+    if(inErr || outErr || outTime < inTime)
+    {
+        return false;
+    }
+    if(!cooked)
+    {
+        return true;
+    }
+    cooked::Header header{};
+    std::ifstream infile{outPath, std::ios::binary};
+    infile.read(reinterpret_cast<char *>(&header), sizeof(header));
+    return infile && header.magic == cooked::MAGIC && header.version == cooked::VERSION
+           && header.vertexSize == sizeof(comp::Mesh::Vertex);
+}
+
+/// Packs all files in `root` to an archive at `archivePath`. Returns false on error.
+static bool Pack(const fs::path &root, const fs::path &archivePath)
+{
+    std::error_code err;
+    std::vector<fs::path> filepaths;
+    for(const auto &entry : fs::recursive_directory_iterator{root, err})
+    {
+        if(entry.is_regular_file())
+        {
+            filepaths.push_back(entry.path());
+        }
+    }
+    if(err)
+    {
+        BOYD_LOG(Error, "{}: {}", root.string(), err.message());
+        return false;
+    }
+    std::sort(filepaths.begin(), filepaths.end()); // (For reproducible archives)
+
+    const fs::path rootName = (root.has_filename() ? root : root.parent_path()).filename(); // (e.g. "assets")
+    ArchiveWriter writer;
+    for(const auto &filepath : filepaths)
+    {
+        MappedFile file;
+        if(!file.Open(filepath.string()))
+        {
+            BOYD_LOG(Error, "{}: failed to open", filepath.string());
+            return false;
+        }
+        const fs::path archivedPath = rootName / fs::relative(filepath, root);
+        writer.Add(archivedPath.generic_string(), file.Data(), file.Size(), true);
+    }
+    if(!writer.Write(archivePath.string()))
+    {
+        BOYD_LOG(Error, "{}: failed to write", archivePath.string());
+        return false;
+    }
+    BOYD_LOG(Info, "Packed {} files to {}", filepaths.size(), archivePath.string());
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc != 3 && argc != 4)
+    {
+        fprintf(stderr, "Usage: %s <source assets dir> <cooked assets dir> [<archive>]\n", argv[0]);
+        return 1;
+    }
+    const fs::path inRoot{argv[1]}, outRoot{argv[2]};
+
+    std::error_code err;
+    fs::recursive_directory_iterator it{inRoot, err};
+    if(err)
+    {
+        fprintf(stderr, "Failed to open %s: %s\n", argv[1], err.message().c_str());
+        return 1;
+    }
+
+    size_t nCooked = 0, nCopied = 0, nUpToDate = 0, nFailed = 0;
+    for(const auto &entry : it)
+    {
+        if(!entry.is_regular_file())
+        {
+            continue;
+        }
+        const fs::path &inPath = entry.path();
+        const fs::path outPath = outRoot / fs::relative(inPath, inRoot);
+
+        std::string extension = inPath.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) {
+            return char(std::tolower(static_cast<unsigned char>(c)));
+        });
+        const auto cookerIt = COOKERS.find(extension);
+        const bool cook = cookerIt != COOKERS.end();
+
+        if(IsUpToDate(inPath, outPath, cook))
+        {
+            nUpToDate++;
+            continue;
+        }
+
+        if(cook)
+        {
+            if(cookerIt->second(inPath, outPath))
+            {
+                nCooked++;
+            }
+            else
+            {
+                BOYD_LOG(Error, "{}: failed to cook", inPath.string());
+                nFailed++;
+            }
+        }
+        else
+        {
+            fs::create_directories(outPath.parent_path(), err);
+            if(fs::copy_file(inPath, outPath, fs::copy_options::overwrite_existing, err))
+            {
+                nCopied++;
+            }
+            else
+            {
+                BOYD_LOG(Error, "{}: failed to copy: {}", inPath.string(), err.message());
+                nFailed++;
+            }
+        }
+    }
+
+    BOYD_LOG(Info, "Cooked {} assets, copied {}, {} up to date, {} failed", nCooked, nCopied, nUpToDate, nFailed);
+    if(nFailed > 0)
+    {
+        return 1;
+    }
+
+    if(argc == 4 && !Pack(outRoot, fs::path{argv[3]}))
+    {
+        return 1;
+    }
+    return 0;
+}
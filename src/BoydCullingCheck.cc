@@ -0,0 +1,90 @@
+// BoydCullingCheck: checks the Gfx module's frustum culling (see Modules/Gfx/Culling.hh) without a GPU.
+//
+// Usage: BoydCullingCheck
+//
+// Builds an ECS with renderable entities around a camera - in front of it, behind it, past its far plane, straddling
+// its left plane, scaled into view, without mesh data... -, culls them as the Gfx module does for a perspective and an
+// orthographic camera, and checks how many of them survive. Prints the results; exits with 1 if any is unexpected.
+
+#include "Modules/Gfx/Culling.hh"
+
+#include <cstdio>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace boyd;
+
+/// Returns a cube mesh from (-1, -1, -1) to (1, 1, 1) - so with a bounding sphere of radius sqrt(3).
+static comp::Mesh MakeCube()
+{
+    std::vector<comp::Mesh::Vertex> vertices;
+    for(unsigned i = 0; i < 8; i++)
+    {
+        comp::Mesh::Vertex vertex;
+        vertex.position = glm::vec3{(i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f};
+        vertices.push_back(vertex);
+    }
+    std::vector<comp::Mesh::Index> indices = {0, 1, 2, 2, 1, 3, 4, 6, 5, 5, 6, 7}; // (Not all faces; doesn't matter)
+
+    comp::Mesh mesh;
+    mesh.data = Versioned<comp::Mesh::Data>::Make(std::move(vertices), std::move(indices));
+    return mesh;
+}
+
+/// Adds a renderable entity with the given mesh, translated to `position` and scaled by `scale`.
+static void AddRenderable(entt::registry &ecs, const comp::Mesh &mesh, const glm::vec3 &position, float scale = 1.0f)
+{
+    const glm::mat4 matrix = glm::scale(glm::translate(glm::identity<glm::mat4>(), position), glm::vec3{scale});
+    auto entity = ecs.create();
+    ecs.assign<comp::Transform>(entity, matrix);
+    ecs.assign<comp::Mesh>(entity, mesh);
+    ecs.assign<comp::Material>(entity);
+}
+
+/// Culls all renderables in `ecs` for the camera and checks the number of survivors. Returns true if as expected.
+static bool Check(entt::registry &ecs, const char *camera, const glm::mat4 &projectionMtx, size_t nExpected)
+{
+    // (The camera is at the origin, looking down -Z)
+    const glm::mat4 viewMtx = glm::lookAt(glm::vec3{0.0f}, glm::vec3{0.0f, 0.0f, -1.0f}, glm::vec3{0.0f, 1.0f, 0.0f});
+    const Frustum frustum{projectionMtx * viewMtx};
+
+    RenderStats stats;
+    size_t nVisible = 0;
+    CullRenderables(
+        ecs, frustum, stats, [](const comp::Mesh &mesh) { return MeshBounds::Compute(*mesh.data); },
+        [&nVisible](const comp::Transform &, const comp::Mesh &, const comp::Material &, const BoundingSphere &) {
+            nVisible++;
+        });
+
+    const bool ok = nVisible == nExpected && stats.nEntities - stats.nCulled == nVisible;
+    printf("%s camera: %zu renderables, %zu culled, %zu visible (expected %zu): %s\n", camera, stats.nEntities,
+           stats.nCulled, nVisible, nExpected, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+int main()
+{
+    entt::registry ecs;
+    const comp::Mesh cube = MakeCube();
+
+    AddRenderable(ecs, cube, {0.0f, 0.0f, -10.0f});          // In front
+    AddRenderable(ecs, cube, {0.0f, 0.0f, 10.0f});           // Behind
+    AddRenderable(ecs, cube, {0.0f, 0.0f, -200.0f});         // Past the far plane
+    AddRenderable(ecs, cube, {-12.0f, 0.0f, -10.0f});        // Center out of a 90° frustum, but the sphere is not
+    AddRenderable(ecs, cube, {-20.0f, 0.0f, -10.0f});        // Out of a 90° frustum
+    AddRenderable(ecs, cube, {-20.0f, 0.0f, -10.0f}, 10.0f); // Same, but scaled into it
+
+    comp::Mesh noData;
+    noData.data = nullptr;
+    AddRenderable(ecs, noData, {0.0f, 0.0f, -10.0f}); // (Never visible)
+    comp::Mesh empty;
+    AddRenderable(ecs, empty, {0.0f, 0.0f, -10.0f}); // (Never visible)
+
+    // (Not renderable without a Material, so not even counted)
+    auto unrenderable = ecs.create();
+    ecs.assign<comp::Transform>(unrenderable, glm::translate(glm::identity<glm::mat4>(), {0.0f, 0.0f, -10.0f}));
+    ecs.assign<comp::Mesh>(unrenderable, cube);
+
+    bool ok = Check(ecs, "Perspective", glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f), 3);
+    ok &= Check(ecs, "Orthographic", glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 100.0f), 2);
+    return ok ? 0 : 1;
+}
@@ -9,11 +9,26 @@ namespace boyd
 
 struct BOYD_API Wave
 {
+    /// How `data` is encoded.
+    enum Codec
+    {
+        PCM = 0, ///< Raw interleaved samples
+        FLAC,    ///< A whole FLAC stream (see "Core/Flac.hh"); it decodes to 16-bit PCM
+    };
+
     unsigned int sampleCount;      // Total number of samples
     unsigned int sampleRate;       // Frequency (samples per second)
-    unsigned int sampleSize;       // Bit depth (bits per sample): 8, 16, 32 (24 not supported)
+    unsigned int sampleSize;       // Bit depth (bits per sample): 8, 16, 32 (24 not supported) - once decoded
     unsigned int channels;         // Number of channels (1-mono, 2-stereo)
     std::shared_ptr<uint8_t> data; // Buffer data pointer
+    size_t dataSize{0};            // Size of `data` in bytes
+    Codec codec{PCM};              // Encoding of `data`
+
+    /// Returns the size in bytes of the samples once decoded.
+    inline size_t PcmSize() const
+    {
+        return size_t(sampleCount) * channels * (sampleSize / 8);
+    }
 };
 
 namespace comp
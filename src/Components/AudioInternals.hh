@@ -4,18 +4,26 @@
 #include "AudioClip.hh"
 #include <AL/al.h>
 #include <AL/alc.h>
+#include <memory>
 
 namespace boyd
 {
 namespace comp
 {
 
+/// The playback state of an `AudioClip` + `AudioSource`, managed by the Audio module.
+/// A clip is "virtual" while it has no voice: it is not heard, but its playback time keeps running so that it can
+/// resume from the right point when it gets a voice back.
 struct BOYD_API AudioInternals
 {
-    ALuint dataBuffer;
-    ALuint source;
-    ALenum format;
-    bool isSet = false;
+    ALenum format = AL_NONE; ///< (AL_NONE if the clip can't be played)
+    float duration = 0.0f;   ///< Length of the clip, in seconds
+    float time = 0.0f;       ///< Seconds played so far (wraps around for looping clips)
+    float audibility = 0.0f; ///< Estimated gain at the listener's position, in [0, 1]
+
+    /// The voice playing the clip, handed out by the Audio module's backend (see "Modules/Audio/Backend.hh"); null
+    /// while virtual. Releasing it stops the voice.
+    std::shared_ptr<void> voice;
 
     explicit AudioInternals(const AudioClip &clip)
     {
@@ -37,21 +45,28 @@ struct BOYD_API AudioInternals
             BOYD_LOG(Warn, "OpenAL does not support this file. Got bps: {}; channels: {}", bitsPerSample, channels);
             return;
         }
+        duration = (sampleRate > 0) ? float(wave.sampleCount) / sampleRate : 0.0f;
+    }
+
+    /// Returns true if the clip is being played by a voice.
+    inline bool IsReal() const
+    {
+        return bool(voice);
     }
 
-    ~AudioInternals()
+    /// Gives the voice back (stopping it), keeping the playback time.
+    void Virtualize()
     {
-        alDeleteBuffers(1, &source);
-        alDeleteBuffers(1, &dataBuffer);
+        voice.reset();
     }
 
     /// Internals should not be shared.
     AudioInternals() = delete;
     AudioInternals(const AudioInternals &) = delete;
     AudioInternals &operator=(const AudioInternals &) = delete;
-    AudioInternals(AudioInternals &&o) = default;
-    AudioInternals &operator=(AudioInternals &&) = default;
+    AudioInternals(AudioInternals &&toMove) = default;
+    AudioInternals &operator=(AudioInternals &&toMove) = default;
 };
 
 } // namespace comp
-} // namespace boyd
\ No newline at end of file
+} // namespace boyd
@@ -17,6 +17,10 @@ struct BOYD_API AudioSource
         BGM,          /// For looping background music that should be omnidirectional.
     } soundType;
 
+    /// When there are more sources playing than voices to play them with, the ones with the highest priority - then
+    /// the most audible ones - are heard (BGM always comes first).
+    int priority = 0;
+
     /// Make sure those are accessible from Lua
     static constexpr int _SFX = SFX;
     static constexpr int _SFX_LOOPABLE = SFX_LOOPABLE;
@@ -48,12 +52,23 @@ struct Registrar<comp::AudioSource, TRegister>
         return {type};
     }
 
+    static int GetPriority(const comp::AudioSource *self)
+    {
+        return self->priority;
+    }
+
+    static void SetPriority(comp::AudioSource *self, int priority)
+    {
+        self->priority = priority;
+    }
+
     static TRegister Register(TRegister &reg)
     {
         // clang-format off
         return reg.template beginClass<comp::AudioSource>(TYPENAME)
             .template addConstructor<void (*)(int)>()
             .addFunction("add", Add)
+            .addProperty("priority", GetPriority, SetPriority)
         .endClass();
         // clang-format on
     }
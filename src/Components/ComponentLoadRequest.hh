@@ -30,19 +30,31 @@ struct BOYD_API ComponentLoadRequest
         return entt::type_info<T>::id();
     }
 
+    /// How urgently the assets are needed. Higher-priority requests are serviced first.
+    enum Priority
+    {
+        Prefetch = 0, ///< Not needed yet; load when there is nothing better to do
+        Normal = 1,   ///< Needed soon
+        Visible = 2,  ///< Needed right now (e.g. the entity is already on screen)
+    };
+    static constexpr int NUM_PRIORITIES = Visible + 1;
+
     /// All <TypeOf(TAsset) -> filepath to load asset from> requests for asset loads for this entity.
     std::unordered_map<ENTT_ID_TYPE, std::string> requests;
 
+    /// The priority of all `requests`.
+    Priority priority;
+
     ComponentLoadRequest()
-        : requests{}
+        : requests{}, priority{Normal}
     {
     }
-    ComponentLoadRequest(const decltype(requests) &requests)
-        : requests{requests}
+    ComponentLoadRequest(const decltype(requests) &requests, Priority priority = Normal)
+        : requests{requests}, priority{priority}
     {
     }
     ComponentLoadRequest(std::initializer_list<typename decltype(requests)::value_type> requests)
-        : requests{requests}
+        : requests{requests}, priority{Normal}
     {
     }
 };
@@ -59,11 +71,23 @@ struct Registrar<comp::ComponentLoadRequest, TRegister>
         return comp::ComponentLoadRequest{{typeId, asset}};
     }
 
+    static int GetPriority(const comp::ComponentLoadRequest *self)
+    {
+        return self->priority;
+    }
+
+    /// Force the conversion as Lua does not understand enums
+    static void SetPriority(comp::ComponentLoadRequest *self, int priority)
+    {
+        self->priority = static_cast<comp::ComponentLoadRequest::Priority>(priority);
+    }
+
     static TRegister Register(TRegister &reg)
     {
         return reg.template beginClass<comp::ComponentLoadRequest>(TYPENAME)
             .template addConstructor<void (*)(void)>()
             .addFunction("add", Add)
+            .addProperty("priority", GetPriority, SetPriority)
             .endClass();
     }
 };
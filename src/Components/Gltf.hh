@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../Core/Platform.hh"
+#include <entt/entt.hpp>
+#include <vector>
 
 namespace boyd
 {
@@ -8,10 +10,14 @@ namespace comp
 {
 
 /// A "virtual component" used to tell the AssetLoader module to load a GLTF file.
-/// It serves no other purpose but to be put in a ComponentLoadRequest.
+/// Once loaded, it is set on the target entity and tracks the entities that were instantiated for the GLTF's scene.
 struct BOYD_API Gltf
 {
+    /// One entity per mesh primitive in the scene, or empty if the scene was assigned to the target entity itself.
+    /// They follow the target (see `comp::Parent`), and are destroyed along with this component - i.e. when the target
+    /// is destroyed, or when another GLTF is loaded onto it.
+    std::vector<entt::entity> entities;
 };
 
 } // namespace comp
-} // namespace boyd
\ No newline at end of file
+} // namespace boyd
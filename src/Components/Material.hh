@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../Core/Platform.hh"
+#include "../Core/Versioned.hh"
 #include <glm/glm.hpp>
 #include <memory>
 #include <string>
@@ -19,21 +20,58 @@ using MaterialParameter = std::variant<float, glm::vec2, glm::vec3, glm::vec4, g
 
 /// A graphics material.
 /// Attach this to an entity with a Mesh and a Transform to make it renderable.
+///
+/// Copies of a material share its data, like copies of a mesh do: entities with copies of the same material are
+/// batched together, and the renderer only recompiles a material when its data is edited (see `Versioned`).
 struct BOYD_API Material
 {
-    /// The parameters set in this material
-    std::unordered_map<std::string, MaterialParameter> parameters;
+    using Parameters = std::unordered_map<std::string, MaterialParameter>;
 
+    struct Data
+    {
+        /// The parameters set in this material
+        Parameters parameters{};
+    };
+    Versioned<Data> data;
+
+    /// Creates a new material without parameters.
     Material()
-        : parameters{}
+        : data{Versioned<Data>::Make()}
+    {
+    }
+
+    /// Creates a new material with the given parameters.
+    Material(std::initializer_list<Parameters::value_type> parameters)
+        : data{Versioned<Data>::Make(Parameters{parameters})}
     {
     }
 
-    Material(std::initializer_list<decltype(parameters)::value_type> parameters)
-        : parameters{parameters}
+    /// Two materials are the same if they share the same data.
+    /// (Materials with equal but separate data are not, so that they can be told apart without comparing parameters)
+    inline bool operator==(const Material &other) const
+    {
+        return data == other.data;
+    }
+    inline bool operator!=(const Material &other) const
     {
+        return data != other.data;
     }
 };
 
 } // namespace comp
-} // namespace boyd
\ No newline at end of file
+} // namespace boyd
+
+namespace std
+{
+
+template <>
+struct hash<boyd::comp::Material>
+{
+    /// Hashes the identity of a material's data, consistently with `Material::operator==()`.
+    inline size_t operator()(const boyd::comp::Material &self) const
+    {
+        return std::hash<boyd::Versioned<boyd::comp::Material::Data>>{}(self.data);
+    }
+};
+
+} // namespace std
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "../Core/Platform.hh"
 #include "../Core/Versioned.hh"
+#include <algorithm>
+#include <cstdint>
 #include <entt/entt.hpp>
 #include <glm/glm.hpp>
 #include <string>
@@ -32,11 +34,90 @@ struct BOYD_API Mesh
         Stream = 2,  ///< Stream; load/render once per frame, discard after use
     };
 
+    /// How vertices are stored on the GPU. (In RAM, they are always stored as `Vertex`es)
+    struct Layout
+    {
+        enum NormalFormat : uint8_t
+        {
+            NormalFloat3 = 0, ///< 3x float (12 bytes)
+            NormalOct16,      ///< Octahedral-encoded, 2x normalized short (4 bytes)
+        };
+        enum TintFormat : uint8_t
+        {
+            TintFloat4 = 0, ///< 4x float (16 bytes)
+            TintRGBA8,      ///< 4x normalized unsigned byte (4 bytes)
+        };
+        enum TexCoordFormat : uint8_t
+        {
+            TexCoordFloat2 = 0, ///< 2x float (8 bytes)
+            TexCoordHalf2,      ///< 2x half float (4 bytes)
+            TexCoordUnorm16,    ///< 2x normalized unsigned short (4 bytes); only for texcoords in [0, 1]!
+        };
+
+        NormalFormat normal{NormalFloat3};
+        TintFormat tint{TintFloat4};
+        TexCoordFormat texCoord{TexCoordFloat2};
+
+        /// Full precision; 48 bytes per vertex.
+        static constexpr Layout Full()
+        {
+            return {NormalFloat3, TintFloat4, TexCoordFloat2};
+        }
+        /// Quantized normals, tint and texcoords; 24 bytes per vertex.
+        static constexpr Layout Compact()
+        {
+            return {NormalOct16, TintRGBA8, TexCoordHalf2};
+        }
+
+        inline bool operator==(const Layout &other) const
+        {
+            return normal == other.normal && tint == other.tint && texCoord == other.texCoord;
+        }
+        inline bool operator!=(const Layout &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    /// A range of elements [begin, end).
+    struct Range
+    {
+        size_t begin{0};
+        size_t end{SIZE_MAX};
+
+        inline bool Empty() const
+        {
+            return begin >= end;
+        }
+
+        /// Widens the range so that it also covers [first, last).
+        inline void Add(size_t first, size_t last)
+        {
+            if(Empty())
+            {
+                begin = first;
+                end = last;
+            }
+            else
+            {
+                begin = std::min(begin, first);
+                end = std::max(end, last);
+            }
+        }
+    };
+
     struct Data
     {
         std::vector<Vertex> vertices{};
         std::vector<Index> indices{};
         Usage usage{Static};
+        Layout layout{Layout::Full()};
+
+        /// The vertices/indices that changed since this data was last uploaded to the GPU (default: all of them); the
+        /// Gfx module empties them after each upload.
+        /// `Add()` the parts you change to these when editing a `Dynamic` mesh, so that only they get re-uploaded (an
+        /// edit that adds to neither re-uploads everything).
+        Range dirtyVertices{}, dirtyIndices{};
     };
     Versioned<Data> data;
 
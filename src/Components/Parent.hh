@@ -0,0 +1,27 @@
+#pragma once
+
+#include "../Core/Platform.hh"
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+namespace boyd
+{
+namespace comp
+{
+
+/// Places an entity relative to another one, its parent.
+/// Every frame, the AssetLoader module sets the entity's Transform to the parent's Transform times `local` - as long
+/// as the parent is alive and has a Transform. (Parents are not chained: the Transform of a parent is used as is)
+struct BOYD_API Parent
+{
+    entt::entity entity;
+    glm::mat4 local; ///< The transform of the entity relative to its parent
+
+    Parent(entt::entity entity = entt::null, const glm::mat4 &local = glm::mat4{1.0f})
+        : entity{entity}, local{local}
+    {
+    }
+};
+
+} // namespace comp
+} // namespace boyd
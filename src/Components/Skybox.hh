@@ -1,17 +1,41 @@
 #pragma once
 
 #include "../Core/Platform.hh"
+#include "../Core/Versioned.hh"
+#include "Texture.hh"
 
 namespace boyd
 {
 namespace comp
 {
 
-/// A renderable skybox.
-/// Must be attached to the same entity with the `Camera` & `MainCamera` to work!
+/// A renderable skybox, plus the image-based lighting prefiltered from it.
+/// The first skybox found in the ECS is rendered behind everything else (put it on the camera entity, for example).
 struct BOYD_API Skybox
 {
-    // TODO IMPLEMENT
+    /// A cube map, as six square textures of the same format, size and number of levels.
+    struct Cubemap
+    {
+        enum Face
+        {
+            PositiveX = 0,
+            NegativeX,
+            PositiveY,
+            NegativeY,
+            PositiveZ,
+            NegativeZ,
+            _Count,
+        };
+        Texture::Data faces[_Count]; ///< In the order of `GL_TEXTURE_CUBE_MAP_POSITIVE_X + i` - and of its orientation
+    };
+
+    struct Data
+    {
+        Cubemap environment; ///< The sky itself, with its full mip chain
+        Cubemap irradiance;  ///< Cosine-weighted convolution of the sky (divided by pi), to light diffuse surfaces
+        Cubemap specular;    ///< GGX-prefiltered sky; mip level i is for roughness i / (levels - 1)
+    };
+    Versioned<Data> data;
 };
 
 } // namespace comp
@@ -3,6 +3,12 @@
 #include "../Core/Platform.hh"
 #include "../Core/Versioned.hh"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
 namespace boyd
 {
 namespace comp
@@ -24,8 +30,32 @@ struct BOYD_API Texture
         RG16F,
         RGB16F,
         RGBA16F,
+        // Block-compressed (4x4 pixel blocks)
+        BC1, ///< RGB, 8 bytes per block (a.k.a. DXT1)
+        BC3, ///< RGBA, 16 bytes per block (a.k.a. DXT5)
     };
 
+    /// Returns true if the given format is block-compressed.
+    static inline bool IsCompressed(Format format)
+    {
+        return format == BC1 || format == BC3;
+    }
+
+    /// Returns the size in bytes of a `width`x`height` image in the given format.
+    static inline size_t ImageSize(Format format, unsigned width, unsigned height)
+    {
+        static constexpr const size_t BYTES_PER_PIXEL[] = {
+            1, 2, 3, 4, // 8-bit int
+            2, 4, 6, 8, // 16-bit float
+        };
+        if(IsCompressed(format))
+        {
+            const size_t nBlocks = size_t((width + 3) / 4) * size_t((height + 3) / 4);
+            return nBlocks * (format == BC1 ? 8 : 16);
+        }
+        return size_t(width) * height * BYTES_PER_PIXEL[format];
+    }
+
     enum Usage
     {
         Static = 0, ///< Static; load once, render many times
@@ -49,6 +79,34 @@ struct BOYD_API Texture
         Filter minFilter{Bilinear};
         Filter magFilter{Bilinear}; ///< NOTE: Only accepts Nearest or Bilinear!
         Usage usage{Static};
+        unsigned levels{1}; ///< Number of mip levels in `pixels`, stored one after the other from the biggest
+
+        /// Width/height of the given mip level.
+        inline unsigned LevelWidth(unsigned level) const
+        {
+            return std::max(width >> level, 1u);
+        }
+        inline unsigned LevelHeight(unsigned level) const
+        {
+            return std::max(height >> level, 1u);
+        }
+
+        /// Size in bytes of the given mip level.
+        inline size_t LevelSize(unsigned level) const
+        {
+            return ImageSize(format, LevelWidth(level), LevelHeight(level));
+        }
+
+        /// Offset in bytes of the given mip level in `pixels`.
+        inline size_t LevelOffset(unsigned level) const
+        {
+            size_t offset = 0;
+            for(unsigned i = 0; i < level; i++)
+            {
+                offset += LevelSize(i);
+            }
+            return offset;
+        }
     };
     Versioned<Data> data;
 
@@ -57,7 +115,22 @@ struct BOYD_API Texture
         : data{Versioned<Data>::Make(data)}
     {
     }
+    /// Creates a texture that shares the given data.
+    explicit Texture(Versioned<Data> data)
+        : data{std::move(data)}
+    {
+    }
     ~Texture() = default;
+
+    /// Two textures are the same if they share the same data.
+    inline bool operator==(const Texture &other) const
+    {
+        return data == other.data;
+    }
+    inline bool operator!=(const Texture &other) const
+    {
+        return data != other.data;
+    }
 };
 
 } // namespace comp
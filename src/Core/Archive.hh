@@ -0,0 +1,317 @@
+#pragma once
+
+#include "Lz4.hh"
+#include "MappedFile.hh"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace boyd
+{
+
+/// Packed asset archives (".bpak"): many files in one, so that loading assets does not cost an open + read per file.
+///
+/// An archive is a `Header`, a table of `Entry`s, an open-addressing hash table (path hash -> entry index) for O(1)
+/// lookups, the entries' paths, and finally the contents of each file - aligned to `ALIGNMENT` (so that cooked assets
+/// can be used in place) and either stored as they are or LZ4-compressed.
+/// All offsets are in bytes from the start of the archive; integers are little-endian (like on all of our targets).
+namespace pak
+{
+
+static constexpr uint32_t MAGIC = 0x4B415042; ///< "BPAK"
+static constexpr uint32_t VERSION = 1;
+static constexpr size_t ALIGNMENT = 16;
+static constexpr uint32_t EMPTY_BUCKET = 0xFFFFFFFF;
+
+enum class Compression : uint32_t
+{
+    None = 0,
+    Lz4 = 1, ///< A single LZ4 block (see Lz4.hh)
+};
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nEntries;
+    uint32_t nBuckets;      ///< (A power of two)
+    uint64_t entriesOffset; ///< -> Entry[nEntries]
+    uint64_t bucketsOffset; ///< -> uint32_t[nBuckets]: entry index or `EMPTY_BUCKET`
+    uint64_t pathsOffset;   ///< -> char[]
+    uint64_t fileSize;
+};
+
+struct Entry
+{
+    uint64_t pathHash;
+    uint64_t pathOffset; ///< Relative to `Header::pathsOffset`
+    uint64_t pathLength;
+    uint64_t offset;     ///< -> uint8_t[storedSize]
+    uint64_t storedSize; ///< Size in the archive (compressed or not)
+    uint64_t size;       ///< Size once decompressed
+    Compression compression;
+    uint32_t padding;
+};
+
+/// Normalizes a path to how it is stored in archives: forward slashes, no leading "./" or "/".
+inline std::string NormalizePath(std::string_view path)
+{
+    std::string normalized{path};
+    for(auto &c : normalized)
+    {
+        c = (c == '\\') ? '/' : c;
+    }
+    size_t start = 0;
+    while(start < normalized.size())
+    {
+        if(normalized.compare(start, 2, "./") == 0)
+        {
+            start += 2;
+        }
+        else if(normalized[start] == '/')
+        {
+            start++;
+        }
+        else
+        {
+            break;
+        }
+    }
+    return normalized.substr(start);
+}
+
+/// Hashes a (normalized) path (64-bit FNV-1a).
+inline uint64_t HashPath(std::string_view path)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for(char c : path)
+    {
+        hash = (hash ^ uint8_t(c)) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+} // namespace pak
+
+/// A memory-mapped archive, to read files from.
+class Archive
+{
+public:
+    /// Maps and validates the archive at `filepath`. Returns false on error.
+    bool Open(const std::string &filepath)
+    {
+        auto mapped = std::make_shared<MappedFile>();
+        if(!mapped->Open(filepath) || mapped->Size() < sizeof(pak::Header))
+        {
+            return false;
+        }
+        const uint8_t *bytes = mapped->Data();
+        const size_t size = mapped->Size();
+
+        const auto *archiveHeader = reinterpret_cast<const pak::Header *>(bytes);
+        if(archiveHeader->magic != pak::MAGIC || archiveHeader->version != pak::VERSION
+           || archiveHeader->fileSize != size || archiveHeader->nBuckets == 0
+           || (archiveHeader->nBuckets & (archiveHeader->nBuckets - 1)) != 0
+           || archiveHeader->nBuckets < archiveHeader->nEntries
+           || !InBounds(size, archiveHeader->entriesOffset, archiveHeader->nEntries * sizeof(pak::Entry))
+           || !InBounds(size, archiveHeader->bucketsOffset, archiveHeader->nBuckets * sizeof(uint32_t))
+           || archiveHeader->pathsOffset > size)
+        {
+            return false;
+        }
+        const auto *archiveEntries = reinterpret_cast<const pak::Entry *>(bytes + archiveHeader->entriesOffset);
+        const size_t pathsSize = size - archiveHeader->pathsOffset;
+        for(uint32_t i = 0; i < archiveHeader->nEntries; i++)
+        {
+            const auto &entry = archiveEntries[i];
+            if(!InBounds(size, entry.offset, entry.storedSize)
+               || !InBounds(pathsSize, entry.pathOffset, entry.pathLength)
+               || (entry.compression == pak::Compression::None && entry.storedSize != entry.size)
+               || (entry.compression != pak::Compression::None && entry.compression != pak::Compression::Lz4))
+            {
+                return false;
+            }
+        }
+
+        file = std::move(mapped);
+        header = archiveHeader;
+        entries = archiveEntries;
+        buckets = reinterpret_cast<const uint32_t *>(bytes + header->bucketsOffset);
+        paths = reinterpret_cast<const char *>(bytes + header->pathsOffset);
+        return true;
+    }
+
+    inline bool IsOpen() const
+    {
+        return file != nullptr;
+    }
+
+    /// Returns the entry for the file at `path` (see `pak::NormalizePath()`), or null if there is none.
+    const pak::Entry *Find(std::string_view path) const
+    {
+        if(!file)
+        {
+            return nullptr;
+        }
+        const uint64_t hash = pak::HashPath(path);
+        const uint32_t mask = header->nBuckets - 1;
+        for(uint32_t i = 0, bucket = uint32_t(hash) & mask; i < header->nBuckets; i++, bucket = (bucket + 1) & mask)
+        {
+            const uint32_t index = buckets[bucket];
+            if(index == pak::EMPTY_BUCKET || index >= header->nEntries)
+            {
+                return nullptr;
+            }
+            const auto &entry = entries[index];
+            if(entry.pathHash == hash && Path(entry) == path)
+            {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    /// Returns the path of an entry.
+    inline std::string_view Path(const pak::Entry &entry) const
+    {
+        return {paths + entry.pathOffset, size_t(entry.pathLength)};
+    }
+
+    /// Returns the (possibly compressed) contents of an entry in the mapped archive.
+    inline const uint8_t *StoredData(const pak::Entry &entry) const
+    {
+        return file->Data() + entry.offset;
+    }
+
+    /// The mapped archive file (to keep it alive for as long as data in it is referenced).
+    inline const std::shared_ptr<const MappedFile> &File() const
+    {
+        return file;
+    }
+
+private:
+    std::shared_ptr<const MappedFile> file;
+    const pak::Header *header{nullptr};
+    const pak::Entry *entries{nullptr};
+    const uint32_t *buckets{nullptr};
+    const char *paths{nullptr};
+
+    static inline bool InBounds(size_t size, uint64_t offset, uint64_t length)
+    {
+        return offset <= size && length <= size - offset;
+    }
+};
+
+/// Builds an archive in memory, then writes it to file.
+class ArchiveWriter
+{
+public:
+    /// Adds a file to the archive. If `compress`, it is stored LZ4-compressed - but only if that saves at least 1/8 of
+    /// its size, as reading it back then costs a copy.
+    void Add(std::string_view path, const uint8_t *data, size_t size, bool compress)
+    {
+        File file;
+        file.path = pak::NormalizePath(path);
+        file.size = size;
+        file.compression = pak::Compression::None;
+        if(compress && size > 0)
+        {
+            file.data = lz4::Compress(data, size);
+            if(file.data.size() <= size - size / 8)
+            {
+                file.compression = pak::Compression::Lz4;
+            }
+        }
+        if(file.compression == pak::Compression::None)
+        {
+            file.data.assign(data, data + size);
+        }
+        files.push_back(std::move(file));
+    }
+
+    /// Writes the archive to `filepath`. Returns false on error.
+    bool Write(const std::string &filepath) const
+    {
+        uint32_t nBuckets = 1;
+        while(nBuckets < files.size() * 2) // (Load factor <= 0.5)
+        {
+            nBuckets *= 2;
+        }
+
+        pak::Header header{};
+        header.magic = pak::MAGIC;
+        header.version = pak::VERSION;
+        header.nEntries = uint32_t(files.size());
+        header.nBuckets = nBuckets;
+        header.entriesOffset = Align(sizeof(pak::Header));
+        header.bucketsOffset = Align(header.entriesOffset + files.size() * sizeof(pak::Entry));
+        header.pathsOffset = header.bucketsOffset + nBuckets * sizeof(uint32_t);
+
+        std::vector<pak::Entry> entries(files.size());
+        std::vector<uint32_t> buckets(nBuckets, pak::EMPTY_BUCKET);
+        std::string paths;
+        for(size_t i = 0; i < files.size(); i++)
+        {
+            auto &entry = entries[i];
+            entry.pathHash = pak::HashPath(files[i].path);
+            entry.pathOffset = paths.size();
+            entry.pathLength = files[i].path.size();
+            entry.storedSize = files[i].data.size();
+            entry.size = files[i].size;
+            entry.compression = files[i].compression;
+            paths += files[i].path;
+
+            uint32_t bucket = uint32_t(entry.pathHash) & (nBuckets - 1);
+            while(buckets[bucket] != pak::EMPTY_BUCKET)
+            {
+                bucket = (bucket + 1) & (nBuckets - 1);
+            }
+            buckets[bucket] = uint32_t(i);
+        }
+        uint64_t offset = header.pathsOffset + paths.size();
+        for(size_t i = 0; i < files.size(); i++)
+        {
+            entries[i].offset = Align(offset);
+            offset = entries[i].offset + entries[i].storedSize;
+        }
+        header.fileSize = offset;
+
+        std::ofstream outfile{filepath, std::ios::binary | std::ios::trunc};
+        auto writeAt = [&outfile](uint64_t at, const void *data, size_t size) {
+            static const char ZEROS[pak::ALIGNMENT] = {};
+            outfile.write(ZEROS, std::streamsize(at - uint64_t(outfile.tellp())));
+            outfile.write(static_cast<const char *>(data), std::streamsize(size));
+        };
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.entriesOffset, entries.data(), entries.size() * sizeof(pak::Entry));
+        writeAt(header.bucketsOffset, buckets.data(), buckets.size() * sizeof(uint32_t));
+        writeAt(header.pathsOffset, paths.data(), paths.size());
+        for(size_t i = 0; i < files.size(); i++)
+        {
+            writeAt(entries[i].offset, files[i].data.data(), files[i].data.size());
+        }
+        return bool(outfile);
+    }
+
+private:
+    struct File
+    {
+        std::string path;
+        std::vector<uint8_t> data; ///< (Compressed or not)
+        size_t size;
+        pak::Compression compression;
+    };
+    std::vector<File> files;
+
+    static inline uint64_t Align(uint64_t offset)
+    {
+        return (offset + pak::ALIGNMENT - 1) / pak::ALIGNMENT * pak::ALIGNMENT;
+    }
+};
+
+} // namespace boyd
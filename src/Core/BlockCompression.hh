@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace boyd
+{
+
+/// Encoding/decoding of the BC1 (DXT1) and BC3 (DXT5) block-compressed texture formats
+/// (https://registry.khronos.org/OpenGL/extensions/EXT/EXT_texture_compression_s3tc.txt).
+/// Images are split in 4x4 pixel blocks; BC1 stores each in 8 bytes (two RGB565 endpoints + 2-bit indices into the
+/// 4 colors interpolated between them), BC3 prepends 8 bytes of alpha (two 8-bit endpoints + 3-bit indices).
+/// The encoder fits endpoints along the principal axis of each block's colors - it is meant to run on the loader
+/// threads / offline, so it favours quality over speed but does not do any exhaustive search.
+namespace bcn
+{
+
+static constexpr unsigned BLOCK_SIZE = 4;
+static constexpr size_t BC1_BLOCK_BYTES = 8;
+static constexpr size_t BC3_BLOCK_BYTES = 16;
+
+/// Packs a RGB888 color to RGB565 (rounding to nearest).
+inline uint16_t PackRgb565(const float rgb[3])
+{
+    auto quantize = [](float value, unsigned maxValue) {
+        return unsigned(std::clamp(value, 0.0f, 255.0f) * maxValue / 255.0f + 0.5f);
+    };
+    return uint16_t((quantize(rgb[0], 31) << 11) | (quantize(rgb[1], 63) << 5) | quantize(rgb[2], 31));
+}
+
+/// Unpacks a RGB565 color to RGB888 (replicating the high bits to the low ones, like the GPU does).
+inline void UnpackRgb565(uint16_t packed, uint8_t rgb[3])
+{
+    const unsigned r = (packed >> 11) & 0x1Fu, g = (packed >> 5) & 0x3Fu, b = packed & 0x1Fu;
+    rgb[0] = uint8_t((r << 3) | (r >> 2));
+    rgb[1] = uint8_t((g << 2) | (g >> 4));
+    rgb[2] = uint8_t((b << 3) | (b >> 2));
+}
+
+/// Encodes the colors of a block of 16 RGBA8 pixels (alpha is ignored) to 8 bytes of BC1, in 4-color mode.
+inline void EncodeColorBlock(const uint8_t pixels[16][4], uint8_t out[BC1_BLOCK_BYTES])
+{
+    // Mean and covariance of the colors...
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for(unsigned i = 0; i < 16; i++)
+    {
+        for(unsigned c = 0; c < 3; c++)
+        {
+            mean[c] += pixels[i][c] / 16.0f;
+        }
+    }
+    float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}; // rr, rg, rb, gg, gb, bb
+    for(unsigned i = 0; i < 16; i++)
+    {
+        const float r = pixels[i][0] - mean[0], g = pixels[i][1] - mean[1], b = pixels[i][2] - mean[2];
+        cov[0] += r * r;
+        cov[1] += r * g;
+        cov[2] += r * b;
+        cov[3] += g * g;
+        cov[4] += g * b;
+        cov[5] += b * b;
+    }
+
+    // ...whose principal axis (found by power iteration) is the line that best fits them
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for(unsigned iteration = 0; iteration < 8; iteration++)
+    {
+        const float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        const float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        const float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        const float norm = std::max({std::fabs(x), std::fabs(y), std::fabs(z)});
+        if(norm < 1e-6f)
+        {
+            break; // (All colors are (nearly) the same; any axis does)
+        }
+        axis[0] = x / norm;
+        axis[1] = y / norm;
+        axis[2] = z / norm;
+    }
+    const float axisLengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+    // Endpoints = extremes of the colors projected on the axis, inset a bit (so that they are not wasted on outliers)
+    float minT = 0.0f, maxT = 0.0f;
+    for(unsigned i = 0; i < 16; i++)
+    {
+        const float t = ((pixels[i][0] - mean[0]) * axis[0] + (pixels[i][1] - mean[1]) * axis[1]
+                         + (pixels[i][2] - mean[2]) * axis[2])
+                        / axisLengthSq;
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    const float inset = (maxT - minT) / 16.0f;
+    minT += inset;
+    maxT -= inset;
+    float endpoint0[3], endpoint1[3];
+    for(unsigned c = 0; c < 3; c++)
+    {
+        endpoint0[c] = mean[c] + axis[c] * maxT;
+        endpoint1[c] = mean[c] + axis[c] * minT;
+    }
+    uint16_t color0 = PackRgb565(endpoint0), color1 = PackRgb565(endpoint1);
+    if(color0 < color1)
+    {
+        std::swap(color0, color1); // color0 > color1 selects the 4-color mode
+    }
+
+    uint32_t indices = 0;
+    if(color0 != color1)
+    {
+        uint8_t palette[4][3];
+        UnpackRgb565(color0, palette[0]);
+        UnpackRgb565(color1, palette[1]);
+        for(unsigned c = 0; c < 3; c++)
+        {
+            palette[2][c] = uint8_t((2 * palette[0][c] + palette[1][c]) / 3);
+            palette[3][c] = uint8_t((palette[0][c] + 2 * palette[1][c]) / 3);
+        }
+        for(unsigned i = 0; i < 16; i++)
+        {
+            unsigned bestIndex = 0;
+            int bestDistance = 0x7FFFFFFF;
+            for(unsigned p = 0; p < 4; p++)
+            {
+                const int dr = pixels[i][0] - palette[p][0];
+                const int dg = pixels[i][1] - palette[p][1];
+                const int db = pixels[i][2] - palette[p][2];
+                const int distance = dr * dr + dg * dg + db * db;
+                if(distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    bestIndex = p;
+                }
+            }
+            indices |= uint32_t(bestIndex) << (2 * i);
+        }
+    }
+    // (Else: a single color - all indices are 0)
+
+    out[0] = uint8_t(color0 & 0xFF);
+    out[1] = uint8_t(color0 >> 8);
+    out[2] = uint8_t(color1 & 0xFF);
+    out[3] = uint8_t(color1 >> 8);
+    std::memcpy(out + 4, &indices, sizeof(indices));
+}
+
+/// Encodes the alphas of a block of 16 RGBA8 pixels to the 8 bytes of BC3 alpha, in 8-alpha mode.
+inline void EncodeAlphaBlock(const uint8_t pixels[16][4], uint8_t out[8])
+{
+    uint8_t alpha0 = 0, alpha1 = 255;
+    for(unsigned i = 0; i < 16; i++)
+    {
+        alpha0 = std::max(alpha0, pixels[i][3]);
+        alpha1 = std::min(alpha1, pixels[i][3]);
+    }
+
+    uint64_t indices = 0;
+    if(alpha0 != alpha1)
+    {
+        // alpha0 > alpha1 selects the 8-alpha mode: 0 = alpha0, 1 = alpha1, 2..7 = alpha0 -> alpha1 in 1/7 steps
+        for(unsigned i = 0; i < 16; i++)
+        {
+            const int range = alpha0 - alpha1;
+            const int step = ((alpha0 - pixels[i][3]) * 7 + range / 2) / range; // 0 (alpha0) .. 7 (alpha1)
+            const unsigned index = (step == 0) ? 0 : (step == 7) ? 1 : unsigned(step + 1);
+            indices |= uint64_t(index) << (3 * i);
+        }
+    }
+
+    out[0] = alpha0;
+    out[1] = alpha1;
+    for(unsigned i = 0; i < 6; i++)
+    {
+        out[2 + i] = uint8_t(indices >> (8 * i));
+    }
+}
+
+/// Decodes 8 bytes of BC1 to a block of 16 RGBA8 pixels.
+/// `fourColors` forces the 4-color mode, as for the color part of BC3 blocks.
+inline void DecodeColorBlock(const uint8_t in[BC1_BLOCK_BYTES], uint8_t pixels[16][4], bool fourColors = false)
+{
+    const uint16_t color0 = uint16_t(in[0] | (in[1] << 8)), color1 = uint16_t(in[2] | (in[3] << 8));
+    const bool fourColorMode = fourColors || color0 > color1;
+    uint8_t palette[4][4];
+    UnpackRgb565(color0, palette[0]);
+    UnpackRgb565(color1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    for(unsigned c = 0; c < 3; c++)
+    {
+        if(fourColorMode)
+        {
+            palette[2][c] = uint8_t((2 * palette[0][c] + palette[1][c]) / 3);
+            palette[3][c] = uint8_t((palette[0][c] + 2 * palette[1][c]) / 3);
+        }
+        else
+        {
+            palette[2][c] = uint8_t((palette[0][c] + palette[1][c]) / 2);
+            palette[3][c] = 0;
+        }
+    }
+    palette[3][3] = fourColorMode ? 255 : 0;
+
+    uint32_t indices;
+    std::memcpy(&indices, in + 4, sizeof(indices));
+    for(unsigned i = 0; i < 16; i++)
+    {
+        std::memcpy(pixels[i], palette[(indices >> (2 * i)) & 3u], 4);
+    }
+}
+
+/// Decodes the 8 bytes of BC3 alpha to the alphas of a block of 16 RGBA8 pixels.
+inline void DecodeAlphaBlock(const uint8_t in[8], uint8_t pixels[16][4])
+{
+    const unsigned alpha0 = in[0], alpha1 = in[1];
+    uint8_t palette[8] = {uint8_t(alpha0), uint8_t(alpha1)};
+    if(alpha0 > alpha1)
+    {
+        for(unsigned i = 1; i < 7; i++)
+        {
+            palette[1 + i] = uint8_t(((7 - i) * alpha0 + i * alpha1) / 7);
+        }
+    }
+    else
+    {
+        for(unsigned i = 1; i < 5; i++)
+        {
+            palette[1 + i] = uint8_t(((5 - i) * alpha0 + i * alpha1) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for(unsigned i = 0; i < 6; i++)
+    {
+        indices |= uint64_t(in[2 + i]) << (8 * i);
+    }
+    for(unsigned i = 0; i < 16; i++)
+    {
+        pixels[i][3] = palette[(indices >> (3 * i)) & 7u];
+    }
+}
+
+/// Compresses a `width`x`height` image with `channels` (3 = RGB -> BC1, 4 = RGBA -> BC3) 8-bit channels to `out`,
+/// which must be big enough for all of its blocks. Blocks on the edges repeat the last row/column of pixels.
+inline void CompressImage(const uint8_t *in, unsigned width, unsigned height, unsigned channels, uint8_t *out)
+{
+    uint8_t block[16][4];
+    for(unsigned by = 0; by < height; by += BLOCK_SIZE)
+    {
+        for(unsigned bx = 0; bx < width; bx += BLOCK_SIZE)
+        {
+            for(unsigned i = 0; i < 16; i++)
+            {
+                const unsigned x = std::min(bx + i % 4, width - 1), y = std::min(by + i / 4, height - 1);
+                const uint8_t *pixel = in + (size_t(y) * width + x) * channels;
+                block[i][0] = pixel[0];
+                block[i][1] = pixel[1];
+                block[i][2] = pixel[2];
+                block[i][3] = (channels == 4) ? pixel[3] : 255;
+            }
+            if(channels == 4)
+            {
+                EncodeAlphaBlock(block, out);
+                out += 8;
+            }
+            EncodeColorBlock(block, out);
+            out += BC1_BLOCK_BYTES;
+        }
+    }
+}
+
+/// Decompresses a `width`x`height` BC1 (`channels` = 3, to RGB8) or BC3 (`channels` = 4, to RGBA8) image to `out`.
+inline void DecompressImage(const uint8_t *in, unsigned width, unsigned height, unsigned channels, uint8_t *out)
+{
+    uint8_t block[16][4];
+    for(unsigned by = 0; by < height; by += BLOCK_SIZE)
+    {
+        for(unsigned bx = 0; bx < width; bx += BLOCK_SIZE)
+        {
+            if(channels == 4)
+            {
+                DecodeColorBlock(in + 8, block, true);
+                DecodeAlphaBlock(in, block);
+                in += BC3_BLOCK_BYTES;
+            }
+            else
+            {
+                DecodeColorBlock(in, block);
+                in += BC1_BLOCK_BYTES;
+            }
+            for(unsigned i = 0; i < 16; i++)
+            {
+                const unsigned x = bx + i % 4, y = by + i / 4;
+                if(x < width && y < height)
+                {
+                    std::memcpy(out + (size_t(y) * width + x) * channels, block[i], channels);
+                }
+            }
+        }
+    }
+}
+
+} // namespace bcn
+} // namespace boyd
@@ -0,0 +1,610 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace boyd
+{
+
+/// A minimal decoder for native FLAC streams (https://xiph.org/flac/format.html): "fLaC", metadata blocks, then
+/// frames of up to 8 channels and 24 bits per sample. Frame CRCs and the MD5 signature are not checked; frames that
+/// fail to decode are skipped by looking for the next frame header.
+/// The decoder only references the encoded data, which must outlive it. It can decode a frame at a time, or any number
+/// of interleaved 16-bit sample frames - so it can be used both to decode whole clips and to stream them.
+namespace flac
+{
+
+static constexpr unsigned MAX_CHANNELS = 8;
+static constexpr unsigned MAX_BITS_PER_SAMPLE = 24;
+
+/// The STREAMINFO metadata block.
+struct StreamInfo
+{
+    unsigned minBlockSize{0}, maxBlockSize{0}; ///< In samples (per channel)
+    unsigned sampleRate{0};
+    unsigned channels{0};
+    unsigned bitsPerSample{0};
+    uint64_t totalSamples{0}; ///< Samples per channel in the whole stream (0 = unknown)
+    uint8_t md5[16]{};        ///< MD5 signature of the unencoded samples
+};
+
+/// Reads bits MSB-first from a byte buffer, through a 64-bit cache.
+/// Reading past the end of the buffer yields zeros, and makes `Overrun()` true.
+class BitReader
+{
+public:
+    BitReader(const uint8_t *data, size_t size)
+        : data{data}, size{size}
+    {
+    }
+
+    /// Reads an unsigned `nBits`-bit value (`nBits` <= 32).
+    inline uint32_t Read(unsigned nBits)
+    {
+        if(nBits == 0)
+        {
+            return 0;
+        }
+        Refill();
+        const uint32_t value = uint32_t(cache >> (64 - nBits));
+        cache <<= nBits;
+        cacheBits -= nBits;
+        return value;
+    }
+
+    /// Reads a two's complement `nBits`-bit value (`nBits` <= 32).
+    inline int32_t ReadSigned(unsigned nBits)
+    {
+        if(nBits == 0)
+        {
+            return 0;
+        }
+        return int32_t(Read(nBits) << (32 - nBits)) >> (32 - nBits);
+    }
+
+    /// Reads an unary-coded value: the number of zeros before the next one.
+    inline uint32_t ReadUnary()
+    {
+        uint32_t count = 0;
+        for(;;)
+        {
+            Refill();
+            if(cache == 0)
+            {
+                count += cacheBits;
+                cacheBits = 0;
+                if(Overrun())
+                {
+                    return count;
+                }
+                continue;
+            }
+            const unsigned zeros = CountLeadingZeros(cache);
+            count += zeros;
+            cache = (zeros + 1 < 64) ? cache << (zeros + 1) : 0;
+            cacheBits -= zeros + 1;
+            return count;
+        }
+    }
+
+    /// Skips to the next byte boundary.
+    inline void AlignToByte()
+    {
+        Read(cacheBits % 8);
+    }
+
+    /// Returns the number of bytes read so far (rounded up).
+    inline size_t BytesRead() const
+    {
+        return (pos * 8 - cacheBits + 7) / 8;
+    }
+
+    /// Returns true if more bits were read than there are.
+    inline bool Overrun() const
+    {
+        return pos * 8 - cacheBits > size * 8;
+    }
+
+private:
+    const uint8_t *data;
+    size_t size;
+    size_t pos{0};          ///< Next byte to move into the cache
+    uint64_t cache{0};      ///< The next bits to read, MSB-aligned
+    unsigned cacheBits{0};  ///< Number of valid bits in `cache`
+
+    inline void Refill()
+    {
+        while(cacheBits <= 56)
+        {
+            const uint64_t byte = (pos < size) ? data[pos] : 0;
+            cache |= byte << (56 - cacheBits);
+            cacheBits += 8;
+            pos++;
+        }
+    }
+
+    static inline unsigned CountLeadingZeros(uint64_t value) // (`value` != 0)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return unsigned(__builtin_clzll(value));
+#else
+        unsigned count = 0;
+        for(; !(value & (uint64_t(1) << 63)); value <<= 1)
+        {
+            count++;
+        }
+        return count;
+#endif
+    }
+};
+
+/// Decodes a FLAC stream; see the `flac` namespace.
+class Decoder
+{
+public:
+    /// Parses the stream's metadata (only STREAMINFO is used) and gets ready to decode its first frame.
+    /// Returns false if `data` is not a FLAC stream, or if it is one that is not supported.
+    bool Open(const uint8_t *newData, size_t newSize)
+    {
+        static constexpr uint8_t MAGIC[] = {'f', 'L', 'a', 'C'};
+        static constexpr unsigned STREAMINFO = 0, STREAMINFO_SIZE = 34;
+
+        data = newData;
+        size = newSize;
+        if(size < sizeof(MAGIC) || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+        {
+            return false;
+        }
+
+        bool hasInfo = false;
+        size_t offset = sizeof(MAGIC);
+        for(bool last = false; !last;)
+        {
+            if(offset + 4 > size)
+            {
+                return false;
+            }
+            last = (data[offset] & 0x80) != 0;
+            const unsigned type = data[offset] & 0x7F;
+            const size_t length = (size_t(data[offset + 1]) << 16) | (size_t(data[offset + 2]) << 8) | data[offset + 3];
+            offset += 4;
+            if(length > size - offset)
+            {
+                return false;
+            }
+            if(type == STREAMINFO && length >= STREAMINFO_SIZE)
+            {
+                BitReader bits{data + offset, length};
+                info.minBlockSize = bits.Read(16);
+                info.maxBlockSize = bits.Read(16);
+                bits.Read(24); // (Min frame size)
+                bits.Read(24); // (Max frame size)
+                info.sampleRate = bits.Read(20);
+                info.channels = bits.Read(3) + 1;
+                info.bitsPerSample = bits.Read(5) + 1;
+                info.totalSamples = (uint64_t(bits.Read(4)) << 32) | bits.Read(32);
+                std::memcpy(info.md5, data + offset + 18, sizeof(info.md5));
+                hasInfo = true;
+            }
+            offset += length;
+        }
+        if(!hasInfo || info.sampleRate == 0 || info.bitsPerSample < 4 || info.bitsPerSample > MAX_BITS_PER_SAMPLE)
+        {
+            return false;
+        }
+
+        firstFrame = offset;
+        Rewind();
+        return true;
+    }
+
+    inline const StreamInfo &Info() const
+    {
+        return info;
+    }
+
+    /// Decodes the next frame. Returns its block size (= the number of `Samples()` per channel it decoded), or 0 at
+    /// the end of the stream.
+    unsigned DecodeFrame()
+    {
+        frameSize = frameRead = 0;
+        while(position < size)
+        {
+            size_t frameEnd;
+            if(DecodeFrameAt(position, frameEnd))
+            {
+                position = frameEnd;
+                return frameSize;
+            }
+
+            // Corrupt frame: resync to the next thing that looks like a frame header
+            // (14-bit sync code 0b11111111111110, then a reserved zero bit)
+            for(position++; position + 1 < size; position++)
+            {
+                if(data[position] == 0xFF && (data[position + 1] & 0xFE) == 0xF8)
+                {
+                    break;
+                }
+            }
+            if(position + 1 >= size)
+            {
+                position = size;
+            }
+        }
+        return 0;
+    }
+
+    /// The samples of the given channel decoded by the last `DecodeFrame()`, at the stream's bits per sample.
+    inline const int32_t *Samples(unsigned channel) const
+    {
+        return samples[channel].data();
+    }
+
+    /// Decodes up to `maxFrames` sample frames to `out`, as interleaved 16-bit samples.
+    /// Returns the number of sample frames decoded - less than `maxFrames` only at the end of the stream.
+    size_t Read(int16_t *out, size_t maxFrames)
+    {
+        const int shift = int(info.bitsPerSample) - 16;
+        size_t nDone = 0;
+        while(nDone < maxFrames)
+        {
+            if(frameRead == frameSize && DecodeFrame() == 0)
+            {
+                break;
+            }
+            const size_t nFrames = std::min(size_t(frameSize - frameRead), maxFrames - nDone);
+            for(unsigned channel = 0; channel < info.channels; channel++)
+            {
+                const int32_t *in = samples[channel].data() + frameRead;
+                int16_t *dst = out + nDone * info.channels + channel;
+                for(size_t i = 0; i < nFrames; i++)
+                {
+                    dst[i * info.channels] = int16_t(shift >= 0 ? in[i] >> shift : in[i] * (1 << -shift));
+                }
+            }
+            frameRead += unsigned(nFrames);
+            nDone += nFrames;
+        }
+        return nDone;
+    }
+
+    /// Skips up to `maxFrames` sample frames, like `Read()` but without converting them (the frames before are still
+    /// decoded: without a seek table, frame boundaries can't be told apart from the data).
+    /// Returns the number of sample frames skipped - less than `maxFrames` only at the end of the stream.
+    size_t Skip(size_t maxFrames)
+    {
+        size_t nDone = 0;
+        while(nDone < maxFrames)
+        {
+            if(frameRead == frameSize && DecodeFrame() == 0)
+            {
+                break;
+            }
+            const size_t nFrames = std::min(size_t(frameSize - frameRead), maxFrames - nDone);
+            frameRead += unsigned(nFrames);
+            nDone += nFrames;
+        }
+        return nDone;
+    }
+
+    /// Goes back to the first frame of the stream.
+    void Rewind()
+    {
+        position = firstFrame;
+        frameSize = frameRead = 0;
+    }
+
+private:
+    const uint8_t *data{nullptr};
+    size_t size{0};
+    StreamInfo info;
+    size_t firstFrame{0}; ///< Offset of the first frame in `data`
+    size_t position{0};   ///< Offset of the next frame to decode in `data`
+
+    std::vector<int32_t> samples[MAX_CHANNELS]; ///< The last frame decoded, per channel
+    unsigned frameSize{0};                      ///< Samples per channel in `samples`
+    unsigned frameRead{0};                      ///< Samples per channel in `samples` already returned by `Read()`
+
+    /// Decodes the frame at `offset` to `samples`; sets `frameEnd` to the offset of the byte after it.
+    /// Returns false if the frame is corrupt, or unsupported.
+    bool DecodeFrameAt(size_t offset, size_t &frameEnd)
+    {
+        static constexpr unsigned LEFT_SIDE = 8, SIDE_RIGHT = 9, MID_SIDE = 10;
+        static constexpr unsigned SAMPLE_SIZES[] = {0, 8, 12, 0, 16, 20, 24, 0}; // (0 = STREAMINFO's or invalid)
+
+        BitReader bits{data + offset, size - offset};
+        if(bits.Read(15) != 0x7FFC) // (14-bit sync code + reserved zero)
+        {
+            return false;
+        }
+        bits.Read(1); // (Blocking strategy)
+        const unsigned blockSizeCode = bits.Read(4), sampleRateCode = bits.Read(4);
+        const unsigned channelsCode = bits.Read(4), sampleSizeCode = bits.Read(3);
+        if(bits.Read(1) != 0 || blockSizeCode == 0 || sampleRateCode == 15 || channelsCode > MID_SIDE
+           || sampleSizeCode == 3 || sampleSizeCode == 7)
+        {
+            return false;
+        }
+
+        // Frame/sample number, UTF-8-like coded; only skipped
+        const uint32_t firstByte = bits.Read(8);
+        unsigned nExtraBytes = 0;
+        for(uint32_t mask = 0x80; firstByte & mask; mask >>= 1)
+        {
+            nExtraBytes++;
+        }
+        if(nExtraBytes == 1 || nExtraBytes > 7)
+        {
+            return false;
+        }
+        for(unsigned i = 1; i < nExtraBytes; i++)
+        {
+            if((bits.Read(8) & 0xC0) != 0x80)
+            {
+                return false;
+            }
+        }
+
+        unsigned blockSize;
+        if(blockSizeCode == 1)
+        {
+            blockSize = 192;
+        }
+        else if(blockSizeCode <= 5)
+        {
+            blockSize = 576u << (blockSizeCode - 2);
+        }
+        else if(blockSizeCode == 6)
+        {
+            blockSize = bits.Read(8) + 1;
+        }
+        else if(blockSizeCode == 7)
+        {
+            blockSize = bits.Read(16) + 1;
+        }
+        else
+        {
+            blockSize = 256u << (blockSizeCode - 8);
+        }
+        if(sampleRateCode == 12)
+        {
+            bits.Read(8); // (Sample rates are taken from STREAMINFO)
+        }
+        else if(sampleRateCode == 13 || sampleRateCode == 14)
+        {
+            bits.Read(16);
+        }
+        bits.Read(8); // (CRC-8)
+
+        const unsigned nChannels = (channelsCode < LEFT_SIDE) ? channelsCode + 1 : 2;
+        const unsigned bitsPerSample = (sampleSizeCode == 0) ? info.bitsPerSample : SAMPLE_SIZES[sampleSizeCode];
+        if(nChannels != info.channels || bitsPerSample != info.bitsPerSample)
+        {
+            return false;
+        }
+
+        for(unsigned channel = 0; channel < nChannels; channel++)
+        {
+            // (The side channel has one more bit than the others)
+            const bool isSide = (channelsCode == LEFT_SIDE && channel == 1)
+                                || (channelsCode == SIDE_RIGHT && channel == 0)
+                                || (channelsCode == MID_SIDE && channel == 1);
+            samples[channel].resize(std::max(samples[channel].size(), size_t(blockSize)));
+            if(!DecodeSubframe(bits, samples[channel].data(), blockSize, bitsPerSample + (isSide ? 1 : 0)))
+            {
+                return false;
+            }
+        }
+        bits.AlignToByte();
+        bits.Read(16); // (CRC-16)
+        if(bits.Overrun())
+        {
+            return false;
+        }
+
+        // Undo inter-channel decorrelation
+        int32_t *left = samples[0].data(), *right = (nChannels > 1) ? samples[1].data() : nullptr;
+        switch(channelsCode)
+        {
+        case LEFT_SIDE: // (right = left - side)
+            for(unsigned i = 0; i < blockSize; i++)
+            {
+                right[i] = left[i] - right[i];
+            }
+            break;
+        case SIDE_RIGHT: // (left = side + right)
+            for(unsigned i = 0; i < blockSize; i++)
+            {
+                left[i] += right[i];
+            }
+            break;
+        case MID_SIDE:
+            for(unsigned i = 0; i < blockSize; i++)
+            {
+                const int64_t side = right[i];
+                const int64_t mid = (int64_t(left[i]) * 2) | (side & 1);
+                left[i] = int32_t((mid + side) >> 1);
+                right[i] = int32_t((mid - side) >> 1);
+            }
+            break;
+        default: // (Independent channels)
+            break;
+        }
+
+        frameSize = blockSize;
+        frameEnd = offset + bits.BytesRead();
+        return true;
+    }
+
+    /// Decodes a subframe of `blockSize` samples, each `bitsPerSample` bits, to `out`.
+    static bool DecodeSubframe(BitReader &bits, int32_t *out, unsigned blockSize, unsigned bitsPerSample)
+    {
+        static constexpr unsigned MAX_LPC_ORDER = 32;
+
+        if(bits.Read(1) != 0)
+        {
+            return false;
+        }
+        const unsigned type = bits.Read(6);
+        unsigned wastedBits = 0;
+        if(bits.Read(1))
+        {
+            wastedBits = bits.ReadUnary() + 1;
+        }
+        if(wastedBits >= bitsPerSample)
+        {
+            return false;
+        }
+        bitsPerSample -= wastedBits;
+
+        if(type == 0) // Constant
+        {
+            std::fill(out, out + blockSize, bits.ReadSigned(bitsPerSample));
+        }
+        else if(type == 1) // Verbatim
+        {
+            for(unsigned i = 0; i < blockSize; i++)
+            {
+                out[i] = bits.ReadSigned(bitsPerSample);
+            }
+        }
+        else if(type >= 8 && type <= 12) // Fixed predictor
+        {
+            const unsigned order = type - 8;
+            if(!DecodeWarmup(bits, out, blockSize, order, bitsPerSample)
+               || !DecodeResidual(bits, out, blockSize, order))
+            {
+                return false;
+            }
+            for(unsigned i = order; i < blockSize; i++)
+            {
+                int64_t prediction = 0;
+                switch(order)
+                {
+                case 1:
+                    prediction = out[i - 1];
+                    break;
+                case 2:
+                    prediction = 2 * int64_t(out[i - 1]) - out[i - 2];
+                    break;
+                case 3:
+                    prediction = 3 * (int64_t(out[i - 1]) - out[i - 2]) + out[i - 3];
+                    break;
+                case 4:
+                    prediction = 4 * (int64_t(out[i - 1]) + out[i - 3]) - 6 * int64_t(out[i - 2]) - out[i - 4];
+                    break;
+                default:
+                    break;
+                }
+                out[i] = int32_t(out[i] + prediction);
+            }
+        }
+        else if(type >= 32) // LPC
+        {
+            const unsigned order = (type & 31) + 1;
+            if(!DecodeWarmup(bits, out, blockSize, order, bitsPerSample))
+            {
+                return false;
+            }
+            const unsigned precision = bits.Read(4) + 1;
+            const int shift = bits.ReadSigned(5);
+            if(precision == 16 || shift < 0)
+            {
+                return false;
+            }
+            int32_t coefficients[MAX_LPC_ORDER];
+            for(unsigned j = 0; j < order; j++)
+            {
+                coefficients[j] = bits.ReadSigned(precision);
+            }
+            if(!DecodeResidual(bits, out, blockSize, order))
+            {
+                return false;
+            }
+            for(unsigned i = order; i < blockSize; i++)
+            {
+                int64_t sum = 0;
+                for(unsigned j = 0; j < order; j++)
+                {
+                    sum += int64_t(coefficients[j]) * out[i - 1 - j];
+                }
+                out[i] = int32_t(out[i] + (sum >> shift));
+            }
+        }
+        else
+        {
+            return false; // (Reserved)
+        }
+
+        if(wastedBits > 0)
+        {
+            for(unsigned i = 0; i < blockSize; i++)
+            {
+                out[i] = int32_t(uint32_t(out[i]) << wastedBits);
+            }
+        }
+        return true;
+    }
+
+    /// Reads the `order` unencoded samples that a predictor starts from.
+    static bool DecodeWarmup(BitReader &bits, int32_t *out, unsigned blockSize, unsigned order, unsigned bitsPerSample)
+    {
+        if(order > blockSize)
+        {
+            return false;
+        }
+        for(unsigned i = 0; i < order; i++)
+        {
+            out[i] = bits.ReadSigned(bitsPerSample);
+        }
+        return true;
+    }
+
+    /// Decodes the Rice-coded prediction residual of a subframe to `out[order..blockSize)`.
+    static bool DecodeResidual(BitReader &bits, int32_t *out, unsigned blockSize, unsigned order)
+    {
+        const unsigned method = bits.Read(2);
+        if(method > 1)
+        {
+            return false;
+        }
+        const unsigned parameterBits = (method == 0) ? 4 : 5, escape = (method == 0) ? 15 : 31;
+        const unsigned partitionOrder = bits.Read(4);
+        const unsigned partitionSize = blockSize >> partitionOrder;
+        if((partitionSize << partitionOrder) != blockSize || partitionSize < order)
+        {
+            return false;
+        }
+
+        unsigned i = order;
+        for(unsigned partition = 0; partition < (1u << partitionOrder); partition++)
+        {
+            const unsigned parameter = bits.Read(parameterBits);
+            const unsigned end = (partition + 1) * partitionSize;
+            if(parameter == escape)
+            {
+                const unsigned rawBits = bits.Read(5);
+                for(; i < end; i++)
+                {
+                    out[i] = bits.ReadSigned(rawBits);
+                }
+                continue;
+            }
+            for(; i < end; i++)
+            {
+                const uint32_t value = (bits.ReadUnary() << parameter) | bits.Read(parameter);
+                out[i] = int32_t(value >> 1) ^ -int32_t(value & 1); // (Zigzag-decode)
+            }
+            if(bits.Overrun())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace flac
+} // namespace boyd
@@ -4,6 +4,9 @@
 #include <array>
 #include <atomic>
 #include <entt/entt.hpp>
+#include <functional>
+#include <mutex>
+#include <vector>
 
 namespace boyd
 {
@@ -60,6 +63,39 @@ struct BOYD_API GameState
         : running{true}, ecs{}
     {
     }
+
+    /// A change to the ECS that was deferred; see `Defer()`.
+    using DeferredCommand = std::function<void(entt::registry &)>;
+
+    /// Queues `command` to be run on the main thread once all modules have been updated this frame, while none of them
+    /// is running. This lets a module make changes that conflict with what other modules access - e.g. destroy
+    /// entities, or write components that others read - without declaring them in its `ModuleAccess`, so that it can
+    /// still be updated concurrently with those modules. Thread-safe.
+    void Defer(DeferredCommand command)
+    {
+        std::lock_guard<std::mutex> lock{deferredMutex};
+        deferred.push_back(std::move(command));
+    }
+
+    /// Runs all deferred commands, in the order they were queued. Called by the module scheduler.
+    void RunDeferred()
+    {
+        // (Swapped out first, so that commands can defer other commands - to the next frame)
+        {
+            std::lock_guard<std::mutex> lock{deferredMutex};
+            flushing.swap(deferred);
+        }
+        for(auto &command : flushing)
+        {
+            command(ecs);
+        }
+        flushing.clear();
+    }
+
+private:
+    std::mutex deferredMutex;
+    std::vector<DeferredCommand> deferred; ///< (Guarded by `deferredMutex`)
+    std::vector<DeferredCommand> flushing; ///< (Kept between frames so that it does not reallocate)
 };
 
 /// A singleton used to manage a `GameState`.
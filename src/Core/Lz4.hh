@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace boyd
+{
+
+/// A minimal implementation of the LZ4 *block* format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md):
+/// data compressed here can be decompressed by the reference implementation's `LZ4_decompress_safe()` and vice versa.
+/// Compression is greedy and single-pass - it is meant to be used offline, so it favours simplicity over speed.
+namespace lz4
+{
+
+static constexpr size_t MIN_MATCH = 4;
+static constexpr size_t LAST_LITERALS = 5; ///< The last bytes of a block are always literals
+static constexpr size_t MF_LIMIT = 12;     ///< The last match must start at least this many bytes before the end
+static constexpr size_t MAX_OFFSET = 65535;
+
+/// Returns an upper bound of the size of `size` bytes once compressed.
+inline size_t CompressBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+/// Compresses the `size` bytes at `in`, returning the compressed block.
+inline std::vector<uint8_t> Compress(const uint8_t *in, size_t size)
+{
+    static constexpr unsigned HASH_BITS = 16;
+    static constexpr size_t NONE = size_t(-1);
+
+    std::vector<uint8_t> out;
+    out.reserve(CompressBound(size));
+
+    auto writeLength = [&out](size_t length) {
+        for(; length >= 255; length -= 255)
+        {
+            out.push_back(255);
+        }
+        out.push_back(uint8_t(length));
+    };
+    // Emits a sequence: the literals in [literalsBegin, literalsEnd) followed by a match (if `matchLength` > 0)
+    auto emitSequence = [&](size_t literalsBegin, size_t literalsEnd, size_t offset, size_t matchLength) {
+        const size_t nLiterals = literalsEnd - literalsBegin;
+        const size_t tokenPos = out.size();
+        out.push_back(0);
+        uint8_t token = uint8_t(std::min<size_t>(nLiterals, 15) << 4);
+        if(nLiterals >= 15)
+        {
+            writeLength(nLiterals - 15);
+        }
+        out.insert(out.end(), in + literalsBegin, in + literalsEnd);
+        if(matchLength > 0)
+        {
+            out.push_back(uint8_t(offset & 0xFF));
+            out.push_back(uint8_t(offset >> 8));
+            const size_t extraLength = matchLength - MIN_MATCH;
+            token |= uint8_t(std::min<size_t>(extraLength, 15));
+            if(extraLength >= 15)
+            {
+                writeLength(extraLength - 15);
+            }
+        }
+        out[tokenPos] = token;
+    };
+
+    size_t anchor = 0; // Start of the pending literals
+    if(size > MF_LIMIT)
+    {
+        auto hash = [in](size_t pos) {
+            uint32_t value;
+            std::memcpy(&value, in + pos, sizeof(value));
+            return (value * 2654435761u) >> (32 - HASH_BITS);
+        };
+        std::vector<size_t> lastSeen(size_t(1) << HASH_BITS, NONE); // 4-byte sequence hash -> last position
+        const size_t matchEndLimit = size - LAST_LITERALS;
+
+        for(size_t pos = 0; pos < size - MF_LIMIT;)
+        {
+            const uint32_t h = hash(pos);
+            const size_t candidate = lastSeen[h];
+            lastSeen[h] = pos;
+            if(candidate == NONE || pos - candidate > MAX_OFFSET
+               || std::memcmp(in + candidate, in + pos, MIN_MATCH) != 0)
+            {
+                pos++;
+                continue;
+            }
+
+            size_t matchLength = MIN_MATCH;
+            while(pos + matchLength < matchEndLimit && in[candidate + matchLength] == in[pos + matchLength])
+            {
+                matchLength++;
+            }
+            emitSequence(anchor, pos, pos - candidate, matchLength);
+            pos += matchLength;
+            anchor = pos;
+        }
+    }
+    emitSequence(anchor, size, 0, 0); // (Last sequence: literals only)
+    return out;
+}
+
+/// Decompresses the `inSize` bytes block at `in` to the `outSize` bytes at `out`.
+/// Returns false if the block is corrupt or if it does not decompress to exactly `outSize` bytes.
+inline bool Decompress(const uint8_t *in, size_t inSize, uint8_t *out, size_t outSize)
+{
+    const uint8_t *ip = in;
+    const uint8_t *const inEnd = in + inSize;
+    uint8_t *op = out;
+    uint8_t *const outEnd = out + outSize;
+
+    auto readLength = [&](size_t &length) -> bool {
+        if(length == 15)
+        {
+            uint8_t byte;
+            do
+            {
+                if(ip >= inEnd)
+                {
+                    return false;
+                }
+                byte = *ip++;
+                length += byte;
+            } while(byte == 255);
+        }
+        return true;
+    };
+
+    while(ip < inEnd)
+    {
+        const uint8_t token = *ip++;
+
+        size_t nLiterals = token >> 4;
+        if(!readLength(nLiterals) || nLiterals > size_t(inEnd - ip) || nLiterals > size_t(outEnd - op))
+        {
+            return false;
+        }
+        if(nLiterals > 0)
+        {
+            std::memcpy(op, ip, nLiterals);
+        }
+        ip += nLiterals;
+        op += nLiterals;
+        if(ip == inEnd)
+        {
+            break; // (The last sequence has no match)
+        }
+
+        if(inEnd - ip < 2)
+        {
+            return false;
+        }
+        const size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+        ip += 2;
+        size_t matchLength = token & 0x0F;
+        if(!readLength(matchLength))
+        {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if(offset == 0 || offset > size_t(op - out) || matchLength > size_t(outEnd - op))
+        {
+            return false;
+        }
+
+        // NOTE: Matches can overlap the bytes they produce (e.g. offset 1 = run of the same byte), so copy bytewise
+        const uint8_t *match = op - offset;
+        for(size_t i = 0; i < matchLength; i++)
+        {
+            op[i] = match[i];
+        }
+        op += matchLength;
+    }
+    return op == outEnd;
+}
+
+} // namespace lz4
+} // namespace boyd
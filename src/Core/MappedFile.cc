@@ -0,0 +1,130 @@
+#include "MappedFile.hh"
+
+#include <fstream>
+
+#if defined(BOYD_PLATFORM_POSIX)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#elif defined(BOYD_PLATFORM_WIN32)
+#    define WIN32_LEAN_AND_MEAN
+#    define NOMINMAX
+#    include <Windows.h>
+#endif
+
+namespace boyd
+{
+
+bool MappedFile::Open(const std::string &filepath)
+{
+    Close();
+
+#if defined(BOYD_PLATFORM_POSIX)
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        return false;
+    }
+    struct stat fileStat;
+    if(::fstat(fd, &fileStat) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    size = size_t(fileStat.st_size);
+    if(size > 0)
+    {
+        void *mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped == MAP_FAILED)
+        {
+            ::close(fd);
+            size = 0;
+            return false;
+        }
+        data = static_cast<const uint8_t *>(mapped);
+    }
+    ::close(fd); // (The mapping keeps the file alive)
+
+#elif defined(BOYD_PLATFORM_WIN32)
+    file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        file = nullptr;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize))
+    {
+        Close();
+        return false;
+    }
+    size = size_t(fileSize.QuadPart);
+    if(size > 0)
+    {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void *mapped = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if(!mapped)
+        {
+            Close();
+            return false;
+        }
+        data = static_cast<const uint8_t *>(mapped);
+    }
+
+#else
+    std::ifstream infile{filepath, std::ios::binary};
+    if(!infile)
+    {
+        return false;
+    }
+    infile.seekg(0, infile.end);
+    buffer.resize(size_t(infile.tellg()));
+    infile.seekg(0, infile.beg);
+    infile.read(reinterpret_cast<char *>(buffer.data()), std::streamsize(buffer.size()));
+    if(!infile)
+    {
+        buffer.clear();
+        return false;
+    }
+    data = buffer.data();
+    size = buffer.size();
+#endif
+
+    open = true;
+    return true;
+}
+
+void MappedFile::Close()
+{
+#if defined(BOYD_PLATFORM_POSIX)
+    if(data)
+    {
+        ::munmap(const_cast<uint8_t *>(data), size);
+    }
+#elif defined(BOYD_PLATFORM_WIN32)
+    if(data)
+    {
+        UnmapViewOfFile(data);
+    }
+    if(mapping)
+    {
+        CloseHandle(mapping);
+        mapping = nullptr;
+    }
+    if(file)
+    {
+        CloseHandle(file);
+        file = nullptr;
+    }
+#else
+    buffer.clear();
+    buffer.shrink_to_fit();
+#endif
+    data = nullptr;
+    size = 0;
+    open = false;
+}
+
+} // namespace boyd
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Platform.hh"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// (The platform-specific code is in MappedFile.cc, so that this header does not pull <Windows.h> - and its min/max
+// macros - into everything that reads files)
+
+namespace boyd
+{
+
+/// A read-only view of the whole contents of a file.
+/// The file is memory-mapped where possible, so that its pages are loaded on demand (and can be evicted by the OS)
+/// instead of being copied to the heap; elsewhere (e.g. on Emscripten) it is simply read to memory.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string &filepath)
+    {
+        Open(filepath);
+    }
+
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    MappedFile(const MappedFile &toCopy) = delete;
+    MappedFile &operator=(const MappedFile &toCopy) = delete;
+
+    MappedFile(MappedFile &&toMove) noexcept
+    {
+        *this = std::move(toMove);
+    }
+    MappedFile &operator=(MappedFile &&toMove) noexcept
+    {
+        if(this != &toMove)
+        {
+            Close();
+            std::swap(data, toMove.data);
+            std::swap(size, toMove.size);
+            std::swap(open, toMove.open);
+#if defined(BOYD_PLATFORM_WIN32)
+            std::swap(file, toMove.file);
+            std::swap(mapping, toMove.mapping);
+#elif !defined(BOYD_PLATFORM_POSIX)
+            std::swap(buffer, toMove.buffer);
+#endif
+        }
+        return *this;
+    }
+
+    /// Maps the file at `filepath`, closing the previous one (if any). Returns false on error.
+    bool Open(const std::string &filepath);
+
+    /// Unmaps the file (if any). All pointers to its data are invalidated.
+    void Close();
+
+    inline bool IsOpen() const
+    {
+        return open;
+    }
+
+    /// The contents of the file (null if it is empty or not open).
+    inline const uint8_t *Data() const
+    {
+        return data;
+    }
+
+    inline size_t Size() const
+    {
+        return size;
+    }
+
+private:
+    const uint8_t *data{nullptr};
+    size_t size{0};
+    bool open{false};
+#if defined(BOYD_PLATFORM_WIN32)
+    void *file{nullptr};    ///< (A HANDLE)
+    void *mapping{nullptr}; ///< (A HANDLE)
+#elif !defined(BOYD_PLATFORM_POSIX)
+    std::vector<uint8_t> buffer;
+#endif
+};
+
+} // namespace boyd
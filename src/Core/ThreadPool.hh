@@ -0,0 +1,150 @@
+#pragma once
+
+#include "Platform.hh"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace boyd
+{
+
+/// A fixed-size pool of worker threads that execute jobs in FIFO order.
+class ThreadPool
+{
+public:
+    using Job = std::function<void()>;
+
+    /// Starts `nThreads` worker threads.
+    /// A pool with zero threads is valid: `Submit()` will then run every job inline on the calling thread.
+    explicit ThreadPool(unsigned nThreads)
+        : running{true}
+    {
+        workers.reserve(nThreads);
+        for(unsigned i = 0; i < nThreads; i++)
+        {
+            workers.emplace_back(&ThreadPool::WorkerLoop, this);
+        }
+    }
+
+    /// Waits for all jobs that were already submitted to finish, then stops all workers.
+    ~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock{jobsMutex};
+            running = false;
+        }
+        jobsCondVar.notify_all();
+        for(auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &toCopy) = delete;
+    ThreadPool &operator=(const ThreadPool &toCopy) = delete;
+    ThreadPool(ThreadPool &&toMove) = delete;
+    ThreadPool &operator=(ThreadPool &&toMove) = delete;
+
+    /// Enqueues a job to be run by one of the workers.
+    void Submit(Job job)
+    {
+        if(workers.empty())
+        {
+            job();
+            return;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock{jobsMutex};
+            jobs.push_back(std::move(job));
+        }
+        jobsCondVar.notify_one();
+    }
+
+    /// Returns the number of worker threads in the pool.
+    inline unsigned Size() const
+    {
+        return unsigned(workers.size());
+    }
+
+    /// Returns the number of worker threads to use when `requested` is zero (= "auto"):
+    /// one per hardware thread, minus the one that is running the main loop.
+    static unsigned DefaultSize(unsigned requested = 0)
+    {
+        if(requested > 0)
+        {
+            return requested;
+        }
+        unsigned nHwThreads = std::thread::hardware_concurrency();
+        return nHwThreads > 1 ? nHwThreads - 1 : 0;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    bool running; // NOTE: Guarded by `jobsMutex`
+
+    std::deque<Job> jobs;
+    std::mutex jobsMutex;
+    std::condition_variable jobsCondVar;
+
+    void WorkerLoop()
+    {
+        for(;;)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock{jobsMutex};
+                jobsCondVar.wait(lock, [this]() {
+                    return !running || !jobs.empty();
+                });
+                if(jobs.empty())
+                {
+                    return; // (Not running anymore and nothing left to do)
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+
+/// Calls `function(i)` for every `i` in [0, `count`), spread over `nThreads` threads (the calling one included), and
+/// returns when all calls are done. Indices are handed out one by one, so uneven amounts of work per index are fine.
+/// Meant to split up a single heavy job - e.g. on a loader thread, which can't wait on jobs it submits to its own
+/// pool; threads are started on every call, so only use it for work that takes way longer than that.
+template <typename TFunction>
+inline void ParallelFor(size_t count, unsigned nThreads, TFunction &&function)
+{
+#ifdef BOYD_PLATFORM_EMSCRIPTEN
+    nThreads = 1; // (No threads to spare on the web)
+#endif
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for(size_t i = next++; i < count; i = next++)
+        {
+            function(i);
+        }
+    };
+
+    std::vector<std::thread> helpers;
+    const size_t nHelpers = (count > 0) ? std::min(size_t(std::max(nThreads, 1u)), count) - 1 : 0;
+    helpers.reserve(nHelpers);
+    for(size_t i = 0; i < nHelpers; i++)
+    {
+        helpers.emplace_back(work);
+    }
+    work();
+    for(auto &helper : helpers)
+    {
+        helper.join();
+    }
+}
+
+} // namespace boyd
@@ -36,6 +36,39 @@ public:
     {
     }
 
+    /// A non-owning reference to the data of a `Versioned<T>`; does not keep the data alive.
+    class Weak
+    {
+        std::weak_ptr<Data> data;
+
+    public:
+        Weak() = default;
+        Weak(const Versioned &versioned)
+            : data{versioned.data}
+        {
+        }
+
+        /// Returns true if the data was destroyed (or if this never referenced any).
+        inline bool Expired() const
+        {
+            return data.expired();
+        }
+
+        /// Returns a `Versioned` that (strongly) references the data, or a null one if the data was destroyed.
+        inline Versioned Lock() const
+        {
+            Versioned versioned;
+            versioned.data = data.lock();
+            return versioned;
+        }
+
+        /// Returns true if this references the same data as `versioned`.
+        inline bool Refers(const Versioned &versioned) const
+        {
+            return !data.owner_before(versioned.data) && !versioned.data.owner_before(data);
+        }
+    };
+
     /// Constructs a new `T` from the given `TArgs`, wrapping it in a `Versioned<T>` with version=1.
     template <typename... TArgs>
     static Versioned<T> Make(TArgs &&... args)
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "Archive.hh"
+#include "Lz4.hh"
+#include "MappedFile.hh"
+#include "Platform.hh"
+
+#include <BoydEngine.hh>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace boyd
+{
+
+/// A read-only view of the contents of a file opened via the `Vfs`.
+/// Copies share `owner`, which keeps whatever the contents live in (a mapped file or archive, a decompressed buffer)
+/// alive; make a `std::shared_ptr` alias of it to keep referencing part of the contents after the view is gone.
+struct FileView
+{
+    const uint8_t *data{nullptr};
+    size_t size{0};
+    std::shared_ptr<const void> owner; ///< (Null if the file could not be opened)
+
+    inline explicit operator bool() const
+    {
+        return owner != nullptr;
+    }
+};
+
+/// Identifies a version of a file in the `Vfs`: when the file changes (or gets packed, or unpacked...) so does its stamp.
+struct FileStamp
+{
+    uint64_t archive{0};  ///< Id of the mounted archive that the file is packed in (0 for a loose file)
+    uint64_t position{0}; ///< Offset of the file in its archive, or last write time of the loose file (in clock ticks)
+    uint64_t size{0};     ///< Size of the file (once decompressed)
+
+    inline bool operator==(const FileStamp &other) const
+    {
+        return archive == other.archive && position == other.position && size == other.size;
+    }
+    inline bool operator!=(const FileStamp &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+/// Global (singleton) virtual filesystem that all asset loaders read files through.
+/// Files are looked up in the mounted archives first (the most recently mounted first), then on disk - relative to
+/// `BOYD_FS_PREFIX` - so that loose files can always be used for assets that are not packed (yet).
+/// Thread-safe.
+class BOYD_API Vfs
+{
+private:
+    Vfs() = default;
+
+    Vfs(const Vfs &toCopy) = delete;
+    Vfs &operator=(const Vfs &toCopy) = delete;
+    Vfs(Vfs &&toMove) = delete;
+    Vfs &operator=(Vfs &&toMove) = delete;
+
+public:
+    ~Vfs() = default;
+
+    static Vfs &instance()
+    {
+        static Vfs inst;
+        return inst;
+    }
+
+    /// Mounts the archive at `filepath` (an actual path on disk). Returns false if it is missing or invalid.
+    bool Mount(const std::string &filepath)
+    {
+        auto archive = std::make_shared<Archive>();
+        if(!archive->Open(filepath))
+        {
+            return false;
+        }
+        std::unique_lock<std::shared_mutex> lock{mutex};
+        archives.insert(archives.begin(), MountedArchive{std::move(archive), nextMountId++});
+        return true;
+    }
+
+    /// Unmounts all archives. (Files that were already opened from them stay valid)
+    void UnmountAll()
+    {
+        std::unique_lock<std::shared_mutex> lock{mutex};
+        archives.clear();
+    }
+
+    /// Opens the file at `filepath`. Returns a null view on error.
+    FileView Open(const std::string &filepath) const
+    {
+        {
+            const std::string path = pak::NormalizePath(filepath);
+            std::shared_lock<std::shared_mutex> lock{mutex};
+            for(const auto &mounted : archives)
+            {
+                if(const auto *entry = mounted.archive->Find(path))
+                {
+                    return OpenEntry(*mounted.archive, *entry);
+                }
+            }
+        }
+
+        auto file = std::make_shared<MappedFile>();
+        if(!file->Open(BOYD_FS_PREFIX + filepath))
+        {
+            return {};
+        }
+        return {file->Data(), file->Size(), file};
+    }
+
+    /// Gets the stamp of the file at `filepath` - the same file that `Open(filepath)` would open - without opening it.
+    /// Returns false if there is no such file.
+    bool Stat(const std::string &filepath, FileStamp &outStamp) const
+    {
+        {
+            const std::string path = pak::NormalizePath(filepath);
+            std::shared_lock<std::shared_mutex> lock{mutex};
+            for(const auto &mounted : archives)
+            {
+                if(const auto *entry = mounted.archive->Find(path))
+                {
+                    outStamp = {mounted.id, entry->offset, entry->size};
+                    return true;
+                }
+            }
+        }
+
+        const std::string diskPath = BOYD_FS_PREFIX + filepath;
+        std::error_code err;
+        const auto mtime = std::filesystem::last_write_time(diskPath, err);
+        const auto size = err ? 0 : std::filesystem::file_size(diskPath, err);
+        if(err)
+        {
+            return false;
+        }
+        outStamp = {0, uint64_t(mtime.time_since_epoch().count()), uint64_t(size)};
+        return true;
+    }
+
+    /// Reads a whole (text) file to `buffer`. Returns false on error.
+    bool Slurp(const std::string &filepath, std::string &buffer) const
+    {
+        FileView view = Open(filepath);
+        if(!view)
+        {
+            return false;
+        }
+        buffer.assign(reinterpret_cast<const char *>(view.data), view.size);
+        return true;
+    }
+
+private:
+    struct MountedArchive
+    {
+        std::shared_ptr<const Archive> archive;
+        uint64_t id; ///< Unique per mount, so that files packed in a remounted archive get new `FileStamp`s
+    };
+
+    mutable std::shared_mutex mutex;
+    std::vector<MountedArchive> archives; ///< (Most recently mounted first)
+    uint64_t nextMountId{1};
+
+    static FileView OpenEntry(const Archive &archive, const pak::Entry &entry)
+    {
+        if(entry.compression == pak::Compression::None)
+        {
+            // Point right into the mapped archive
+            return {archive.StoredData(entry), size_t(entry.size), archive.File()};
+        }
+
+        auto buffer = std::make_shared<std::vector<uint8_t>>(size_t(entry.size));
+        if(!lz4::Decompress(archive.StoredData(entry), size_t(entry.storedSize), buffer->data(), buffer->size()))
+        {
+            return {};
+        }
+        return {buffer->data(), buffer->size(), buffer};
+    }
+};
+
+} // namespace boyd
@@ -13,7 +13,7 @@
 #include "Debug/Log.hh"
 
 // clang-format off
-#define BOYD_MODULE(name, priority) \
+#define BOYD_MODULE(name, priority, reads, writes, mainThread) \
     extern "C" { \
         BOYD_API void *BoydInit_##name(void); \
         BOYD_API void  BoydUpdate_##name(void *); \
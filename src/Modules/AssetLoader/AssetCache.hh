@@ -0,0 +1,172 @@
+#pragma once
+
+#include <chrono>
+#include <entt/entt.hpp>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "../../Core/Vfs.hh"
+#include "../../Debug/Log.hh"
+#include "LoadedAsset.hh"
+#include "Loader.hh"
+
+namespace boyd
+{
+
+/// A cache of loaded assets, keyed by <component type, filepath>.
+///
+/// All requests for the same asset get the same `LoadedAssetBase`, so all entities that load it end up sharing
+/// its data (e.g. the same `Versioned<Mesh::Data>`). Entries are invalidated when the file changes - in an archive or
+/// on disk, see `Vfs::Stat()` -, and evicted by `CollectGarbage()` once no component references their data anymore.
+///
+/// Thread-safe.
+class AssetCache
+{
+public:
+    using AssetPtr = std::shared_ptr<LoadedAssetBase>;
+
+    AssetCache() = default;
+    ~AssetCache() = default;
+
+    AssetCache(const AssetCache &toCopy) = delete;
+    AssetCache &operator=(const AssetCache &toCopy) = delete;
+
+    /// Returns the asset of type `typeId` cached for `filepath` - or, if it is not cached or the file has changed since,
+    /// loads it via `loader` and caches it. If the same asset is already being loaded by another thread, waits for it.
+    /// Returns null on loading error.
+    AssetPtr GetOrLoad(ENTT_ID_TYPE typeId, const std::string &filepath, LoaderFunc loader)
+    {
+        FileStamp stamp;
+        if(!Vfs::instance().Stat(filepath, stamp))
+        {
+            // Can't tell if the file changed; don't cache it (the loader will most likely fail anyways)
+            return Load(loader, filepath);
+        }
+
+        Key key{typeId, filepath};
+        std::promise<AssetPtr> promise;
+        std::shared_future<AssetPtr> future;
+        uint64_t generation;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            auto entryIt = entries.find(key);
+            if(entryIt != entries.end() && entryIt->second.stamp == stamp)
+            {
+                future = entryIt->second.asset;
+                lock.unlock();
+                return future.get(); // (Cache hit; might have to wait for another thread to finish loading it)
+            }
+            future = promise.get_future().share();
+            generation = nextGeneration++;
+            entries[key] = Entry{stamp, future, generation};
+        }
+
+        AssetPtr asset = Load(loader, filepath); // (Never throws: the promise must be fulfilled for the waiters)
+        promise.set_value(asset);
+
+        if(!asset || asset->ReferenceCount() == 0)
+        {
+            // Nothing to share - no point in keeping it around
+            std::unique_lock<std::mutex> lock{mutex};
+            auto entryIt = entries.find(key);
+            if(entryIt != entries.end() && entryIt->second.generation == generation)
+            {
+                entries.erase(entryIt);
+            }
+        }
+        return asset;
+    }
+
+    /// Evicts all assets whose data is not referenced by anything but the cache itself.
+    /// Returns the number of assets evicted.
+    size_t CollectGarbage()
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        size_t nEvicted = 0;
+        for(auto entryIt = entries.begin(); entryIt != entries.end();)
+        {
+            const auto &future = entryIt->second.asset;
+            if(future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++entryIt; // (Still loading)
+                continue;
+            }
+
+            const AssetPtr &asset = future.get();
+            // NOTE: `asset.use_count() > 1` if loaded but not yet assigned to some entity
+            if(!asset || (asset.use_count() <= 1 && asset->ReferenceCount() <= 1))
+            {
+                entryIt = entries.erase(entryIt);
+                nEvicted++;
+            }
+            else
+            {
+                ++entryIt;
+            }
+        }
+        return nEvicted;
+    }
+
+    /// Returns the number of assets currently in the cache.
+    size_t Size()
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        return entries.size();
+    }
+
+private:
+    /// Runs `loader` on `filepath`. A loader that throws fails like one that returns null - and is logged.
+    static AssetPtr Load(LoaderFunc loader, const std::string &filepath)
+    {
+        try
+        {
+            return AssetPtr{loader(filepath)};
+        }
+        catch(const std::exception &e)
+        {
+            BOYD_LOG(Error, "{}: loader threw an exception: {}", filepath, e.what());
+        }
+        catch(...)
+        {
+            BOYD_LOG(Error, "{}: loader threw an unknown exception", filepath);
+        }
+        return nullptr;
+    }
+
+    struct Key
+    {
+        ENTT_ID_TYPE typeId;
+        std::string filepath;
+
+        inline bool operator==(const Key &other) const
+        {
+            return typeId == other.typeId && filepath == other.filepath;
+        }
+    };
+
+    struct KeyHasher
+    {
+        inline size_t operator()(const Key &key) const
+        {
+            return std::hash<std::string>{}(key.filepath) ^ (size_t(key.typeId) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    struct Entry
+    {
+        FileStamp stamp;
+        std::shared_future<AssetPtr> asset;
+        uint64_t generation; ///< Unique per entry; tells if an entry was replaced while its asset was loading
+    };
+
+    std::unordered_map<Key, Entry, KeyHasher> entries;
+    uint64_t nextGeneration{0};
+    std::mutex mutex;
+};
+
+} // namespace boyd
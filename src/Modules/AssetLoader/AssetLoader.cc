@@ -1,19 +1,28 @@
 #include "../../Components/ComponentLoadRequest.hh"
+#include "../../Components/Gltf.hh"
+#include "../../Components/Parent.hh"
+#include "../../Components/Transform.hh"
 #include "../../Core/GameState.hh"
 #include "../../Core/Platform.hh"
+#include "../../Core/ThreadPool.hh"
+#include "../../Core/Vfs.hh"
 #include "../../Debug/Log.hh"
+#include "AssetCache.hh"
 #include "LoadedAsset.hh"
 #include "Loader.hh"
 #include "Loaders/AllLoaders.hh"
+#include "TextureRegistry.hh"
 
 #include <BoydEngine.hh>
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <deque>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #ifdef BOYD_PLATFORM_EMSCRIPTEN
 //   FIXME: This is here temporarily to prevent shared memory security restrictions on WebWorkers
@@ -45,7 +54,7 @@ struct LoadJob
 struct LoadedJob
 {
     entt::entity target;                          ///< The entity to set the component to.
-    std::unique_ptr<LoadedAssetBase> loadedAsset; ///< The asset that was loaded.
+    std::shared_ptr<LoadedAssetBase> loadedAsset; ///< The asset that was loaded (possibly shared with other jobs).
 
     LoadedJob(entt::entity target, decltype(loadedAsset) &&loadedAsset)
         : target{target}, loadedAsset{std::move(loadedAsset)}
@@ -55,34 +64,50 @@ struct LoadedJob
 
 class BOYD_API BoydAssetLoaderState
 {
-    std::thread workerThread;
+    using Priority = comp::ComponentLoadRequest::Priority;
+    static constexpr int NUM_PRIORITIES = comp::ComponentLoadRequest::NUM_PRIORITIES;
+
+    std::vector<std::thread> workerThreads;
     std::atomic<bool> running;
 
-    // Input queue, to `workerThread`
-    std::deque<LoadJob> jobs;
-    std::atomic<bool> hasJobs; // NOTE: To be able to know if `jobs.empty()` without locking `jobsMutex`!
+    // Input queues (one per priority), to `workerThreads`
+    std::deque<LoadJob> jobs[NUM_PRIORITIES];
     std::mutex jobsMutex;
     std::condition_variable jobsCondVar;
 
-    // Output queue, from `workerThread`
+    // Output queue, from `workerThreads`
     std::deque<LoadedJob> loadedAssets;
     std::mutex loadedAssetsMutex;
 
 public:
     LoaderMap loaders;
+    AssetCache cache;
     entt::observer loadReqObserver;
 
-    BoydAssetLoaderState(entt::registry &ecs)
+    BoydAssetLoaderState(entt::registry &ecs, unsigned nWorkers)
         : jobs{}, loadedAssets{}, loadReqObserver{ecs, entt::collector.group<comp::ComponentLoadRequest>()}
     {
         RegisterAllLoaders(loaders);
         BOYD_LOG(Debug, "Asset loaders registered");
 
-        hasJobs = false;
+        // Mount the asset archive, if any - before the loader threads start
+        const std::string archivePath = BOYD_FS_PREFIX BOYD_ASSET_ARCHIVE;
+        if(!archivePath.empty() && Vfs::instance().Mount(archivePath))
+        {
+            BOYD_LOG(Info, "Mounted asset archive {}", archivePath);
+        }
+        else
+        {
+            BOYD_LOG(Debug, "No asset archive at \"{}\" - loading loose files", archivePath);
+        }
+
         running = true;
 #ifndef BOYD_SINGLE_THREADED
-        workerThread = std::thread(&BoydAssetLoaderState::WorkerLoop, this);
-        BOYD_LOG(Debug, "Asset loading thread started");
+        for(unsigned i = 0; i < nWorkers; i++)
+        {
+            workerThreads.emplace_back(&BoydAssetLoaderState::WorkerLoop, this);
+        }
+        BOYD_LOG(Debug, "{} asset loading threads started", workerThreads.size());
 #endif
     }
 
@@ -90,27 +115,57 @@ public:
     {
         loadReqObserver.disconnect();
 
-        hasJobs = true; // Fake having a new job to awake the worker thread from its `wait()`
-        running = false;
+        {
+            std::unique_lock<std::mutex> lock{jobsMutex};
+            running = false;
+        }
 #ifndef BOYD_SINGLE_THREADED
-        jobsCondVar.notify_one();
-        workerThread.join();
-        BOYD_LOG(Debug, "Asset loading thread stopped");
+        jobsCondVar.notify_all();
+        for(auto &workerThread : workerThreads)
+        {
+            workerThread.join();
+        }
+        BOYD_LOG(Debug, "Asset loading threads stopped");
 #endif
+
+        Vfs::instance().UnmountAll();
+        TextureRegistry::instance().Clear();
     }
 
-    /// Adds new jobs for the loader thread to load depending on a `LoadRequest`.
+    /// Adds new jobs for the loader threads to load depending on a `LoadRequest`.
     void AddJobs(entt::entity target, const comp::ComponentLoadRequest &loadReq)
     {
+        int priority = std::clamp(int(loadReq.priority), 0, NUM_PRIORITIES - 1);
         {
             std::unique_lock<std::mutex> lock{jobsMutex};
             for(auto &it : loadReq.requests)
             {
-                jobs.emplace_back(target, it.first, it.second);
+                jobs[priority].emplace_back(target, it.first, it.second);
             }
-            hasJobs = true;
         }
-        jobsCondVar.notify_one();
+        jobsCondVar.notify_all();
+    }
+
+    /// Removes all jobs that are still queued but whose target entity is not valid anymore,
+    /// so that the loader threads do not waste time loading their assets.
+    /// Returns the number of jobs that were cancelled.
+    size_t CancelDeadJobs(const entt::registry &ecs)
+    {
+        std::unique_lock<std::mutex> lock{jobsMutex};
+        size_t nCancelled = 0;
+        for(auto &queue : jobs)
+        {
+            auto deadBegin = std::remove_if(queue.begin(), queue.end(), [&ecs](const LoadJob &job) {
+                return !ecs.valid(job.target);
+            });
+            nCancelled += std::distance(deadBegin, queue.end());
+            queue.erase(deadBegin, queue.end());
+        }
+        if(nCancelled > 0)
+        {
+            BOYD_LOG(Debug, "Cancelled {} asset loads for entities that were destroyed", nCancelled);
+        }
+        return nCancelled;
     }
 
     /// Attach all components that were loaded by to their respective entities in the `ECS`.
@@ -143,29 +198,33 @@ public:
 
     State DoOne(bool wait)
     {
-        // Pop a job from the queue (waiting for one if there isn't any)...
+        // Pop the highest-priority job from the queues (waiting for one if there isn't any)...
         LoadJob job;
         {
+            std::unique_lock<std::mutex> lock{jobsMutex};
             if(wait)
             {
-                std::unique_lock<std::mutex> lock{jobsMutex};
                 jobsCondVar.wait(lock, [this]() {
-                    return hasJobs.load();
+                    return !running || HasJobs();
                 });
                 if(!running)
                 {
                     return Terminate;
                 }
             }
-            else if(jobs.empty())
+            else if(!HasJobs())
             {
                 return Error;
             }
-            job = jobs.front();
-            jobs.pop_front();
-            if(jobs.empty())
+
+            for(int priority = NUM_PRIORITIES - 1; priority >= 0; priority--)
             {
-                hasJobs = false;
+                if(!jobs[priority].empty())
+                {
+                    job = std::move(jobs[priority].front());
+                    jobs[priority].pop_front();
+                    break;
+                }
             }
         }
 
@@ -177,15 +236,14 @@ public:
             return Error;
         }
 
-        std::string fullFilepath{BOYD_FS_PREFIX};
-        fullFilepath += job.filepath;
-        auto loadedAsset = it->second(fullFilepath);
+        // (Loaders read files via the `Vfs`, which resolves paths to archives or to files in BOYD_FS_PREFIX)
+        auto loadedAsset = cache.GetOrLoad(job.typeId, job.filepath, it->second);
         if(!loadedAsset)
         {
-            BOYD_LOG(Error, "Error loading {} (component typeId={:X})", fullFilepath, job.typeId);
+            BOYD_LOG(Error, "Error loading {} (component typeId={:X})", job.filepath, job.typeId);
             return Error;
         }
-        BOYD_LOG(Debug, "Loaded {} for entity={}, typeId={:X}", fullFilepath, job.target, job.typeId);
+        BOYD_LOG(Debug, "Loaded {} for entity={}, typeId={:X}", job.filepath, job.target, job.typeId);
 
         // ...and finally post the results to the main thread
         {
@@ -196,6 +254,20 @@ public:
     }
 
 private:
+    /// Returns true if any of the job queues is not empty.
+    /// WARNING: Assumes that `jobsMutex` is locked!
+    bool HasJobs() const
+    {
+        for(const auto &queue : jobs)
+        {
+            if(!queue.empty())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
     void WorkerLoop()
     {
         while(running)
@@ -205,6 +277,38 @@ private:
     }
 };
 
+/// Destroys the entities instantiated for the GLTF of `target`; connected to `on_destroy<comp::Gltf>()`.
+static void DestroyGltfEntities(entt::registry &ecs, entt::entity target)
+{
+    for(auto entity : ecs.get<comp::Gltf>(target).entities)
+    {
+        if(ecs.valid(entity))
+        {
+            ecs.destroy(entity);
+        }
+    }
+}
+
+/// Moves all entities with a Parent to where their parent puts them (see `comp::Parent`).
+static void ResolveParents(entt::registry &ecs)
+{
+    ecs.view<comp::Parent, comp::Transform>().each(
+        [&ecs](entt::entity entity, const comp::Parent &parent, const comp::Transform &transform) {
+            const auto *parentTransform = ecs.valid(parent.entity) ? ecs.try_get<comp::Transform>(parent.entity)
+                                                                   : nullptr;
+            if(!parentTransform)
+            {
+                return;
+            }
+            const glm::mat4 matrix = parentTransform->matrix * parent.local;
+            if(matrix != transform.matrix)
+            {
+                // (Replaced, so that observers of Transform see it moved)
+                ecs.replace<comp::Transform>(entity, matrix);
+            }
+        });
+}
+
 } // namespace boyd
 
 inline static boyd::BoydAssetLoaderState *GetState(void *state)
@@ -217,7 +321,9 @@ BOYD_API void *BoydInit_AssetLoader()
 {
     BOYD_LOG(Info, "Starting asset loader module");
     auto *gameState = Boyd_GameState();
-    return new boyd::BoydAssetLoaderState(gameState->ecs);
+    unsigned nWorkers = std::max(boyd::ThreadPool::DefaultSize(BOYD_ASSET_LOADER_THREADS), 1u);
+    gameState->ecs.on_destroy<boyd::comp::Gltf>().connect<&boyd::DestroyGltfEntities>();
+    return new boyd::BoydAssetLoaderState(gameState->ecs, nWorkers);
 }
 
 BOYD_API void BoydUpdate_AssetLoader(void *statePtr)
@@ -225,8 +331,11 @@ BOYD_API void BoydUpdate_AssetLoader(void *statePtr)
     auto *gameState = Boyd_GameState();
     auto *state = GetState(statePtr);
 
+    // Drop all queued loads for entities that died in the meantime
+    state->CancelDeadJobs(gameState->ecs);
+
     // Each time a load request component is added:
-    // - Enqueue a load request into the worker thread
+    // - Enqueue a load request for the worker threads
     // - Remove the load request from the requester
     state->loadReqObserver.each([state, gameState](auto entity) {
         const auto &loadReq = gameState->ecs.get<boyd::comp::ComponentLoadRequest>(entity);
@@ -236,17 +345,31 @@ BOYD_API void BoydUpdate_AssetLoader(void *statePtr)
 
 #ifdef BOYD_SINGLE_THREADED
     // If not multithreaded, need to load the asset somewhere...
-    state->DoOne(true);
+    state->DoOne(false);
 #endif
 
     // Then, for each asset that was loaded, attach it to the right entity in the ECS
     state->AttachLoadedAssets(gameState->ecs);
+
+    // Make the entities instantiated for GLTFs (and all other children) follow their parents
+    // NOTE: Done here as this module runs before all others that read Transforms; parents moved by modules updated
+    //       after it (e.g. Scripting) are followed the next frame
+    boyd::ResolveParents(gameState->ecs);
+
+    // Finally, forget about all cached assets that are not used by any entity anymore (and about their textures)
+    size_t nEvicted = state->cache.CollectGarbage();
+    if(nEvicted > 0)
+    {
+        BOYD_LOG(Debug, "Evicted {} unused assets from the cache", nEvicted);
+    }
+    boyd::TextureRegistry::instance().Prune();
 }
 
 BOYD_API void BoydHalt_AssetLoader(void *statePtr)
 {
     BOYD_LOG(Info, "Halting asset loader module");
     auto *state = GetState(statePtr);
+    Boyd_GameState()->ecs.on_destroy<boyd::comp::Gltf>().disconnect<&boyd::DestroyGltfEntities>();
     delete GetState(state);
 }
 }
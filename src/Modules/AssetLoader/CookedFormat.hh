@@ -0,0 +1,288 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "../../Components/AudioClip.hh"
+#include "../../Components/Mesh.hh"
+#include "../../Components/Texture.hh"
+#include "MeshKernels.hh"
+
+namespace boyd
+{
+
+/// Engine-native ("cooked") asset files, as written by BoydCooker and read by the `Loader<T>`s.
+///
+/// A cooked file is a `Header`, followed by a header specific to the type of asset and by the raw arrays it refers to.
+/// Arrays are stored exactly like the engine stores them in memory (`comp::Mesh::Vertex`es, `comp::Mesh::Index`es,
+/// texture pixels, PCM samples) and aligned to `ALIGNMENT`, so that loading an asset is just a matter of mapping the
+/// file and copying (or directly referencing) them - there is no parsing nor decoding involved.
+/// All offsets are in bytes from the start of the file; integers are little-endian (like on all of our targets).
+namespace cooked
+{
+
+static constexpr uint32_t MAGIC = 0x4B4F4342; ///< "BCOK"
+/// Bump this whenever the layout of any of the structs below - or of the engine types they store - changes!
+static constexpr uint32_t VERSION = 2;
+static constexpr size_t ALIGNMENT = 16;
+
+enum class AssetType : uint32_t
+{
+    Model = 1,   ///< `Model` (a GLTF scene)
+    Texture = 2, ///< `Texture`
+    Wave = 3,    ///< `Wave`
+};
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    AssetType type;
+    uint32_t vertexSize; ///< sizeof(comp::Mesh::Vertex) when cooked (a sanity check for the version)
+    uint64_t fileSize;
+    uint64_t reserved; ///< (Pads the header to `ALIGNMENT`; the type-specific header follows it)
+};
+static_assert(sizeof(Header) % ALIGNMENT == 0, "The type-specific header must directly follow `Header`");
+
+/// A `comp::Mesh::Data`.
+struct Mesh
+{
+    uint32_t usage;
+    uint8_t normalFormat, tintFormat, texCoordFormat, padding; ///< `comp::Mesh::Layout`
+    uint64_t nVertices, verticesOffset;                        ///< -> comp::Mesh::Vertex[nVertices]
+    uint64_t nIndices, indicesOffset;                          ///< -> comp::Mesh::Index[nIndices]
+};
+
+/// A `comp::Texture::Data`.
+struct Texture
+{
+    uint32_t format, width, height;
+    uint32_t minFilter, magFilter, usage;
+    uint32_t levels, padding;
+    uint64_t pixelsSize, pixelsOffset; ///< -> uint8_t[pixelsSize]: all mip levels, from the biggest
+};
+
+/// A `comp::Material`. (Only has a diffuse map for now, like the materials that the GLTF loader makes)
+struct Material
+{
+    int32_t diffuseMap; ///< Index of the texture in the model, or -1 for plain white
+    uint32_t padding;
+};
+
+/// A mesh + material instance in a `Model`.
+struct Drawable
+{
+    float transform[16]; ///< Relative to the model's root (column-major, like glm)
+    uint32_t mesh, material;
+};
+
+/// A scene, as instantiated by `LoadedGltfModel`.
+struct Model
+{
+    uint32_t nMeshes, nTextures, nMaterials, nDrawables;
+    uint64_t meshesOffset, texturesOffset, materialsOffset, drawablesOffset; ///< -> Mesh[], Texture[], Material[]...
+};
+
+/// A `Wave` (PCM audio).
+struct Wave
+{
+    uint32_t sampleCount, sampleRate, sampleSize, channels;
+    uint64_t dataSize, dataOffset; ///< -> uint8_t[dataSize]
+};
+
+static_assert(std::is_trivially_copyable<comp::Mesh::Vertex>::value && sizeof(comp::Mesh::Vertex) == 48,
+              "comp::Mesh::Vertex changed - bump cooked::VERSION!");
+static_assert(sizeof(comp::Mesh::Index) == 4, "comp::Mesh::Index changed - bump cooked::VERSION!");
+
+/// Returns true if the `size` bytes at `bytes` start like a cooked file (of any type/version).
+inline bool HasMagic(const uint8_t *bytes, size_t size)
+{
+    uint32_t magic = 0;
+    if(size >= sizeof(magic))
+    {
+        std::memcpy(&magic, bytes, sizeof(magic));
+    }
+    return magic == MAGIC;
+}
+
+/// Returns the `Header` of a cooked file of the given type, or null if the file is not one or if it was cooked for
+/// another version of the engine.
+inline const Header *GetHeader(const uint8_t *bytes, size_t size, AssetType type)
+{
+    if(!HasMagic(bytes, size) || size < sizeof(Header))
+    {
+        return nullptr;
+    }
+    const auto *header = reinterpret_cast<const Header *>(bytes);
+    if(header->version != VERSION || header->type != type || header->vertexSize != sizeof(comp::Mesh::Vertex)
+       || header->fileSize > size)
+    {
+        return nullptr;
+    }
+    return header;
+}
+
+/// Returns a pointer to the `count` `T`s at `offset` in the cooked file, or null if they are out of its bounds.
+template <typename T>
+inline const T *At(const uint8_t *bytes, size_t size, uint64_t offset, uint64_t count = 1)
+{
+    if(offset % alignof(T) != 0 || offset > size || count > (size - offset) / sizeof(T))
+    {
+        return nullptr;
+    }
+    return reinterpret_cast<const T *>(bytes + offset);
+}
+
+/// Reads a cooked mesh back to `out`. Returns false if the file is corrupt.
+inline bool ReadMesh(const uint8_t *bytes, size_t size, const Mesh &mesh, comp::Mesh::Data &out)
+{
+    const auto *vertices = At<comp::Mesh::Vertex>(bytes, size, mesh.verticesOffset, mesh.nVertices);
+    const auto *indices = At<comp::Mesh::Index>(bytes, size, mesh.indicesOffset, mesh.nIndices);
+    if(!vertices || !indices)
+    {
+        return false;
+    }
+    // (The enums index lookup tables, e.g. in the Gfx module: out-of-range values must never get through)
+    if(mesh.usage > comp::Mesh::Stream || mesh.normalFormat > comp::Mesh::Layout::NormalOct16
+       || mesh.tintFormat > comp::Mesh::Layout::TintRGBA8 || mesh.texCoordFormat > comp::Mesh::Layout::TexCoordUnorm16)
+    {
+        return false;
+    }
+    // (Indices past the vertices would make the optimizer - and the GPU - read and write out of bounds)
+    if(!kernels::IndicesInRange(indices, size_t(mesh.nIndices), size_t(mesh.nVertices)))
+    {
+        return false;
+    }
+    out.vertices.assign(vertices, vertices + mesh.nVertices);
+    out.indices.assign(indices, indices + mesh.nIndices);
+    out.usage = comp::Mesh::Usage(mesh.usage);
+    out.layout.normal = comp::Mesh::Layout::NormalFormat(mesh.normalFormat);
+    out.layout.tint = comp::Mesh::Layout::TintFormat(mesh.tintFormat);
+    out.layout.texCoord = comp::Mesh::Layout::TexCoordFormat(mesh.texCoordFormat);
+    return true;
+}
+
+/// Reads a cooked texture back to `out`. Returns false if the file is corrupt.
+inline bool ReadTexture(const uint8_t *bytes, size_t size, const Texture &texture, comp::Texture::Data &out)
+{
+    static constexpr uint32_t MAX_LEVELS = 32;
+
+    const auto *pixels = At<uint8_t>(bytes, size, texture.pixelsOffset, texture.pixelsSize);
+    if(!pixels || texture.format > comp::Texture::BC3 || texture.levels == 0 || texture.levels > MAX_LEVELS)
+    {
+        return false;
+    }
+    // (The enums index lookup tables, e.g. in the Gfx module: out-of-range values must never get through)
+    if(texture.minFilter > comp::Texture::Anisotropic || texture.magFilter > comp::Texture::Bilinear
+       || texture.usage > comp::Texture::Stream)
+    {
+        return false;
+    }
+    out.format = comp::Texture::Format(texture.format);
+    out.width = texture.width;
+    out.height = texture.height;
+    out.levels = texture.levels;
+    if(out.LevelOffset(out.levels) != texture.pixelsSize)
+    {
+        return false;
+    }
+    out.pixels.assign(pixels, pixels + texture.pixelsSize);
+    out.minFilter = comp::Texture::Filter(texture.minFilter);
+    out.magFilter = comp::Texture::Filter(texture.magFilter);
+    out.usage = comp::Texture::Usage(texture.usage);
+    return true;
+}
+
+/// Reads a whole cooked texture file back to `out`. Returns false if it is not one, or if it is corrupt.
+inline bool ReadTextureFile(const uint8_t *bytes, size_t size, comp::Texture::Data &out)
+{
+    const auto *texture = GetHeader(bytes, size, AssetType::Texture) ? At<Texture>(bytes, size, sizeof(Header))
+                                                                      : nullptr;
+    return texture && ReadTexture(bytes, size, *texture, out);
+}
+
+/// Builds a cooked file in memory.
+class Writer
+{
+public:
+    explicit Writer(AssetType type)
+    {
+        Header header{MAGIC, VERSION, type, uint32_t(sizeof(comp::Mesh::Vertex)), 0, 0};
+        Append(header);
+    }
+
+    /// Appends `count` `T`s (aligned to `ALIGNMENT`) and returns their offset.
+    template <typename T>
+    uint64_t Append(const T *values, size_t count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Can only write trivially-copyable types");
+        bytes.resize((bytes.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, 0);
+        const uint64_t offset = bytes.size();
+        bytes.resize(bytes.size() + count * sizeof(T));
+        if(count > 0)
+        {
+            std::memcpy(bytes.data() + offset, values, count * sizeof(T));
+        }
+        return offset;
+    }
+
+    template <typename T>
+    uint64_t Append(const T &value)
+    {
+        return Append(&value, 1);
+    }
+
+    /// Overwrites the `T` previously appended at `offset`.
+    template <typename T>
+    void Patch(uint64_t offset, const T &value)
+    {
+        std::memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+
+    /// Appends a mesh's vertices and indices and returns its `Mesh` header (to be appended by the caller).
+    Mesh AppendMesh(const comp::Mesh::Data &data)
+    {
+        Mesh mesh{};
+        mesh.usage = uint32_t(data.usage);
+        mesh.normalFormat = uint8_t(data.layout.normal);
+        mesh.tintFormat = uint8_t(data.layout.tint);
+        mesh.texCoordFormat = uint8_t(data.layout.texCoord);
+        mesh.nVertices = data.vertices.size();
+        mesh.verticesOffset = Append(data.vertices.data(), data.vertices.size());
+        mesh.nIndices = data.indices.size();
+        mesh.indicesOffset = Append(data.indices.data(), data.indices.size());
+        return mesh;
+    }
+
+    /// Appends a texture's pixels and returns its `Texture` header (to be appended by the caller).
+    Texture AppendTexture(const comp::Texture::Data &data)
+    {
+        Texture texture{};
+        texture.format = uint32_t(data.format);
+        texture.width = data.width;
+        texture.height = data.height;
+        texture.minFilter = uint32_t(data.minFilter);
+        texture.magFilter = uint32_t(data.magFilter);
+        texture.usage = uint32_t(data.usage);
+        texture.levels = data.levels;
+        texture.pixelsSize = data.pixels.size();
+        texture.pixelsOffset = Append(data.pixels.data(), data.pixels.size());
+        return texture;
+    }
+
+    /// Finalizes the header and returns the whole file.
+    const std::vector<uint8_t> &Finish()
+    {
+        Patch(offsetof(Header, fileSize), uint64_t(bytes.size()));
+        return bytes;
+    }
+
+private:
+    std::vector<uint8_t> bytes;
+};
+
+} // namespace cooked
+} // namespace boyd
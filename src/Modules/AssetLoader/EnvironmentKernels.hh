@@ -0,0 +1,483 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "../../Components/Skybox.hh"
+#include "../../Components/Texture.hh"
+#include "../../Core/ThreadPool.hh"
+#include "../Gfx/VertexPacking.hh"
+#include "TextureKernels.hh"
+
+// NOTE: Kernels that turn an equirectangular HDR panorama into a cube map plus the prefiltered cube maps used for
+//       image-based lighting, on the loader threads. All the math is done on float images; half floats are only used
+//       to store the results.
+
+namespace boyd
+{
+namespace kernels
+{
+
+static constexpr unsigned ENVIRONMENT_MAX_SIZE = 512;  ///< Max face size of the environment cube map
+static constexpr unsigned IRRADIANCE_SIZE = 32;        ///< Face size of the irradiance cube map
+static constexpr unsigned IRRADIANCE_SOURCE_SIZE = 16; ///< Max face size of the environment level it is computed from
+static constexpr unsigned SPECULAR_SIZE = 128;         ///< Face size of the first specular level
+static constexpr unsigned SPECULAR_LEVELS = 6;         ///< Roughness 0, 0.2, ..., 1
+static constexpr unsigned SPECULAR_SAMPLES = 128;      ///< GGX samples per specular texel
+
+/// A RGB image in floats.
+struct FloatImage
+{
+    unsigned width{0}, height{0};
+    std::vector<glm::vec3> texels;
+
+    FloatImage() = default;
+    FloatImage(unsigned width, unsigned height)
+        : width{width}, height{height}, texels(size_t(width) * height)
+    {
+    }
+
+    inline glm::vec3 &At(unsigned x, unsigned y)
+    {
+        return texels[size_t(y) * width + x];
+    }
+    inline const glm::vec3 &At(unsigned x, unsigned y) const
+    {
+        return texels[size_t(y) * width + x];
+    }
+
+    /// Bilinearly samples the image at texel-space coordinates (texel centers are at +0.5), either wrapping around or
+    /// clamping to the edge horizontally; always clamps vertically.
+    inline glm::vec3 Sample(float x, float y, bool wrapX = false) const
+    {
+        x -= 0.5f;
+        y -= 0.5f;
+        const float fx = std::floor(x), fy = std::floor(y);
+        const float tx = x - fx, ty = y - fy;
+        auto column = [&](float c) {
+            const int i = int(c);
+            return wrapX ? unsigned(((i % int(width)) + int(width)) % int(width))
+                         : unsigned(std::clamp(i, 0, int(width) - 1));
+        };
+        auto row = [&](float r) {
+            return unsigned(std::clamp(int(r), 0, int(height) - 1));
+        };
+        const unsigned x0 = column(fx), x1 = column(fx + 1.0f), y0 = row(fy), y1 = row(fy + 1.0f);
+        return glm::mix(glm::mix(At(x0, y0), At(x1, y0), tx), glm::mix(At(x0, y1), At(x1, y1), tx), ty);
+    }
+
+    /// Returns the next mip level of the image (2x2 box filter; the last row/column of odd-sized images is repeated).
+    FloatImage Downsampled() const
+    {
+        FloatImage result{std::max(width / 2, 1u), std::max(height / 2, 1u)};
+        for(unsigned y = 0; y < result.height; y++)
+        {
+            const unsigned y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+            for(unsigned x = 0; x < result.width; x++)
+            {
+                const unsigned x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+                result.At(x, y) = (At(x0, y0) + At(x1, y0) + At(x0, y1) + At(x1, y1)) * 0.25f;
+            }
+        }
+        return result;
+    }
+};
+
+/// Decodes the first level of a RGB16F or RGBA16F texture (dropping alpha).
+/// Returns an empty image if the texture is in any other format.
+inline FloatImage DecodeHalfImage(const comp::Texture::Data &data)
+{
+    if((data.format != comp::Texture::RGB16F && data.format != comp::Texture::RGBA16F)
+       || data.pixels.size() < data.LevelSize(0))
+    {
+        return {};
+    }
+    const unsigned channels = TextureChannels(data.format);
+    FloatImage image{data.width, data.height};
+    for(size_t i = 0; i < image.texels.size(); i++)
+    {
+        for(unsigned c = 0; c < 3; c++)
+        {
+            uint16_t half;
+            std::memcpy(&half, data.pixels.data() + (i * channels + c) * sizeof(half), sizeof(half));
+            image.texels[i][c] = HalfToFloat(half);
+        }
+    }
+    return image;
+}
+
+/// Encodes a mip chain of float images (biggest first) to a RGB16F texture.
+inline comp::Texture::Data EncodeHalfTexture(const std::vector<FloatImage> &levels, comp::Texture::Filter minFilter)
+{
+    comp::Texture::Data data;
+    data.format = comp::Texture::RGB16F;
+    data.width = levels[0].width;
+    data.height = levels[0].height;
+    data.levels = unsigned(levels.size());
+    data.minFilter = minFilter;
+    data.magFilter = comp::Texture::Bilinear;
+    data.pixels.resize(data.LevelOffset(data.levels));
+    for(unsigned level = 0; level < data.levels; level++)
+    {
+        uint8_t *out = data.pixels.data() + data.LevelOffset(level);
+        for(const auto &texel : levels[level].texels)
+        {
+            for(unsigned c = 0; c < 3; c++)
+            {
+                const uint16_t half = FloatToHalf(texel[c]);
+                std::memcpy(out, &half, sizeof(half));
+                out += sizeof(half);
+            }
+        }
+    }
+    return data;
+}
+
+/// Returns the (normalized) direction that points to texel-space coordinates (u, v) in [-1, 1] of a cube map face.
+/// Faces are oriented as OpenGL samples them, with v going down from the first row of the face.
+inline glm::vec3 CubeFaceDirection(unsigned face, float u, float v)
+{
+    switch(face)
+    {
+    case comp::Skybox::Cubemap::PositiveX:
+        return glm::normalize(glm::vec3{1.0f, -v, -u});
+    case comp::Skybox::Cubemap::NegativeX:
+        return glm::normalize(glm::vec3{-1.0f, -v, u});
+    case comp::Skybox::Cubemap::PositiveY:
+        return glm::normalize(glm::vec3{u, 1.0f, v});
+    case comp::Skybox::Cubemap::NegativeY:
+        return glm::normalize(glm::vec3{u, -1.0f, -v});
+    case comp::Skybox::Cubemap::PositiveZ:
+        return glm::normalize(glm::vec3{u, -v, 1.0f});
+    default: // comp::Skybox::Cubemap::NegativeZ
+        return glm::normalize(glm::vec3{-u, -v, -1.0f});
+    }
+}
+
+/// The inverse of `CubeFaceDirection()`: finds the face and (u, v) in [-1, 1] that `direction` points to.
+inline unsigned CubeFaceCoords(const glm::vec3 &direction, float &u, float &v)
+{
+    const glm::vec3 a = glm::abs(direction);
+    if(a.x >= a.y && a.x >= a.z)
+    {
+        u = (direction.x > 0.0f ? -direction.z : direction.z) / a.x;
+        v = -direction.y / a.x;
+        return direction.x > 0.0f ? comp::Skybox::Cubemap::PositiveX : comp::Skybox::Cubemap::NegativeX;
+    }
+    if(a.y >= a.z)
+    {
+        u = direction.x / a.y;
+        v = (direction.y > 0.0f ? direction.z : -direction.z) / a.y;
+        return direction.y > 0.0f ? comp::Skybox::Cubemap::PositiveY : comp::Skybox::Cubemap::NegativeY;
+    }
+    u = (direction.z > 0.0f ? direction.x : -direction.x) / a.z;
+    v = -direction.y / a.z;
+    return direction.z > 0.0f ? comp::Skybox::Cubemap::PositiveZ : comp::Skybox::Cubemap::NegativeZ;
+}
+
+/// A cube map of float images, with mip levels.
+struct FloatCubemap
+{
+    std::vector<FloatImage> faces[comp::Skybox::Cubemap::_Count]; ///< faces[face][level]
+
+    inline unsigned Size(unsigned level = 0) const
+    {
+        return faces[0][level].width;
+    }
+    inline unsigned Levels() const
+    {
+        return unsigned(faces[0].size());
+    }
+
+    /// Samples the cube map towards `direction` at the given (fractional) mip level, like a trilinear sampler would.
+    /// (Faces are filtered separately, i.e. texels by the edges of a face are not blended with the adjacent one)
+    glm::vec3 Sample(const glm::vec3 &direction, float lod) const
+    {
+        float u, v;
+        const unsigned face = CubeFaceCoords(direction, u, v);
+        lod = std::clamp(lod, 0.0f, float(Levels() - 1));
+        const unsigned level0 = unsigned(lod), level1 = std::min(level0 + 1, Levels() - 1);
+        auto sampleLevel = [&](unsigned level) {
+            const float size = float(Size(level));
+            return faces[face][level].Sample((u + 1.0f) * 0.5f * size, (v + 1.0f) * 0.5f * size);
+        };
+        const glm::vec3 sample0 = sampleLevel(level0);
+        return (level1 == level0) ? sample0 : glm::mix(sample0, sampleLevel(level1), lod - float(level0));
+    }
+
+    /// Builds the mip chain of all faces (down to 1x1) from their first level.
+    void GenerateMipmaps()
+    {
+        for(auto &levels : faces)
+        {
+            levels.resize(1);
+            while(levels.back().width > 1)
+            {
+                levels.push_back(levels.back().Downsampled());
+            }
+        }
+    }
+
+    /// Converts to a RGB16F cube map.
+    comp::Skybox::Cubemap Encode(comp::Texture::Filter minFilter) const
+    {
+        comp::Skybox::Cubemap result;
+        for(unsigned face = 0; face < comp::Skybox::Cubemap::_Count; face++)
+        {
+            result.faces[face] = EncodeHalfTexture(faces[face], minFilter);
+        }
+        return result;
+    }
+};
+
+/// Returns the texel-space coordinate (u or v, in [-1, 1]) of the center of texel `i` in a face `size` texels wide.
+inline float CubeTexelCoord(unsigned i, unsigned size)
+{
+    return (float(i) + 0.5f) / float(size) * 2.0f - 1.0f;
+}
+
+/// Returns the solid angle subtended by the texel at `(u, v)` of a cube map face `size` texels wide.
+inline float CubeTexelSolidAngle(float u, float v, unsigned size)
+{
+    const float texelArea = (2.0f / float(size)) * (2.0f / float(size));
+    return texelArea / std::pow(1.0f + u * u + v * v, 1.5f);
+}
+
+/// Calls `function(face, y)` for every row of every face of a cube map `size` texels wide, spread over `nThreads`.
+template <typename TFunction>
+inline void ForEachCubeRow(unsigned size, unsigned nThreads, TFunction &&function)
+{
+    ParallelFor(size_t(comp::Skybox::Cubemap::_Count) * size, nThreads, [&](size_t i) {
+        function(unsigned(i / size), unsigned(i % size));
+    });
+}
+
+/// Resamples an equirectangular panorama (longitude on x, latitude on y from +90° to -90°, -Z at its center) to the
+/// first level of a cube map with `size`x`size` faces. Each texel averages 2x2 bilinear samples.
+inline FloatCubemap EquirectToCubemap(const FloatImage &equirect, unsigned size, unsigned nThreads)
+{
+    static constexpr float PI = 3.14159265358979f;
+    static constexpr float OFFSETS[] = {0.25f, 0.75f};
+
+    FloatCubemap result;
+    for(auto &levels : result.faces)
+    {
+        levels.emplace_back(size, size);
+    }
+    ForEachCubeRow(size, nThreads, [&](unsigned face, unsigned y) {
+        for(unsigned x = 0; x < size; x++)
+        {
+            glm::vec3 sum{0.0f};
+            for(float dy : OFFSETS)
+            {
+                for(float dx : OFFSETS)
+                {
+                    const float u = (float(x) + dx) / float(size) * 2.0f - 1.0f;
+                    const float v = (float(y) + dy) / float(size) * 2.0f - 1.0f;
+                    const glm::vec3 dir = CubeFaceDirection(face, u, v);
+                    const float longitude = std::atan2(dir.x, -dir.z);
+                    const float latitude = std::asin(std::clamp(dir.y, -1.0f, 1.0f));
+                    sum += equirect.Sample((longitude / (2.0f * PI) + 0.5f) * float(equirect.width),
+                                           (0.5f - latitude / PI) * float(equirect.height), true);
+                }
+            }
+            result.faces[face][0].At(x, y) = sum * 0.25f;
+        }
+    });
+    return result;
+}
+
+/// Computes the irradiance cube map of `environment` (that must have all its mip levels): for each normal N, the
+/// cosine-weighted integral of the incoming radiance over the hemisphere around N, divided by pi - so that a
+/// lambertian surface reflects `albedo * irradiance(N)`.
+/// Integrates over all texels of a small mip level of the environment, weighted by their solid angle.
+inline FloatCubemap ComputeIrradiance(const FloatCubemap &environment, unsigned size, unsigned nThreads)
+{
+    static constexpr float PI = 3.14159265358979f;
+
+    struct Sample
+    {
+        glm::vec3 direction;
+        glm::vec3 radiance; ///< (Premultiplied by the texel's solid angle)
+    };
+    unsigned sourceLevel = 0;
+    while(environment.Size(sourceLevel) > IRRADIANCE_SOURCE_SIZE && sourceLevel + 1 < environment.Levels())
+    {
+        sourceLevel++;
+    }
+    const unsigned sourceSize = environment.Size(sourceLevel);
+    std::vector<Sample> samples;
+    samples.reserve(size_t(comp::Skybox::Cubemap::_Count) * sourceSize * sourceSize);
+    for(unsigned face = 0; face < comp::Skybox::Cubemap::_Count; face++)
+    {
+        for(unsigned y = 0; y < sourceSize; y++)
+        {
+            for(unsigned x = 0; x < sourceSize; x++)
+            {
+                const float u = CubeTexelCoord(x, sourceSize), v = CubeTexelCoord(y, sourceSize);
+                const float solidAngle = CubeTexelSolidAngle(u, v, sourceSize);
+                samples.push_back({CubeFaceDirection(face, u, v),
+                                   environment.faces[face][sourceLevel].At(x, y) * solidAngle});
+            }
+        }
+    }
+
+    FloatCubemap result;
+    for(auto &levels : result.faces)
+    {
+        levels.emplace_back(size, size);
+    }
+    ForEachCubeRow(size, nThreads, [&](unsigned face, unsigned y) {
+        for(unsigned x = 0; x < size; x++)
+        {
+            const glm::vec3 normal = CubeFaceDirection(face, CubeTexelCoord(x, size), CubeTexelCoord(y, size));
+            glm::vec3 sum{0.0f};
+            for(const auto &sample : samples)
+            {
+                sum += sample.radiance * std::max(glm::dot(normal, sample.direction), 0.0f);
+            }
+            result.faces[face][0].At(x, y) = sum / PI;
+        }
+    });
+    return result;
+}
+
+/// Returns the i-th point of a `count`-point Hammersley sequence in [0, 1)².
+inline glm::vec2 Hammersley(uint32_t i, uint32_t count)
+{
+    uint32_t bits = i;
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return glm::vec2{float(i) / float(count), float(bits) * 2.3283064365386963e-10f};
+}
+
+/// Computes the specular cube map of `environment` (that must have all its mip levels), prefiltered with the GGX
+/// distribution for increasing roughness along its `levels` mip levels (assuming N = V = R, as in the split-sum
+/// approximation). Samples are importance-sampled, and read from the environment level whose texels cover about as
+/// much solid angle as each sample does ("filtered importance sampling"), which avoids fireflies with few samples.
+inline FloatCubemap PrefilterSpecular(const FloatCubemap &environment, unsigned size, unsigned levels,
+                                      unsigned nThreads)
+{
+    static constexpr float PI = 3.14159265358979f;
+
+    struct Sample
+    {
+        glm::vec3 direction; ///< Light direction in tangent space (N = +Z)
+        float lod;           ///< Environment level to sample from
+    };
+    std::vector<std::vector<Sample>> samples(levels);
+    const float texelSolidAngle = 4.0f * PI / (6.0f * float(environment.Size()) * float(environment.Size()));
+    for(unsigned level = 1; level < levels; level++)
+    {
+        const float roughness = float(level) / float(levels - 1);
+        const float alpha2 = roughness * roughness * roughness * roughness;
+        for(uint32_t i = 0; i < SPECULAR_SAMPLES; i++)
+        {
+            const glm::vec2 xi = Hammersley(i, SPECULAR_SAMPLES);
+            const float phi = 2.0f * PI * xi.x;
+            const float cosTheta = std::sqrt((1.0f - xi.y) / (1.0f + (alpha2 - 1.0f) * xi.y));
+            const float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+            const glm::vec3 halfway{sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta};
+            const glm::vec3 light = 2.0f * cosTheta * halfway - glm::vec3{0.0f, 0.0f, 1.0f};
+            if(light.z <= 0.0f)
+            {
+                continue;
+            }
+            // pdf(L) = D(H) * NdotH / (4 * VdotH) = D(H) / 4, as N = V
+            const float denom = cosTheta * cosTheta * (alpha2 - 1.0f) + 1.0f;
+            const float pdf = alpha2 / (PI * denom * denom) * 0.25f;
+            const float sampleSolidAngle = 1.0f / (float(SPECULAR_SAMPLES) * pdf);
+            samples[level].push_back({light, std::max(0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f,
+                                                      0.0f)});
+        }
+    }
+
+    // One row of one face of one level per job
+    struct Row
+    {
+        unsigned level, face, y;
+    };
+    std::vector<Row> rows;
+    FloatCubemap result;
+    for(unsigned face = 0; face < comp::Skybox::Cubemap::_Count; face++)
+    {
+        for(unsigned level = 0; level < levels; level++)
+        {
+            const unsigned levelSize = std::max(size >> level, 1u);
+            result.faces[face].emplace_back(levelSize, levelSize);
+            for(unsigned y = 0; y < levelSize; y++)
+            {
+                rows.push_back({level, face, y});
+            }
+        }
+    }
+    const float mirrorLod = std::log2(float(environment.Size()) / float(size)); // (Level 0 = roughness 0)
+    ParallelFor(rows.size(), nThreads, [&](size_t i) {
+        const auto row = rows[i];
+        auto &image = result.faces[row.face][row.level];
+        for(unsigned x = 0; x < image.width; x++)
+        {
+            const glm::vec3 normal = CubeFaceDirection(row.face, CubeTexelCoord(x, image.width),
+                                                       CubeTexelCoord(row.y, image.width));
+            if(row.level == 0)
+            {
+                image.At(x, row.y) = environment.Sample(normal, mirrorLod);
+                continue;
+            }
+
+            const glm::vec3 up = (std::abs(normal.z) < 0.999f) ? glm::vec3{0.0f, 0.0f, 1.0f}
+                                                               : glm::vec3{1.0f, 0.0f, 0.0f};
+            const glm::vec3 tangent = glm::normalize(glm::cross(up, normal));
+            const glm::vec3 bitangent = glm::cross(normal, tangent);
+            glm::vec3 sum{0.0f};
+            float weight = 0.0f;
+            for(const auto &sample : samples[row.level])
+            {
+                const glm::vec3 light = tangent * sample.direction.x + bitangent * sample.direction.y
+                                        + normal * sample.direction.z;
+                sum += environment.Sample(light, sample.lod) * sample.direction.z;
+                weight += sample.direction.z;
+            }
+            image.At(x, row.y) = (weight > 0.0f) ? sum / weight : glm::vec3{0.0f};
+        }
+    });
+    return result;
+}
+
+/// Builds all the cube maps of a skybox out of an equirectangular panorama, on up to `nThreads` threads.
+inline comp::Skybox::Data PrefilterEnvironment(const FloatImage &equirect, unsigned nThreads)
+{
+    // Faces about as detailed as the panorama around the equator
+    unsigned size = 1;
+    while(size * 2 <= equirect.width / 4 && size * 2 <= ENVIRONMENT_MAX_SIZE)
+    {
+        size *= 2;
+    }
+
+    FloatCubemap environment = EquirectToCubemap(equirect, size, nThreads);
+    environment.GenerateMipmaps();
+    const FloatCubemap irradiance = ComputeIrradiance(environment, IRRADIANCE_SIZE, nThreads);
+    const unsigned specularSize = std::min(size, SPECULAR_SIZE);
+    unsigned specularLevels = 1;
+    while(specularLevels < SPECULAR_LEVELS && (specularSize >> specularLevels) > 0)
+    {
+        specularLevels++;
+    }
+    const FloatCubemap specular = PrefilterSpecular(environment, specularSize, specularLevels, nThreads);
+
+    comp::Skybox::Data data;
+    data.environment = environment.Encode(comp::Texture::Trilinear);
+    data.irradiance = irradiance.Encode(comp::Texture::Bilinear);
+    data.specular = specular.Encode(comp::Texture::Trilinear);
+    return data;
+}
+
+} // namespace kernels
+} // namespace boyd
@@ -17,10 +17,29 @@ struct LoadedAssetBase
 
     virtual ~LoadedAssetBase() = default;
 
-    /// Assign(/replace) the loaded component to the EnTT entity `target`.
+    /// Assign(/replace) a copy of the loaded component to the EnTT entity `target`.
+    /// The loaded asset stays valid, so that the same asset can be assigned to multiple entities.
     virtual void AssignComponent(entt::registry &ecs, entt::entity target) = 0;
+
+    /// Returns the number of references to the data that copies of the loaded component share
+    /// (including the one in this `LoadedAssetBase` itself).
+    /// Returns 0 if copies share no data, i.e. if it is pointless to cache the loaded asset.
+    virtual long ReferenceCount() const
+    {
+        return 0;
+    }
 };
 
+/// Returns the number of references to the data that is shared among copies of `asset`,
+/// or 0 if copies of a `TAsset` do not share any data.
+/// Specialize this for each `TAsset` that has shared data.
+template <typename TAsset>
+inline long AssetReferenceCount(const TAsset &asset)
+{
+    (void)asset;
+    return 0;
+}
+
 /// A response to a `LoadJob`, containing the loaded `TAsset`.
 template <typename TAsset>
 struct LoadedAsset : public LoadedAssetBase
@@ -40,7 +59,12 @@ struct LoadedAsset : public LoadedAssetBase
             // Entity died before we could set its component - tired of waiting? :(
             return;
         }
-        ecs.assign_or_replace<TAsset>(target, std::move(asset));
+        ecs.assign_or_replace<TAsset>(target, asset);
+    }
+
+    long ReferenceCount() const override
+    {
+        return AssetReferenceCount(asset);
     }
 };
 
@@ -1,92 +1,201 @@
 #pragma once
 
 #include "../../../Components/AudioClip.hh"
+#include "../../../Core/Flac.hh"
+#include "../../../Core/Vfs.hh"
+#include "../CookedFormat.hh"
 #include "../../Core/Platform.hh"
 #include "../../Debug/Log.hh"
 
-#include <cassert>
-#include <filesystem>
-#include <fstream>
+#include <BoydEngine.hh>
+#include <cstring>
 #include <memory>
-
-#ifdef BOYD_PLATFORM_WIN32
-#    include <malloc.h>
-#    include <winsock2.h>
-#else
-#    include <alloca.h>
-#    include <netinet/in.h>
-#endif
+#include <vector>
 
 namespace boyd
 {
 
-// ------------------------------------------------------------------------------------------------
-/// Wav header structure (ish).
-/// See http://soundfile.sapp.org/doc/WaveFormat/
-/// However, this does not include the LIST chunk, which makes things spicier
-/// So we basically ignore the subchunk1size parameter and always skip 2 + multiples of 4
-/// until we get "data"
-struct WavHeader
+/// Copies of a `comp::AudioClip` all share the same PCM data.
+template <>
+inline long AssetReferenceCount<comp::AudioClip>(const comp::AudioClip &asset)
 {
-    uint32_t ChunkID;
-    uint32_t ChunkSize;
-    uint32_t Format;
-    uint32_t Subchunk1ID;
-    uint32_t Subchunk1Size;
-    uint16_t AudioFormat;
-    uint16_t NumChannels;
-    uint32_t SampleRate;
-    uint32_t ByteRate;
-    uint16_t BlockAlign;
-    uint16_t BitsPerSample;
-    uint32_t Subchunk2ID;
-    uint32_t Subchunk2Size;
-};
+    return asset.wave.data.use_count();
+}
 
 template <>
 struct Loader<comp::AudioClip>
 {
     static std::unique_ptr<LoadedAssetBase> Load(std::string filepath)
     {
-        WavHeader header;
+        FileView file = Vfs::instance().Open(filepath);
+        if(!file)
+        {
+            BOYD_LOG(Warn, "Could not load the asset {}", filepath);
+            return nullptr;
+        }
+        if(cooked::HasMagic(file.data, file.size))
+        {
+            return LoadCooked(filepath, file);
+        }
+        if(file.size >= 4 && std::memcmp(file.data, "fLaC", 4) == 0)
+        {
+            return LoadFlac(filepath, file);
+        }
+        return LoadWav(filepath, file);
+    }
+
+private:
+    /// Loads a RIFF WAVE file (see http://soundfile.sapp.org/doc/WaveFormat/), skipping any chunk other than "fmt " and
+    /// "data" (e.g. "LIST").
+    /// PCM data is referenced in place; the file is kept alive for as long as any copy of the clip is.
+    static std::unique_ptr<LoadedAssetBase> LoadWav(const std::string &filepath, const FileView &file)
+    {
+        static constexpr uint32_t RIFF = 0x46464952, WAVE = 0x45564157, FMT = 0x20746D66, DATA = 0x61746164;
+        static constexpr uint16_t FORMAT_PCM = 1, FORMAT_FLOAT = 3;
 
-        Wave result;
-        std::ifstream reader{filepath, std::ios_base::binary | std::ios_base::in};
+        auto readU32 = [&](size_t offset) {
+            uint32_t value;
+            std::memcpy(&value, file.data + offset, sizeof(value)); // (RIFF is little-endian, like all our targets)
+            return value;
+        };
+        auto readU16 = [&](size_t offset) {
+            uint16_t value;
+            std::memcpy(&value, file.data + offset, sizeof(value));
+            return value;
+        };
 
-        if(!reader)
+        if(file.size < 12 || readU32(0) != RIFF || readU32(8) != WAVE)
         {
-            BOYD_LOG(Warn, "Could not load the asset {}", filepath);
+            BOYD_LOG(Error, "{}: not a WAVE file", filepath);
             return nullptr;
         }
 
-        // Parse the header...
-        reader.read((char *)&header, sizeof(WavHeader));
+        uint16_t audioFormat = 0, nChannels = 0, bitsPerSample = 0;
+        uint32_t sampleRate = 0;
+        const uint8_t *samples = nullptr;
+        size_t samplesSize = 0;
+        for(size_t offset = 12; offset + 8 <= file.size;)
+        {
+            const uint32_t chunkId = readU32(offset);
+            size_t chunkSize = readU32(offset + 4);
+            offset += 8;
+            if(chunkSize > file.size - offset)
+            {
+                BOYD_LOG(Warn, "{}: truncated chunk", filepath);
+                chunkSize = file.size - offset;
+            }
 
-        assert(header.ChunkID == htonl(0x52494646));     // "RIFF"
-        assert(header.Format == htonl(0x57415645));      // "WAVE"
-        assert(header.Subchunk1ID == htonl(0x666d7420)); // "fmt "
+            if(chunkId == FMT && chunkSize >= 16)
+            {
+                audioFormat = readU16(offset);
+                nChannels = readU16(offset + 2);
+                sampleRate = readU32(offset + 4);
+                bitsPerSample = readU16(offset + 14);
+            }
+            else if(chunkId == DATA && !samples)
+            {
+                samples = file.data + offset;
+                samplesSize = chunkSize;
+            }
+            offset += chunkSize + (chunkSize & 1); // (Chunks are 2-byte aligned)
+        }
 
-        /// ... skip the extra parameters ...
-        reader.seekg(2, reader.cur);
-        bool skipped = false;
-        while(header.Subchunk2ID != htonl(0x64617461)) // "data"
+        if(!samples || (audioFormat != FORMAT_PCM && audioFormat != FORMAT_FLOAT) || nChannels == 0
+           || (bitsPerSample != 8 && bitsPerSample != 16 && bitsPerSample != 32))
         {
-            skipped = true;
-            reader.read((char *)&header.Subchunk2ID, 4);
+            BOYD_LOG(Error, "{}: missing data, or unsupported format (format={}, channels={}, bits={})", filepath,
+                     audioFormat, nChannels, bitsPerSample);
+            return nullptr;
         }
-        assert(header.Subchunk2ID == htonl(0x64617461)); // "data"
-        if(skipped)
-            reader.read((char *)&header.Subchunk2Size, 4); // The data size
 
-        /// ... and fill the buffer
-        result.data.reset(new uint8_t[header.Subchunk2Size]);
-        reader.read((char *)result.data.get(), header.Subchunk2Size);
+        Wave result;
+        result.channels = nChannels;
+        result.sampleRate = sampleRate;
+        result.sampleSize = bitsPerSample;
+        result.sampleCount = unsigned(samplesSize / (nChannels * bitsPerSample / 8));
+        result.data = std::shared_ptr<uint8_t>(file.owner, const_cast<uint8_t *>(samples)); // (Aliases the file)
+        result.dataSize = result.PcmSize();
+        return std::make_unique<LoadedAsset<comp::AudioClip>>(std::move(result));
+    }
 
-        result.channels = header.NumChannels;
-        result.sampleRate = header.SampleRate;
-        result.sampleSize = header.BitsPerSample;
-        result.sampleCount = header.Subchunk2Size / (header.NumChannels * header.BitsPerSample / 8);
+    /// Loads a FLAC file. With BOYD_AUDIO_COMPRESSED_CLIPS, the stream is referenced in place (like .wav files) and
+    /// decoded by the Audio module when played; otherwise - or if the stream does not say how long it is - it is
+    /// decoded to 16-bit PCM here.
+    static std::unique_ptr<LoadedAssetBase> LoadFlac(const std::string &filepath, const FileView &file)
+    {
+        flac::Decoder decoder;
+        if(!decoder.Open(file.data, file.size))
+        {
+            BOYD_LOG(Error, "{}: corrupt or unsupported FLAC stream", filepath);
+            return nullptr;
+        }
+        const flac::StreamInfo &info = decoder.Info();
+
+        Wave result;
+        result.channels = info.channels;
+        result.sampleRate = info.sampleRate;
+        result.sampleSize = 16;
+#ifdef BOYD_AUDIO_COMPRESSED_CLIPS
+        if(info.totalSamples > 0)
+        {
+            result.sampleCount = unsigned(info.totalSamples);
+            result.data = std::shared_ptr<uint8_t>(file.owner, const_cast<uint8_t *>(file.data)); // (Aliases the file)
+            result.dataSize = file.size;
+            result.codec = Wave::FLAC;
+            return std::make_unique<LoadedAsset<comp::AudioClip>>(std::move(result));
+        }
+#endif
 
+        std::vector<int16_t> samples;
+        samples.reserve(size_t(info.totalSamples) * info.channels);
+        static constexpr size_t CHUNK_FRAMES = 4096;
+        for(size_t nRead = CHUNK_FRAMES; nRead == CHUNK_FRAMES;)
+        {
+            const size_t offset = samples.size();
+            samples.resize(offset + CHUNK_FRAMES * info.channels);
+            nRead = decoder.Read(samples.data() + offset, CHUNK_FRAMES);
+            samples.resize(offset + nRead * info.channels);
+        }
+        if(samples.empty())
+        {
+            BOYD_LOG(Error, "{}: FLAC stream has no samples", filepath);
+            return nullptr;
+        }
+
+        result.sampleCount = unsigned(samples.size() / info.channels);
+        result.dataSize = result.PcmSize();
+        auto owner = std::make_shared<std::vector<int16_t>>(std::move(samples));
+        result.data = std::shared_ptr<uint8_t>(owner, reinterpret_cast<uint8_t *>(owner->data()));
+        BOYD_LOG(Debug, "{}: decoded {} samples ({} channels, {} Hz)", filepath, result.sampleCount, result.channels,
+                 result.sampleRate);
+        return std::make_unique<LoadedAsset<comp::AudioClip>>(std::move(result));
+    }
+
+    /// Loads a wave cooked by BoydCooker. Samples are referenced in place, like for .wav files.
+    static std::unique_ptr<LoadedAssetBase> LoadCooked(const std::string &filepath, const FileView &file)
+    {
+        const uint8_t *bytes = file.data;
+        const size_t size = file.size;
+        const auto *wave = cooked::GetHeader(bytes, size, cooked::AssetType::Wave)
+                               ? cooked::At<cooked::Wave>(bytes, size, sizeof(cooked::Header))
+                               : nullptr;
+        const uint8_t *samples = wave ? cooked::At<uint8_t>(bytes, size, wave->dataOffset, wave->dataSize) : nullptr;
+        // (The mixers and OpenAL read `PcmSize()` bytes of samples: they must all be in the file)
+        if(!samples || (wave->channels != 1 && wave->channels != 2) || (wave->sampleSize != 8 && wave->sampleSize != 16)
+           || wave->sampleRate == 0
+           || uint64_t(wave->sampleCount) * wave->channels * (wave->sampleSize / 8) > wave->dataSize)
+        {
+            BOYD_LOG(Error, "{}: corrupt cooked wave, or cooked for another engine version - recook it!", filepath);
+            return nullptr;
+        }
+
+        Wave result;
+        result.sampleCount = wave->sampleCount;
+        result.sampleRate = wave->sampleRate;
+        result.sampleSize = wave->sampleSize;
+        result.channels = wave->channels;
+        result.data = std::shared_ptr<uint8_t>(file.owner, const_cast<uint8_t *>(samples)); // (Aliases the file)
+        result.dataSize = size_t(wave->dataSize);
         return std::make_unique<LoadedAsset<comp::AudioClip>>(std::move(result));
     }
 };
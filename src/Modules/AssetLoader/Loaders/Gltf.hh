@@ -1,12 +1,30 @@
 #pragma once
 
+#include <BoydEngine.hh>
+#include <algorithm>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <map>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <variant>
+#include <vector>
 
 #include "../../../Components/Gltf.hh"
 #include "../../../Components/Material.hh"
 #include "../../../Components/Mesh.hh"
+#include "../../../Components/Parent.hh"
+#include "../../../Components/Transform.hh"
+#include "../../../Core/Vfs.hh"
+#include "../CookedFormat.hh"
 #include "../LoadedAsset.hh"
+#include "../MeshKernels.hh"
+#include "../MeshOptimizer.hh"
+#include "../TextureAtlas.hh"
+#include "../TextureKernels.hh"
+#include "../TextureRegistry.hh"
 
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -67,160 +85,504 @@ static const std::unordered_map<std::pair<int, int>, comp::Texture::Format, IntP
     {{4, TINYGLTF_COMPONENT_TYPE_SHORT}, comp::Texture::RGBA16F},
 };
 
-/// Converts a `TInteger` (pointed to by valuePtr) to a comp::mesh::Index.
-template <typename TInteger>
-inline static comp::Mesh::Index ConvertIndex(const void *valuePtr)
+/// Widens `count` GLTF indices of the given component type at `in` to `comp::Mesh::Index`es, adding `base` to each.
+/// Returns false if the component type is not a valid index type.
+inline static bool WidenGltfIndices(int componentType, const uint8_t *in, size_t count, comp::Mesh::Index base,
+                                    comp::Mesh::Index *out)
 {
-    return static_cast<comp::Mesh::Index>(*reinterpret_cast<const TInteger *>(valuePtr));
+    switch(componentType)
+    {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        kernels::WidenIndices<uint8_t>(in, count, base, out);
+        return true;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        kernels::WidenIndices<uint16_t>(in, count, base, out);
+        return true;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        kernels::WidenIndices<uint32_t>(in, count, base, out);
+        return true;
+    default:
+        return false;
+    }
 }
 
-/// A map of <GLTF type, converted function to Mesh::Index>.
-static const std::unordered_map<int, decltype(&ConvertIndex<int>)> INDEX_CONVERTERS{
-    {TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, &ConvertIndex<uint8_t>},
-    {TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, &ConvertIndex<uint16_t>},
-    {TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, &ConvertIndex<uint32_t>},
-};
+/// Scatters `count` GLTF attribute values of `nComponents` components of the given type (read every `inStride` bytes
+/// from `in`) to the float attribute at `out` of consecutive `comp::Mesh::Vertex`es.
+/// Returns false if the component type/count is not supported.
+inline static bool ScatterGltfAttribute(int componentType, size_t nComponents, bool normalized, const uint8_t *in,
+                                        size_t inStride, size_t count, uint8_t *out)
+{
+    constexpr size_t outStride = sizeof(comp::Mesh::Vertex);
+    switch(componentType)
+    {
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+        return kernels::ScatterAttribute<float>(in, inStride, count, nComponents, normalized, out, outStride);
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        return kernels::ScatterAttribute<uint8_t>(in, inStride, count, nComponents, normalized, out, outStride);
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+        return kernels::ScatterAttribute<int8_t>(in, inStride, count, nComponents, normalized, out, outStride);
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        return kernels::ScatterAttribute<uint16_t>(in, inStride, count, nComponents, normalized, out, outStride);
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+        return kernels::ScatterAttribute<int16_t>(in, inStride, count, nComponents, normalized, out, outStride);
+    default:
+        return false;
+    }
+}
 
 /// Specialization of LoadedAssetBase that loads and sets multiple GLTF-loaded components.
+///
+/// Instantiates the whole scene of the GLTF: every mesh primitive of every node becomes an entity with its own
+/// `Transform`, `Mesh` and `Material`. (Except when the scene is just a single primitive: then it's assigned to the
+/// target entity itself, as any other loaded component)
 struct LoadedGltfModel : public LoadedAssetBase
 {
     std::string filepath;
-    tinygltf::Model gltfModel;
 
-    comp::Mesh mesh;
-    comp::Material material;
-    bool hasMesh, hasMaterial;
+    /// A mesh primitive to be instantiated.
+    struct Drawable
+    {
+        glm::mat4 transform; ///< Relative to the GLTF's root
+        comp::Mesh mesh;
+        comp::Material material;
+    };
+    std::vector<Drawable> drawables;
 
-    LoadedGltfModel(std::string filepath, tinygltf::Model &&model)
-        : LoadedAssetBase(entt::type_info<comp::Gltf>::id()), filepath{filepath}, gltfModel{std::move(model)}
+    /// `glbBinBuffer` is the index of the GLTF buffer whose data is the `glbBinSize` bytes at `glbBinData` (i.e. the
+    /// binary chunk of a .glb, read in place) instead of being stored in `model`; -1 if none. It only needs to be valid
+    /// during the constructor, which is also the only time `model` is kept around for.
+    LoadedGltfModel(std::string filepath, tinygltf::Model &&model, int glbBinBuffer = -1,
+                    const uint8_t *glbBinData = nullptr, size_t glbBinSize = 0)
+        : LoadedAssetBase(entt::type_info<comp::Gltf>::id()), filepath{filepath}, gltfModel{std::move(model)},
+          binBuffer{glbBinBuffer}, binData{glbBinData}, binSize{glbBinSize}
     {
         // TODO IMPLEMENT: Loading for:
-        // - Textures
         // - Cameras
         // - Skeletons + animations
         // - Lights
-        hasMesh = hasMaterial = false;
-        if(!gltfModel.meshes.empty())
+        LoadScene();
+        FinishTextures();
+
+        // All components are built and own their data: drop the intermediate model right away instead of keeping it
+        // (and all of its buffers) alive until the components are assigned
+        gltfModel = tinygltf::Model{};
+        binBuffer = -1;
+        binData = nullptr;
+        binSize = 0;
+        meshCache.clear();
+        materialCache.clear();
+        textureCache.clear();
+    }
+    /// Wraps drawables that were already built (i.e. read from a cooked model).
+    LoadedGltfModel(std::string filepath, std::vector<Drawable> &&cookedDrawables)
+        : LoadedAssetBase(entt::type_info<comp::Gltf>::id()), filepath{filepath},
+          drawables{std::move(cookedDrawables)}, binBuffer{-1}, binData{nullptr}, binSize{0}
+    {
+    }
+    ~LoadedGltfModel() = default;
+
+    /// The diffuse map of materials that have none (plain white; shared by all models).
+    static comp::Texture DefaultDiffuseMap()
+    {
+        return TextureRegistry::instance().Intern(comp::Texture::Data{
+            comp::Texture::RGB8,
+            1,
+            1,
+            {255, 255, 255},
+            comp::Texture::Nearest,
+            comp::Texture::Nearest,
+            comp::Texture::Static,
+        });
+    }
+
+    /// Builds mipmaps and block-compresses texture data (here, on an asset loader thread, instead of at upload time),
+    /// then returns the registered texture with the resulting data.
+    static comp::Texture PrepareTexture(comp::Texture::Data &&data, unsigned maxLevels = ~0u)
+    {
+#ifdef BOYD_COMPRESS_TEXTURES
+        kernels::PrepareTexture(data, true, maxLevels);
+#else
+        kernels::PrepareTexture(data, false, maxLevels);
+#endif
+        return TextureRegistry::instance().Intern(std::move(data));
+    }
+
+    // --- Adapted from https://github.com/syoyo/tinygltf/blob/master/examples/basic/main.cpp --------------------------
+
+    void AssignComponent(entt::registry &ecs, entt::entity target) override
+    {
+        // Destroy the entities instantiated by a previous GLTF assigned to the target, if any (removing it does)
+        if(ecs.has<comp::Gltf>(target))
+        {
+            ecs.remove<comp::Gltf>(target);
+        }
+
+        comp::Gltf gltf;
+        if(drawables.size() == 1 && drawables[0].transform == glm::identity<glm::mat4>())
+        {
+            ecs.assign_or_replace<comp::Material>(target, drawables[0].material);
+            ecs.assign_or_replace<comp::Mesh>(target, drawables[0].mesh);
+        }
+        else if(!drawables.empty())
         {
-            if(LoadMaterial(gltfModel.meshes[0], this->material))
+            // Instantiate all drawables at once, as children of the target
+            const auto *targetTransform = ecs.try_get<comp::Transform>(target);
+            const glm::mat4 rootMtx = targetTransform ? targetTransform->matrix : glm::identity<glm::mat4>();
+
+            std::vector<comp::Transform> transforms;
+            std::vector<comp::Parent> parents;
+            std::vector<comp::Mesh> meshes;
+            std::vector<comp::Material> materials;
+            transforms.reserve(drawables.size());
+            parents.reserve(drawables.size());
+            meshes.reserve(drawables.size());
+            materials.reserve(drawables.size());
+            for(const auto &drawable : drawables)
             {
-                hasMaterial = true;
+                transforms.emplace_back(rootMtx * drawable.transform);
+                parents.emplace_back(target, drawable.transform);
+                meshes.push_back(drawable.mesh);
+                materials.push_back(drawable.material);
             }
-            if(LoadMesh(gltfModel.meshes[0], this->mesh))
+
+            gltf.entities.resize(drawables.size());
+            ecs.create(gltf.entities.begin(), gltf.entities.end());
+            ecs.assign<comp::Transform>(gltf.entities.begin(), gltf.entities.end(), transforms.begin());
+            ecs.assign<comp::Parent>(gltf.entities.begin(), gltf.entities.end(), parents.begin());
+            ecs.assign<comp::Mesh>(gltf.entities.begin(), gltf.entities.end(), meshes.begin());
+            ecs.assign<comp::Material>(gltf.entities.begin(), gltf.entities.end(), materials.begin());
+        }
+        // GLTF loaded
+        ecs.assign<comp::Gltf>(target, std::move(gltf));
+    }
+
+    long ReferenceCount() const override
+    {
+        // Copies of the meshes and materials share the mesh data and textures
+        long count = 0;
+        for(const auto &drawable : drawables)
+        {
+            count = std::max(count, drawable.mesh.data.ReferenceCount());
+            for(const auto &param : drawable.material.data->parameters)
             {
-                hasMesh = true;
+                if(const auto *texture = std::get_if<comp::Texture>(&param.second))
+                {
+                    count = std::max(count, texture->data.ReferenceCount());
+                }
             }
         }
+        return count;
     }
-    ~LoadedGltfModel() = default;
 
-    // --- Adapted from https://github.com/syoyo/tinygltf/blob/master/examples/basic/main.cpp --------------------------
+private:
+    tinygltf::Model gltfModel;
+    int binBuffer;
+    const uint8_t *binData;
+    size_t binSize;
 
-    void AssignComponent(entt::registry &ecs, entt::entity target) override
+    // Loaded components, so that nodes (and primitives) that share GLTF meshes/materials/textures share their data
+    std::map<std::pair<int, int>, comp::Mesh> meshCache; ///< (mesh, primitive) -> mesh
+    std::unordered_map<int, comp::Material> materialCache;
+    std::unordered_map<int, comp::Texture> textureCache;
+
+    /// Returns a pointer to the `byteLength` bytes of the given buffer view that start `byteOffset` bytes into it, or
+    /// null if they are out of bounds.
+    const uint8_t *BufferViewData(int bufferViewIndex, size_t byteOffset, size_t byteLength) const
     {
-        if(hasMaterial)
+        if(bufferViewIndex < 0 || size_t(bufferViewIndex) >= gltfModel.bufferViews.size())
         {
-            ecs.assign_or_replace<comp::Material>(target, std::move(material));
+            return nullptr;
         }
-        if(hasMesh)
+        const auto &bufferView = gltfModel.bufferViews[bufferViewIndex];
+        if(byteOffset + byteLength > bufferView.byteLength)
         {
-            ecs.assign_or_replace<comp::Mesh>(target, std::move(mesh));
+            return nullptr;
         }
-        // GLTF loaded
-        ecs.assign_or_replace<comp::Gltf>(target);
+
+        const uint8_t *bufferData = nullptr;
+        size_t bufferSize = 0;
+        if(bufferView.buffer == binBuffer)
+        {
+            bufferData = binData;
+            bufferSize = binSize;
+        }
+        else if(bufferView.buffer >= 0 && size_t(bufferView.buffer) < gltfModel.buffers.size())
+        {
+            bufferData = gltfModel.buffers[bufferView.buffer].data.data();
+            bufferSize = gltfModel.buffers[bufferView.buffer].data.size();
+        }
+        if(!bufferData || bufferView.byteOffset + bufferView.byteLength > bufferSize)
+        {
+            return nullptr;
+        }
+        return bufferData + bufferView.byteOffset + byteOffset;
     }
 
-private:
-    bool LoadMesh(tinygltf::Mesh &gltfMesh, comp::Mesh &outMesh)
+    /// Returns the local transform of a GLTF node (either its matrix or its TRS).
+    static glm::mat4 NodeTransform(const tinygltf::Node &node)
     {
-        auto LoadMeshComponent = [&](comp::Mesh::Data *outMeshData) -> bool {
-            for(size_t iPrimitive = 0; iPrimitive < gltfMesh.primitives.size(); iPrimitive++)
+        glm::mat4 mtx = glm::identity<glm::mat4>();
+        if(node.matrix.size() == 16)
+        {
+            for(int i = 0; i < 16; i++)
             {
-                const size_t nVertsPrev = outMeshData->vertices.size(); // = number of vertices as of the last loaded primitive
-                const size_t nIdxsPrev = outMeshData->indices.size();   // = number of indices as of the last loaded primitive
+                mtx[i / 4][i % 4] = float(node.matrix[i]); // (Column-major, like glm)
+            }
+            return mtx;
+        }
+        if(node.translation.size() == 3)
+        {
+            const auto &t = node.translation;
+            mtx = glm::translate(mtx, glm::vec3{float(t[0]), float(t[1]), float(t[2])});
+        }
+        if(node.rotation.size() == 4)
+        {
+            glm::quat rotation{float(node.rotation[3]), float(node.rotation[0]), float(node.rotation[1]),
+                               float(node.rotation[2])}; // (GLTF: XYZW, glm: WXYZ)
+            mtx = mtx * glm::mat4_cast(rotation);
+        }
+        if(node.scale.size() == 3)
+        {
+            const auto &s = node.scale;
+            mtx = glm::scale(mtx, glm::vec3{float(s[0]), float(s[1]), float(s[2])});
+        }
+        return mtx;
+    }
 
-                const auto &primitive = gltfMesh.primitives[iPrimitive];
-                if(primitive.mode != TINYGLTF_MODE_TRIANGLES)
+    /// Walks the node graph of the default scene (or of all root nodes if there is none), adding a `Drawable` for each
+    /// mesh primitive found.
+    void LoadScene()
+    {
+        std::vector<int> roots;
+        if(!gltfModel.scenes.empty())
+        {
+            const size_t sceneIndex = gltfModel.defaultScene >= 0 ? size_t(gltfModel.defaultScene) : 0;
+            roots = gltfModel.scenes[std::min(sceneIndex, gltfModel.scenes.size() - 1)].nodes;
+        }
+        else
+        {
+            std::vector<bool> isChild(gltfModel.nodes.size(), false);
+            for(const auto &node : gltfModel.nodes)
+            {
+                for(int child : node.children)
+                {
+                    if(child >= 0 && size_t(child) < isChild.size())
+                    {
+                        isChild[child] = true;
+                    }
+                }
+            }
+            for(size_t i = 0; i < isChild.size(); i++)
+            {
+                if(!isChild[i])
+                {
+                    roots.push_back(int(i));
+                }
+            }
+        }
+
+        if(gltfModel.nodes.empty())
+        {
+            // No node graph at all: just instantiate all meshes at the origin
+            for(size_t i = 0; i < gltfModel.meshes.size(); i++)
+            {
+                AddMeshDrawables(int(i), glm::identity<glm::mat4>());
+            }
+            return;
+        }
+
+        // Depth-first visit (iterative, and limited to one visit per node so that malformed files can't loop forever)
+        std::vector<std::pair<int, glm::mat4>> toVisit;
+        for(auto it = roots.rbegin(); it != roots.rend(); ++it)
+        {
+            toVisit.emplace_back(*it, glm::identity<glm::mat4>());
+        }
+        std::vector<bool> visited(gltfModel.nodes.size(), false);
+        while(!toVisit.empty())
+        {
+            auto [nodeIndex, parentMtx] = toVisit.back();
+            toVisit.pop_back();
+            if(nodeIndex < 0 || size_t(nodeIndex) >= gltfModel.nodes.size() || visited[nodeIndex])
+            {
+                continue;
+            }
+            visited[nodeIndex] = true;
+
+            const auto &node = gltfModel.nodes[nodeIndex];
+            const glm::mat4 nodeMtx = parentMtx * NodeTransform(node);
+            if(node.mesh >= 0)
+            {
+                AddMeshDrawables(node.mesh, nodeMtx);
+            }
+            for(auto it = node.children.rbegin(); it != node.children.rend(); ++it)
+            {
+                toVisit.emplace_back(*it, nodeMtx);
+            }
+        }
+    }
+
+    /// Adds a `Drawable` with the given transform for each primitive of the given GLTF mesh.
+    void AddMeshDrawables(int gltfMeshIndex, const glm::mat4 &transform)
+    {
+        if(gltfMeshIndex < 0 || size_t(gltfMeshIndex) >= gltfModel.meshes.size())
+        {
+            return;
+        }
+        const auto &gltfMesh = gltfModel.meshes[gltfMeshIndex];
+        for(size_t iPrimitive = 0; iPrimitive < gltfMesh.primitives.size(); iPrimitive++)
+        {
+            const auto &primitive = gltfMesh.primitives[iPrimitive];
+
+            auto meshIt = meshCache.find({gltfMeshIndex, int(iPrimitive)});
+            if(meshIt == meshCache.end())
+            {
+                comp::Mesh mesh;
+                if(!LoadPrimitive(primitive, mesh))
                 {
-                    // TODO IMPLEMENT
-                    BOYD_LOG(Warn, "{}: skipping non-triangular mesh primitive!", filepath);
                     continue;
                 }
+                meshIt = meshCache.emplace(std::make_pair(gltfMeshIndex, int(iPrimitive)), std::move(mesh)).first;
+            }
 
-                const auto &idxAccessor = gltfModel.accessors[primitive.indices];
-                const auto &idxBufferView = gltfModel.bufferViews[idxAccessor.bufferView];
-                const auto &idxBuffer = gltfModel.buffers[idxBufferView.buffer];
+            auto materialIt = materialCache.find(primitive.material);
+            if(materialIt == materialCache.end())
+            {
+                comp::Material material;
+                LoadMaterial(primitive.material, material);
+                materialIt = materialCache.emplace(primitive.material, std::move(material)).first;
+            }
 
-                const size_t bytesPerIdx = tinygltf::GetComponentSizeInBytes(idxAccessor.componentType);
-                const size_t nIdxsNow = nIdxsPrev + idxAccessor.count;
-                outMeshData->indices.resize(nIdxsNow);
-                const auto idxConv = INDEX_CONVERTERS.at(idxAccessor.componentType);
+            drawables.push_back({transform, meshIt->second, materialIt->second});
+        }
+    }
 
-                const uint8_t *readPtr = &idxBuffer.data[idxBufferView.byteOffset + idxAccessor.byteOffset];
-                for(size_t iIdx = nIdxsPrev; iIdx < nIdxsNow; iIdx++)
+    bool LoadPrimitive(const tinygltf::Primitive &primitive, comp::Mesh &outMesh)
+    {
+        if(primitive.mode != TINYGLTF_MODE_TRIANGLES)
+        {
+            // TODO IMPLEMENT
+            BOYD_LOG(Warn, "{}: skipping non-triangular mesh primitive!", filepath);
+            return false;
+        }
+
+        bool ok = true;
+        auto LoadMeshComponent = [&](comp::Mesh::Data *outMeshData) -> bool {
+            for(const auto &attribPair : primitive.attributes)
+            {
+                // Find vertex attribute by name...
+                auto vertAttribIt = VERTEX_ATTRIBS.find(attribPair.first);
+                if(vertAttribIt == VERTEX_ATTRIBS.end())
                 {
-                    // Shift all indices by the previous primitive's vertex count to merge the two...
-                    outMeshData->indices[iIdx] = idxConv(readPtr) + nVertsPrev;
-                    readPtr += bytesPerIdx;
+                    // Not an attribute we are interested in
+                    continue;
                 }
+                const VertexAttrib &vertAttrib = vertAttribIt->second;
 
-                for(const auto &attribPair : primitive.attributes)
+                const auto &attribAccessor = gltfModel.accessors[attribPair.second];
+                if(attribAccessor.sparse.isSparse)
                 {
-                    // Find vertex attribute by name...
-                    auto vertAttribIt = VERTEX_ATTRIBS.find(attribPair.first);
-                    if(vertAttribIt == VERTEX_ATTRIBS.end())
-                    {
-                        // Not an attribute we are interested in
-                        continue;
-                    }
-                    const VertexAttrib &vertAttrib = vertAttribIt->second;
+                    // TODO IMPLEMENT
+                    BOYD_LOG(Warn, "{}: sparse buffer view is not supported", filepath);
+                    continue;
+                }
 
-                    const auto &attribAccessor = gltfModel.accessors[attribPair.second];
-                    if(attribAccessor.sparse.isSparse)
-                    {
-                        // TODO IMPLEMENT
-                        BOYD_LOG(Warn, "{}: sparse buffer view is not supported", filepath);
-                        continue;
-                    }
+                const auto gltfCompCount = static_cast<size_t>(tinygltf::GetNumComponentsInType(attribAccessor.type));
+                const size_t meshCompCount = vertAttrib.size / sizeof(float);
+                if(gltfCompCount > meshCompCount)
+                {
+                    BOYD_LOG(Warn, "{}: GLTF attribute {} has {} components, but in Mesh it has {} - truncating!",
+                             filepath, attribPair.first, gltfCompCount, meshCompCount);
+                }
+                const size_t compCount = std::min(gltfCompCount, meshCompCount);
 
-                    // FIXME: Check that the component type == GL_FLOAT!
-                    //        (it should be, but you never know...)
-                    const auto gltfCompSize = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(attribAccessor.componentType));
-                    const auto gltfCompCount = static_cast<size_t>(tinygltf::GetNumComponentsInType(attribAccessor.type));
-                    const auto gltfAttribSize = gltfCompSize * gltfCompCount;
-                    if(gltfAttribSize != vertAttrib.size)
-                    {
-                        BOYD_LOG(Warn, "{}: GLTF attribute {}'s size is ({}x{})B, but in Mesh it's {}B - truncating!",
-                                 filepath, attribPair.first, gltfCompSize, gltfCompCount, vertAttrib.size);
-                    }
-                    const size_t attribSize = std::min(gltfAttribSize, vertAttrib.size);
+                const auto &attribBufferView = gltfModel.bufferViews[attribAccessor.bufferView];
+                const int attribStride = attribAccessor.ByteStride(attribBufferView); // (Interleaved or packed)
+                const size_t attribSize = tinygltf::GetComponentSizeInBytes(attribAccessor.componentType)
+                                          * gltfCompCount;
+                const size_t attribBytes = attribAccessor.count > 0
+                                               ? (attribAccessor.count - 1) * attribStride + attribSize
+                                               : 0;
+                const uint8_t *readPtr = nullptr;
+                if(attribStride > 0)
+                {
+                    readPtr = BufferViewData(attribAccessor.bufferView, attribAccessor.byteOffset, attribBytes);
+                }
+                if(!readPtr)
+                {
+                    BOYD_LOG(Warn, "{}: GLTF attribute {} has an invalid stride or is out of bounds - skipping it!",
+                             filepath, attribPair.first);
+                    continue;
+                }
 
-                    const auto &attribBufferView = gltfModel.bufferViews[attribAccessor.bufferView];
-                    const auto &attribBuffer = gltfModel.buffers[attribBufferView.buffer];
+                // Ensure there are enough vertices to store all attribute values for this primitive
+                outMeshData->vertices.resize(std::max(outMeshData->vertices.size(), attribAccessor.count));
 
-                    // Ensure there are enough vertices to store all attribute values for this primitive
-                    outMeshData->vertices.resize(nVertsPrev + attribAccessor.count);
+                uint8_t *writePtr = reinterpret_cast<uint8_t *>(outMeshData->vertices.data()) + vertAttrib.offset;
+                if(!ScatterGltfAttribute(attribAccessor.componentType, compCount, attribAccessor.normalized, readPtr,
+                                         size_t(attribStride), attribAccessor.count, writePtr))
+                {
+                    BOYD_LOG(Warn, "{}: GLTF attribute {} has an unsupported type - skipping it!", filepath,
+                             attribPair.first);
+                }
+            }
 
-                    const uint8_t *readPtr = &attribBuffer.data[attribBufferView.byteOffset + attribAccessor.byteOffset];
-                    uint8_t *writePtr = reinterpret_cast<uint8_t *>(&outMeshData->vertices[nVertsPrev]) + vertAttrib.offset;
-                    for(size_t iVertex = 0; iVertex < attribAccessor.count; iVertex++)
-                    {
-                        memcpy(writePtr, readPtr, attribSize);
-                        writePtr += sizeof(comp::Mesh::Vertex);
-                        readPtr += gltfAttribSize;
-                    }
+            if(primitive.indices >= 0)
+            {
+                const auto &idxAccessor = gltfModel.accessors[primitive.indices];
+                const size_t idxSize = tinygltf::GetComponentSizeInBytes(idxAccessor.componentType);
+                const uint8_t *idxReadPtr = BufferViewData(idxAccessor.bufferView, idxAccessor.byteOffset,
+                                                           idxAccessor.count * idxSize);
+                outMeshData->indices.resize(idxAccessor.count);
+                if(!idxReadPtr
+                   || !WidenGltfIndices(idxAccessor.componentType, idxReadPtr, idxAccessor.count, 0,
+                                        outMeshData->indices.data())
+                   || !kernels::IndicesInRange(outMeshData->indices.data(), outMeshData->indices.size(),
+                                               outMeshData->vertices.size()))
+                {
+                    BOYD_LOG(Warn, "{}: mesh primitive indices are invalid or out of bounds - skipping primitive!",
+                             filepath);
+                    ok = false;
+                    return false;
                 }
             }
+            else
+            {
+                // Non-indexed primitive
+                outMeshData->indices.resize(outMeshData->vertices.size());
+                for(size_t i = 0; i < outMeshData->indices.size(); i++)
+                {
+                    outMeshData->indices[i] = comp::Mesh::Index(i);
+                }
+            }
+
+            // Static scene geometry: quantize it on the GPU to save memory and bandwidth
+            outMeshData->layout = comp::Mesh::Layout::Compact();
+
+#ifdef BOYD_OPTIMIZE_MESHES
+            // Weld, reorder triangles for the vertex cache and overdraw, then reorder vertices for fetch locality
+            // (we're on an asset loader thread - so it doesn't stall rendering)
+            auto report = meshopt::Optimize(*outMeshData);
+            BOYD_LOG(Debug, "{}: optimized mesh - vertices: {} -> {}, ACMR: {:.3f} -> {:.3f}, ATVR: {:.3f} -> {:.3f}",
+                     filepath, report.nVerticesBefore, report.nVerticesAfter, report.before.acmr, report.after.acmr,
+                     report.before.atvr, report.after.atvr);
+#endif
 
             return true; // comp::Mesh::Data was edited
         };
         outMesh.data.Edit(LoadMeshComponent);
 
-        return true;
+        return ok;
     }
 
     bool LoadTexture(int gltfTextureId, comp::Texture &outTexture)
     {
+        auto cachedIt = textureCache.find(gltfTextureId);
+        if(cachedIt != textureCache.end())
+        {
+            outTexture = cachedIt->second;
+            return true;
+        }
+
         const auto &gltfTexture = gltfModel.textures[gltfTextureId];
         const auto &gltfImage = gltfModel.images[gltfTexture.source];
 
@@ -236,10 +598,12 @@ private:
         if(formatIt == GLTF_FORMAT_MAP.end())
         {
             BOYD_LOG(Error, "Unsupporte texture format for texture {} - it will be ignored!", gltfTextureId);
+            return false;
         }
 
         // TODO IMPLEMENT image format conversion?
 
+        // (Raw pixels for now; see `FinishTextures()`)
         outTexture = comp::Texture{comp::Texture::Data{
             formatIt->second,
             unsigned(gltfImage.width),
@@ -249,64 +613,557 @@ private:
             magFilter,
             comp::Texture::Static,
         }};
+        textureCache.emplace(gltfTextureId, outTexture);
         return true;
     }
 
-    bool LoadMaterial(tinygltf::Mesh &gltfMesh, comp::Material &outMaterial)
+    /// Returns true if all texture coordinates of the mesh are in [0, 1] (i.e. its textures never need to repeat).
+    static bool TexCoordsInUnitRange(const comp::Mesh::Data &meshData)
     {
-        if(gltfMesh.primitives.empty())
+        return std::all_of(meshData.vertices.begin(), meshData.vertices.end(), [](const comp::Mesh::Vertex &vertex) {
+            return vertex.texCoord.x >= 0.0f && vertex.texCoord.x <= 1.0f && vertex.texCoord.y >= 0.0f
+                   && vertex.texCoord.y <= 1.0f;
+        });
+    }
+
+    /// Finishes the raw textures loaded by `LoadTexture()`, once all drawables are known: packs small ones into atlases
+    /// (remapping the texture coordinates of the meshes that use them), prepares them all for the GPU, and swaps them
+    /// for the identical ones already loaded by other models, if any.
+    void FinishTextures()
+    {
+        std::vector<std::pair<comp::Texture, comp::Texture>> finished; ///< Raw texture -> finished texture
+        auto findFinished = [&finished](const comp::Texture &raw) {
+            return std::find_if(finished.begin(), finished.end(), [&raw](const auto &pair) {
+                return pair.first == raw;
+            });
+        };
+
+        // Small textures can be packed, as long as no mesh that uses them needs them to repeat
+        std::vector<comp::Texture> candidates;
+        for(const auto &entry : textureCache)
         {
-            return false;
+            if(atlas::CanPack(*entry.second.data))
+            {
+                candidates.push_back(entry.second);
+            }
+        }
+        for(const auto &drawable : drawables)
+        {
+            if(!TexCoordsInUnitRange(*drawable.mesh.data))
+            {
+                for(const auto &param : drawable.material.data->parameters)
+                {
+                    if(const auto *texture = std::get_if<comp::Texture>(&param.second))
+                    {
+                        candidates.erase(std::remove(candidates.begin(), candidates.end(), *texture),
+                                         candidates.end());
+                    }
+                }
+            }
+        }
+
+        // Pack each group of (2+) compatible candidates into atlases
+        std::vector<bool> packed(candidates.size(), false);
+        size_t nPacked = 0, nAtlases = 0;
+        for(size_t i = 0; i < candidates.size(); i++)
+        {
+            if(packed[i])
+            {
+                continue;
+            }
+            std::vector<size_t> group;
+            std::vector<const comp::Texture::Data *> groupData;
+            for(size_t j = i; j < candidates.size(); j++)
+            {
+                if(!packed[j] && atlas::Compatible(*candidates[i].data, *candidates[j].data))
+                {
+                    group.push_back(j);
+                    groupData.push_back(candidates[j].data.Get());
+                }
+            }
+            if(group.size() < 2)
+            {
+                continue;
+            }
+
+            std::vector<atlas::Placement> placements;
+            std::vector<comp::Texture> atlases;
+            for(auto &atlasData : atlas::Pack(groupData, placements))
+            {
+                atlases.push_back(PrepareTexture(std::move(atlasData), atlas::MAX_LEVELS));
+            }
+            for(size_t k = 0; k < group.size(); k++)
+            {
+                packed[group[k]] = true;
+                finished.emplace_back(candidates[group[k]], atlases[placements[k].atlas]);
+                RemapTexCoords(candidates[group[k]], placements[k]);
+            }
+            nPacked += group.size();
+            nAtlases += atlases.size();
+        }
+        if(nPacked > 0)
+        {
+            BOYD_LOG(Debug, "{}: packed {} textures into {} atlases", filepath, nPacked, nAtlases);
+        }
+
+        // Finish all other textures on their own
+        for(const auto &entry : textureCache)
+        {
+            if(findFinished(entry.second) == finished.end())
+            {
+                comp::Texture::Data data;
+                auto takeData = [&data](comp::Texture::Data *rawData) -> bool {
+                    data = std::move(*rawData); // (The raw texture is dropped right after this)
+                    return true;
+                };
+                comp::Texture raw = entry.second;
+                raw.data.Edit(takeData);
+                finished.emplace_back(entry.second, PrepareTexture(std::move(data)));
+            }
+        }
+
+        auto replaceFinished = [&finished, &findFinished](comp::Material::Data *materialData) -> bool {
+            bool replaced = false;
+            for(auto &param : materialData->parameters)
+            {
+                auto *texture = std::get_if<comp::Texture>(&param.second);
+                auto finishedIt = texture ? findFinished(*texture) : finished.end();
+                if(finishedIt != finished.end())
+                {
+                    *texture = finishedIt->second;
+                    replaced = true;
+                }
+            }
+            return replaced;
+        };
+        for(auto &entry : materialCache) // (Drawables share the materials in the cache)
+        {
+            entry.second.data.Edit(replaceFinished);
+        }
+    }
+
+    /// Remaps the texture coordinates of all meshes that use `texture` to where it was packed in an atlas.
+    /// Meshes that are also drawn with another diffuse map are cloned first: only the clone is remapped, and only the
+    /// drawables that use `texture` are switched to it.
+    void RemapTexCoords(const comp::Texture &texture, const atlas::Placement &placement)
+    {
+        auto remap = [&placement](comp::Mesh::Data *meshData) -> bool {
+            for(auto &vertex : meshData->vertices)
+            {
+                vertex.texCoord = vertex.texCoord * placement.scale + placement.offset;
+            }
+            // (Half floats are too coarse to address texels of an atlas; coordinates are still in [0, 1])
+            meshData->layout.texCoord = comp::Mesh::Layout::TexCoordUnorm16;
+            return true;
+        };
+        auto usesTexture = [&texture](const Drawable &drawable) {
+            const auto &parameters = drawable.material.data->parameters;
+            const auto paramIt = parameters.find("DiffuseMap");
+            const auto *usedTexture = (paramIt != parameters.end()) ? std::get_if<comp::Texture>(&paramIt->second)
+                                                                    : nullptr;
+            return usedTexture && *usedTexture == texture;
+        };
+
+        // (Meshes can be instanced by multiple drawables)
+        std::vector<std::pair<const comp::Mesh::Data *, comp::Mesh>> remapped; ///< Original mesh data -> remapped mesh
+        for(auto &drawable : drawables)
+        {
+            if(!usesTexture(drawable))
+            {
+                continue;
+            }
+            const comp::Mesh::Data *meshData = drawable.mesh.data.Get();
+            auto remappedIt = std::find_if(remapped.begin(), remapped.end(), [meshData](const auto &pair) {
+                return pair.first == meshData;
+            });
+            if(remappedIt == remapped.end())
+            {
+                const bool shared = std::any_of(drawables.begin(), drawables.end(), [&](const Drawable &other) {
+                    return other.mesh.data.Get() == meshData && !usesTexture(other);
+                });
+                comp::Mesh mesh = drawable.mesh;
+                if(shared)
+                {
+                    mesh.data = Versioned<comp::Mesh::Data>::Make(*meshData);
+                }
+                mesh.data.Edit(remap);
+                remappedIt = remapped.insert(remapped.end(), std::make_pair(meshData, std::move(mesh)));
+            }
+            drawable.mesh = remappedIt->second;
         }
-        const auto &gltfPrimitive = gltfMesh.primitives[0];
-        const auto &gltfMaterial = gltfModel.materials[gltfPrimitive.material];
+    }
 
-        // TODO: This only loads the first primitive's material...
+    /// Loads the GLTF material with the given index (or the default material if -1).
+    bool LoadMaterial(int gltfMaterialIndex, comp::Material &outMaterial)
+    {
         // TODO: Also load the color multipliers for the textures?
         // TODO: Load other textures?
 
-        int gltfDiffuseTextureIndex = gltfMaterial.pbrMetallicRoughness.baseColorTexture.index;
-
-        comp::Texture diffuseMap{comp::Texture::Data{
-            comp::Texture::RGB8,
-            1,
-            1,
-            {255, 255, 255},
-            comp::Texture::Nearest,
-            comp::Texture::Nearest,
-            comp::Texture::Static,
-        }};
+        int gltfDiffuseTextureIndex = -1;
+        if(gltfMaterialIndex >= 0 && size_t(gltfMaterialIndex) < gltfModel.materials.size())
+        {
+            const auto &gltfMaterial = gltfModel.materials[gltfMaterialIndex];
+            gltfDiffuseTextureIndex = gltfMaterial.pbrMetallicRoughness.baseColorTexture.index;
+        }
 
+        comp::Texture diffuseMap = DefaultDiffuseMap();
         if(gltfDiffuseTextureIndex >= 0)
         {
-            const auto &gltfDiffuseTexture = gltfModel.textures[gltfDiffuseTextureIndex];
-            if(!LoadTexture(gltfDiffuseTexture.source, diffuseMap))
+            if(!LoadTexture(gltfDiffuseTextureIndex, diffuseMap))
             {
                 BOYD_LOG(Error, "Failed to load diffuse map!");
             }
         }
         // else: default to the white texture
 
-        outMaterial.parameters["DiffuseMap"] = std::move(diffuseMap);
+        outMaterial = comp::Material{{"DiffuseMap", std::move(diffuseMap)}};
 
         return true;
     }
 };
 
+/// The chunks of a binary GLTF (.glb) file.
+struct GlbChunks
+{
+    const char *json{nullptr};
+    size_t jsonSize{0};
+    const uint8_t *bin{nullptr}; ///< (Null if the file has no binary chunk)
+    size_t binSize{0};
+
+    /// Splits the .glb file in `bytes` into its chunks (which point into `bytes`). Returns false if it is not valid.
+    bool Parse(const uint8_t *bytes, size_t size)
+    {
+        static constexpr uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+        static constexpr uint32_t CHUNK_JSON = 0x4E4F534A;
+        static constexpr uint32_t CHUNK_BIN = 0x004E4942;
+
+        auto readU32 = [&](size_t offset) {
+            uint32_t value;
+            std::memcpy(&value, bytes + offset, sizeof(value)); // (GLB is little-endian, like all our targets)
+            return value;
+        };
+
+        if(size < 20 || readU32(0) != GLB_MAGIC || readU32(4) != 2 || readU32(8) > size)
+        {
+            return false;
+        }
+        size = readU32(8);
+
+        for(size_t offset = 12; offset + 8 <= size;)
+        {
+            const size_t chunkSize = readU32(offset);
+            const uint32_t chunkType = readU32(offset + 4);
+            offset += 8;
+            if(chunkSize > size - offset)
+            {
+                return false;
+            }
+            if(chunkType == CHUNK_JSON && !json)
+            {
+                json = reinterpret_cast<const char *>(bytes + offset);
+                jsonSize = chunkSize;
+            }
+            else if(chunkType == CHUNK_BIN && !bin)
+            {
+                bin = bytes + offset;
+                binSize = chunkSize;
+            }
+            offset += (chunkSize + 3) & ~size_t(3); // (Chunks are 4-byte aligned)
+        }
+        return json != nullptr;
+    }
+};
+
+/// A minimal JSON scanner, that finds values in a JSON document without parsing (nor allocating) anything.
+/// Positions are offsets into `json`; `npos` if there is no such value, or if the JSON is malformed there.
+struct JsonScanner
+{
+    static constexpr size_t npos = std::string_view::npos;
+
+    std::string_view json;
+
+    /// Returns the position of the first non-whitespace character from `pos` on.
+    size_t SkipSpace(size_t pos) const
+    {
+        while(pos < json.size() && (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\n' || json[pos] == '\r'))
+        {
+            pos++;
+        }
+        return pos < json.size() ? pos : npos;
+    }
+
+    /// Returns the position right after the value that starts at `pos`.
+    size_t SkipValue(size_t pos) const
+    {
+        if(pos >= json.size())
+        {
+            return npos;
+        }
+        if(json[pos] != '{' && json[pos] != '[' && json[pos] != '"')
+        {
+            // Number, true, false or null
+            while(pos < json.size() && std::string_view{",}] \t\n\r"}.find(json[pos]) == npos)
+            {
+                pos++;
+            }
+            return pos;
+        }
+
+        size_t depth = 0;
+        for(; pos < json.size(); pos++)
+        {
+            const char c = json[pos];
+            if(c == '"')
+            {
+                for(pos++; pos < json.size() && json[pos] != '"'; pos++)
+                {
+                    pos += json[pos] == '\\'; // (Skip escaped characters)
+                }
+                if(pos >= json.size())
+                {
+                    return npos;
+                }
+            }
+            else if(c == '{' || c == '[')
+            {
+                depth++;
+            }
+            else if(c == '}' || c == ']')
+            {
+                depth--;
+            }
+            if(depth == 0)
+            {
+                return pos + 1;
+            }
+        }
+        return npos;
+    }
+
+    /// Calls `onElement(index, valuePos)` for each element of the array (or member value of the object) at `pos`.
+    /// Returns the position of the closing bracket, or `npos` if malformed.
+    template <typename TOnElement>
+    size_t ForEach(size_t pos, TOnElement &&onElement) const
+    {
+        if(pos >= json.size() || (json[pos] != '[' && json[pos] != '{'))
+        {
+            return npos;
+        }
+        const bool isObject = json[pos] == '{';
+        const char close = isObject ? '}' : ']';
+        pos = SkipSpace(pos + 1);
+        for(size_t index = 0; pos != npos; index++)
+        {
+            if(json[pos] == close && index == 0)
+            {
+                return pos;
+            }
+            if(isObject)
+            {
+                // Skip the key
+                pos = SkipSpace(SkipValue(pos));
+                if(pos == npos || json[pos] != ':')
+                {
+                    return npos;
+                }
+                pos = SkipSpace(pos + 1);
+            }
+            if(pos == npos)
+            {
+                return npos;
+            }
+            onElement(index, pos);
+            pos = SkipSpace(SkipValue(pos));
+            if(pos == npos || json[pos] == close)
+            {
+                return pos;
+            }
+            if(json[pos] != ',')
+            {
+                return npos;
+            }
+            pos = SkipSpace(pos + 1);
+        }
+        return npos;
+    }
+
+    /// Returns the position of the value of the member `key` of the object at `pos`.
+    size_t Member(size_t pos, std::string_view key) const
+    {
+        if(pos >= json.size() || json[pos] != '{')
+        {
+            return npos;
+        }
+        // NOTE: Keys with escape sequences never match; glTF's don't have any
+        for(pos = SkipSpace(pos + 1); pos != npos && json[pos] == '"';)
+        {
+            const size_t keyEnd = SkipValue(pos);
+            const size_t colon = SkipSpace(keyEnd);
+            if(colon == npos || json[colon] != ':')
+            {
+                return npos;
+            }
+            const size_t valuePos = SkipSpace(colon + 1);
+            if(json.substr(pos + 1, keyEnd - pos - 2) == key)
+            {
+                return valuePos;
+            }
+            pos = SkipSpace(SkipValue(valuePos));
+            if(pos == npos || json[pos] != ',')
+            {
+                return npos;
+            }
+            pos = SkipSpace(pos + 1);
+        }
+        return npos;
+    }
+
+    /// Reads the unsigned integer at `pos`; returns `fallback` if there is none.
+    size_t Unsigned(size_t pos, size_t fallback) const
+    {
+        if(pos >= json.size() || json[pos] < '0' || json[pos] > '9')
+        {
+            return fallback;
+        }
+        size_t value = 0;
+        for(; pos < json.size() && json[pos] >= '0' && json[pos] <= '9'; pos++)
+        {
+            value = value * 10 + size_t(json[pos] - '0');
+        }
+        return value;
+    }
+};
+
 template <>
 struct Loader<comp::Gltf>
 {
     static std::unique_ptr<LoadedAssetBase> Load(std::string filepath)
     {
+        // Map the .glb and let tinygltf only parse its JSON chunk: its binary chunk is read in place later, instead of
+        // being read to memory and then copied to a `tinygltf::Buffer`
+        FileView file = Vfs::instance().Open(filepath);
+        if(!file)
+        {
+            BOYD_LOG(Error, "{}: could not open file", filepath);
+            return nullptr;
+        }
+        if(cooked::HasMagic(file.data, file.size))
+        {
+            return LoadCooked(filepath, file);
+        }
+        GlbChunks glb;
+        if(!glb.Parse(file.data, file.size))
+        {
+            BOYD_LOG(Error, "{}: not a valid .glb file", filepath);
+            return nullptr;
+        }
+
+        // Patch the JSON chunk for tinygltf - which then parses it, only once. The few spans that need to change are
+        // found by `JsonScanner` and spliced; everything else is passed through as is.
+        const JsonScanner scanner{std::string_view{glb.json, glb.jsonSize}};
+        const size_t root = scanner.SkipSpace(0);
+        if(root == JsonScanner::npos || glb.json[root] != '{')
+        {
+            BOYD_LOG(Error, "{}: invalid JSON chunk", filepath);
+            return nullptr;
+        }
+        struct Splice
+        {
+            size_t begin, end; ///< The span of the JSON chunk to replace
+            std::string text;  ///< What to replace it with
+        };
+        std::vector<Splice> splices;
+
+        // The buffer without an URI (if any) is the binary chunk. Pretend it's a 1-byte placeholder to tinygltf...
+        int binBuffer = -1;
+        scanner.ForEach(scanner.Member(root, "buffers"), [&](size_t i, size_t jsonBuffer) {
+            if(binBuffer >= 0 || scanner.Member(jsonBuffer, "uri") != JsonScanner::npos)
+            {
+                return;
+            }
+            binBuffer = int(i);
+            const size_t byteLength = scanner.Unsigned(scanner.Member(jsonBuffer, "byteLength"), 0);
+            if(glb.bin && byteLength <= glb.binSize)
+            {
+                splices.push_back({jsonBuffer, scanner.SkipValue(jsonBuffer),
+                                   R"({"uri":"data:application/octet-stream;base64,AA==","byteLength":1})"});
+            }
+        });
+        if(binBuffer >= 0 && splices.empty())
+        {
+            BOYD_LOG(Error, "{}: binary chunk is missing or too small", filepath);
+            return nullptr;
+        }
+
+        // ... and have it decode images stored in it from a placeholder buffer view (the whole placeholder), which
+        // `LoadGlbImage()` then swaps for the actual bytes in the binary chunk
+        GlbImageSources imageSources{glb.bin, {}};
+        const size_t jsonBufferViews = scanner.Member(root, "bufferViews");
+        std::vector<std::pair<size_t, size_t>> binViews; ///< Buffer view index -> (offset, length); length 0 if not in bin
+        const size_t bufferViewsEnd = scanner.ForEach(jsonBufferViews, [&](size_t, size_t jsonView) {
+            const bool inBin = binBuffer >= 0 && scanner.Unsigned(scanner.Member(jsonView, "buffer"), SIZE_MAX)
+                                                     == size_t(binBuffer);
+            binViews.emplace_back(scanner.Unsigned(scanner.Member(jsonView, "byteOffset"), 0),
+                                  inBin ? scanner.Unsigned(scanner.Member(jsonView, "byteLength"), 0) : 0);
+        });
+        std::string placeholderViews;
+        size_t nPlaceholderViews = 0;
+        bool imagesOk = true;
+        scanner.ForEach(scanner.Member(root, "images"), [&](size_t i, size_t jsonImage) {
+            const size_t viewPos = scanner.Member(jsonImage, "bufferView");
+            const size_t viewIndex = scanner.Unsigned(viewPos, SIZE_MAX);
+            if(viewIndex >= binViews.size() || binViews[viewIndex].second == 0)
+            {
+                return;
+            }
+            const auto &range = binViews[viewIndex];
+            if(range.first + range.second > glb.binSize)
+            {
+                BOYD_LOG(Error, "{}: image {} is out of the binary chunk's bounds", filepath, i);
+                imagesOk = false;
+                return;
+            }
+            imageSources.ranges.resize(std::max(imageSources.ranges.size(), i + 1), {0, 0});
+            imageSources.ranges[i] = range;
+
+            const size_t placeholderView = binViews.size() + nPlaceholderViews++;
+            splices.push_back({viewPos, scanner.SkipValue(viewPos), std::to_string(placeholderView)});
+            placeholderViews += R"(,{"buffer":)" + std::to_string(binBuffer) + R"(,"byteLength":1})";
+        });
+        if(!imagesOk)
+        {
+            return nullptr;
+        }
+        if(!placeholderViews.empty() && bufferViewsEnd != JsonScanner::npos)
+        {
+            splices.push_back({bufferViewsEnd, bufferViewsEnd, std::move(placeholderViews)});
+        }
+
+        std::sort(splices.begin(), splices.end(), [](const Splice &lhs, const Splice &rhs) {
+            return lhs.begin < rhs.begin;
+        });
+        std::string patchedJson;
+        patchedJson.reserve(glb.jsonSize + 256);
+        size_t copied = 0;
+        for(const auto &splice : splices)
+        {
+            patchedJson.append(glb.json + copied, splice.begin - copied);
+            patchedJson += splice.text;
+            copied = splice.end;
+        }
+        patchedJson.append(glb.json + copied, glb.jsonSize - copied);
+
         tinygltf::TinyGLTF gltf;
+        gltf.SetImageLoader(&LoadGlbImage, &imageSources);
         tinygltf::Model model;
-        bool ok = false;
-
         std::string err, warn;
-        ok = gltf.LoadBinaryFromFile(&model, &err, &warn, filepath);
+        // (External buffers/images are still read by tinygltf, as loose files)
+        const std::string baseDir = std::filesystem::path{BOYD_FS_PREFIX + filepath}.parent_path().string();
+        bool ok = gltf.LoadASCIIFromString(&model, &err, &warn, patchedJson.data(), unsigned(patchedJson.size()),
+                                           baseDir);
         if(!warn.empty())
         {
-            BOYD_LOG(Warn, "{}: {}", filepath, err);
+            BOYD_LOG(Warn, "{}: {}", filepath, warn);
         }
         if(!err.empty())
         {
@@ -315,13 +1172,119 @@ struct Loader<comp::Gltf>
 
         if(ok)
         {
-            return std::make_unique<LoadedGltfModel>(filepath, std::move(model));
+            // NOTE: The components are built (i.e. data is read from `file`) in the constructor, before `file` is
+            //       released
+            return std::make_unique<LoadedGltfModel>(filepath, std::move(model), binBuffer, glb.bin, glb.binSize);
         }
         else
         {
             return nullptr;
         }
     }
+
+private:
+    /// Loads a model cooked by BoydCooker: meshes and textures are copied straight out of the mapped file.
+    static std::unique_ptr<LoadedAssetBase> LoadCooked(const std::string &filepath, const FileView &file)
+    {
+        const uint8_t *bytes = file.data;
+        const size_t size = file.size;
+        if(!cooked::GetHeader(bytes, size, cooked::AssetType::Model))
+        {
+            BOYD_LOG(Error, "{}: not a cooked model, or cooked for another engine version - recook it!", filepath);
+            return nullptr;
+        }
+        const auto *model = cooked::At<cooked::Model>(bytes, size, sizeof(cooked::Header));
+        const auto *cookedMeshes = model ? cooked::At<cooked::Mesh>(bytes, size, model->meshesOffset, model->nMeshes)
+                                         : nullptr;
+        const auto *cookedTextures = model ? cooked::At<cooked::Texture>(bytes, size, model->texturesOffset,
+                                                                         model->nTextures)
+                                           : nullptr;
+        const auto *cookedMaterials = model ? cooked::At<cooked::Material>(bytes, size, model->materialsOffset,
+                                                                           model->nMaterials)
+                                            : nullptr;
+        const auto *cookedDrawables = model ? cooked::At<cooked::Drawable>(bytes, size, model->drawablesOffset,
+                                                                           model->nDrawables)
+                                            : nullptr;
+        if(!cookedMeshes || !cookedTextures || !cookedMaterials || !cookedDrawables)
+        {
+            BOYD_LOG(Error, "{}: corrupt cooked model", filepath);
+            return nullptr;
+        }
+
+        // (Drawables that share meshes/materials share their data, like when loading the GLTF)
+        std::vector<comp::Mesh> meshes(model->nMeshes);
+        for(uint32_t i = 0; i < model->nMeshes; i++)
+        {
+            bool ok = true;
+            auto readMesh = [&](comp::Mesh::Data *outMeshData) -> bool {
+                ok = cooked::ReadMesh(bytes, size, cookedMeshes[i], *outMeshData);
+                return ok;
+            };
+            meshes[i].data.Edit(readMesh);
+            if(!ok)
+            {
+                BOYD_LOG(Error, "{}: corrupt cooked mesh {}", filepath, i);
+                return nullptr;
+            }
+        }
+        std::vector<comp::Texture> textures;
+        textures.reserve(model->nTextures);
+        for(uint32_t i = 0; i < model->nTextures; i++)
+        {
+            comp::Texture::Data textureData;
+            if(!cooked::ReadTexture(bytes, size, cookedTextures[i], textureData))
+            {
+                BOYD_LOG(Error, "{}: corrupt cooked texture {}", filepath, i);
+                return nullptr;
+            }
+            textures.push_back(TextureRegistry::instance().Intern(std::move(textureData)));
+        }
+        std::vector<comp::Material> materials(model->nMaterials);
+        for(uint32_t i = 0; i < model->nMaterials; i++)
+        {
+            const int32_t diffuseMap = cookedMaterials[i].diffuseMap;
+            materials[i] = comp::Material{{"DiffuseMap", (diffuseMap >= 0 && uint32_t(diffuseMap) < model->nTextures)
+                                                             ? textures[size_t(diffuseMap)]
+                                                             : LoadedGltfModel::DefaultDiffuseMap()}};
+        }
+
+        std::vector<LoadedGltfModel::Drawable> drawables;
+        drawables.reserve(model->nDrawables);
+        for(uint32_t i = 0; i < model->nDrawables; i++)
+        {
+            const auto &drawable = cookedDrawables[i];
+            if(drawable.mesh >= model->nMeshes || drawable.material >= model->nMaterials)
+            {
+                BOYD_LOG(Error, "{}: corrupt cooked drawable {}", filepath, i);
+                return nullptr;
+            }
+            glm::mat4 transform;
+            std::memcpy(&transform, drawable.transform, sizeof(drawable.transform));
+            drawables.push_back({transform, meshes[drawable.mesh], materials[drawable.material]});
+        }
+        return std::make_unique<LoadedGltfModel>(filepath, std::move(drawables));
+    }
+
+    /// Where the images stored in a .glb's binary chunk are.
+    struct GlbImageSources
+    {
+        const uint8_t *bin;
+        std::vector<std::pair<size_t, size_t>> ranges; ///< Image index -> (offset, length) in `bin`; length 0 if none
+    };
+
+    /// A tinygltf image loader that decodes images stored in the binary chunk in place.
+    static bool LoadGlbImage(tinygltf::Image *image, const int imageIndex, std::string *err, std::string *warn,
+                             int reqWidth, int reqHeight, const unsigned char *bytes, int size, void *userData)
+    {
+        const auto *sources = static_cast<const GlbImageSources *>(userData);
+        if(imageIndex >= 0 && size_t(imageIndex) < sources->ranges.size() && sources->ranges[imageIndex].second > 0)
+        {
+            const auto &range = sources->ranges[imageIndex];
+            bytes = sources->bin + range.first;
+            size = int(range.second);
+        }
+        return tinygltf::LoadImageData(image, imageIndex, err, warn, reqWidth, reqHeight, bytes, size, nullptr);
+    }
 };
 
 } // namespace boyd
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "../../../Components/LuaBehaviour.hh"
-#include "../../../Core/Utils.hh"
+#include "../../../Core/Vfs.hh"
 
 namespace boyd
 {
@@ -12,7 +12,7 @@ struct Loader<comp::LuaBehaviour>
     static std::unique_ptr<LoadedAssetBase> Load(std::string filepath)
     {
         std::string buffer;
-        if(Slurp(filepath, buffer))
+        if(Vfs::instance().Slurp(filepath, buffer))
         {
             auto ptr = std::make_unique<LoadedAsset<comp::LuaBehaviour>>(std::move(buffer));
             ptr->asset.description = filepath;
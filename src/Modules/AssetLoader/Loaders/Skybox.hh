@@ -0,0 +1,108 @@
+#pragma once
+
+#include <BoydEngine.hh>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "../../../Components/Skybox.hh"
+#include "../../../Core/ThreadPool.hh"
+#include "../../../Core/Vfs.hh"
+#include "../../../Debug/Log.hh"
+#include "../CookedFormat.hh"
+#include "../EnvironmentKernels.hh"
+#include "../LoadedAsset.hh"
+
+#include <stb_image.h> // (Implemented along with tinygltf, see "Gltf.hh")
+
+namespace boyd
+{
+
+/// Copies of a `comp::Skybox` all share the same cube maps.
+template <>
+inline long AssetReferenceCount<comp::Skybox>(const comp::Skybox &asset)
+{
+    return asset.data.ReferenceCount();
+}
+
+/// Loads a skybox from an equirectangular panorama: either a HDR (or LDR) image, or a cooked RGB(A)16F texture.
+/// The cube maps for image-based lighting are prefiltered here, spread over all hardware threads.
+template <>
+struct Loader<comp::Skybox>
+{
+    static std::unique_ptr<LoadedAssetBase> Load(std::string filepath)
+    {
+        FileView file = Vfs::instance().Open(filepath);
+        if(!file)
+        {
+            BOYD_LOG(Warn, "Could not load the asset {}", filepath);
+            return nullptr;
+        }
+
+        comp::Texture::Data panorama;
+        if(cooked::HasMagic(file.data, file.size))
+        {
+            if(!cooked::ReadTextureFile(file.data, file.size, panorama))
+            {
+                BOYD_LOG(Error, "{}: corrupt cooked texture, or cooked for another engine version - recook it!",
+                         filepath);
+                return nullptr;
+            }
+        }
+        else if(!LoadHdr(filepath, file, panorama))
+        {
+            return nullptr;
+        }
+
+        const kernels::FloatImage equirect = kernels::DecodeHalfImage(panorama);
+        if(equirect.texels.empty())
+        {
+            BOYD_LOG(Error, "{}: skyboxes must be RGB(A)16F textures (format {} is not)", filepath,
+                     int(panorama.format));
+            return nullptr;
+        }
+
+        // Prefilter with helper threads - but only with this loader thread's share of the cores, as the other loader
+        // threads may be prefiltering skyboxes too
+        const unsigned nLoaderThreads = std::max(ThreadPool::DefaultSize(BOYD_ASSET_LOADER_THREADS), 1u);
+        const unsigned nThreads = std::max(std::thread::hardware_concurrency() / nLoaderThreads, 1u);
+        comp::Skybox result{Versioned<comp::Skybox::Data>::Make(kernels::PrefilterEnvironment(equirect, nThreads))};
+        BOYD_LOG(Debug, "{}: prefiltered to {}x{} cube maps", filepath, result.data->environment.faces[0].width,
+                 result.data->environment.faces[0].width);
+        return std::make_unique<LoadedAsset<comp::Skybox>>(std::move(result));
+    }
+
+private:
+    /// Decodes an image (usually a Radiance .hdr) to a RGB16F texture.
+    /// LDR images are converted to linear by stb_image, so they work too - just without any dynamic range.
+    static bool LoadHdr(const std::string &filepath, const FileView &file, comp::Texture::Data &out)
+    {
+        static constexpr int CHANNELS = 3;
+        static constexpr float HALF_MAX = 65504.0f; ///< (Clamp to it, or a bright sun would turn to infinity)
+
+        int width = 0, height = 0, nComponents = 0;
+        float *pixels = stbi_loadf_from_memory(file.data, int(file.size), &width, &height, &nComponents, CHANNELS);
+        if(!pixels)
+        {
+            BOYD_LOG(Error, "{}: {}", filepath, stbi_failure_reason());
+            return false;
+        }
+
+        out.format = comp::Texture::RGB16F;
+        out.width = unsigned(width);
+        out.height = unsigned(height);
+        const size_t nValues = size_t(width) * size_t(height) * CHANNELS;
+        out.pixels.resize(nValues * sizeof(uint16_t));
+        for(size_t i = 0; i < nValues; i++)
+        {
+            const uint16_t half = FloatToHalf(std::min(pixels[i], HALF_MAX));
+            std::memcpy(out.pixels.data() + i * sizeof(uint16_t), &half, sizeof(half));
+        }
+        stbi_image_free(pixels);
+        return true;
+    }
+};
+
+} // namespace boyd
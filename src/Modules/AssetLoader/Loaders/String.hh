@@ -1,7 +1,7 @@
 #pragma once
 
 #include "../../../Components/String.hh"
-#include "../../../Core/Utils.hh"
+#include "../../../Core/Vfs.hh"
 
 namespace boyd
 {
@@ -12,7 +12,7 @@ struct Loader<comp::String>
     static std::unique_ptr<LoadedAssetBase> Load(std::string filepath)
     {
         std::string buffer;
-        if(Slurp(filepath, buffer))
+        if(Vfs::instance().Slurp(filepath, buffer))
         {
             return std::make_unique<LoadedAsset<comp::String>>(std::move(buffer));
         }
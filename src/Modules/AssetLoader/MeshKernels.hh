@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "../../Components/Mesh.hh"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define BOYD_MESH_KERNELS_SSE2
+#endif
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#    define BOYD_MESH_KERNELS_AVX2
+#endif
+
+// NOTE: Kernels that convert mesh data as it is stored in files (glTF-style accessors) to `comp::Mesh::Data`.
+//       All input pointers may be unaligned.
+//       Only index widening uses SIMD (SSE2 or AVX2, if compiled with them); attributes are scattered into vertices
+//       one value at a time, by code specialized on their type and number of components.
+
+namespace boyd
+{
+namespace kernels
+{
+
+/// Converts `count` unsigned integer indices of type `TIndex` stored at `in` to `comp::Mesh::Index`es, adding `base`
+/// to each (i.e. the number of vertices of the primitives merged before this one).
+template <typename TIndex>
+inline void WidenIndices(const uint8_t *in, size_t count, comp::Mesh::Index base, comp::Mesh::Index *out)
+{
+    static_assert(std::is_unsigned<TIndex>::value && sizeof(TIndex) <= sizeof(comp::Mesh::Index),
+                  "Indices must be unsigned and at most as big as comp::Mesh::Index");
+    static_assert(sizeof(comp::Mesh::Index) == sizeof(uint32_t), "Kernels assume 32-bit comp::Mesh::Index");
+
+    size_t i = 0;
+
+#if defined(BOYD_MESH_KERNELS_AVX2)
+    const __m256i base8 = _mm256_set1_epi32(int(base));
+    for(; i + 8 <= count; i += 8)
+    {
+        const uint8_t *src = in + i * sizeof(TIndex);
+        __m256i wide;
+        if constexpr(sizeof(TIndex) == 1)
+        {
+            wide = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src)));
+        }
+        else if constexpr(sizeof(TIndex) == 2)
+        {
+            wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+        }
+        else
+        {
+            wide = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_add_epi32(wide, base8));
+    }
+#elif defined(BOYD_MESH_KERNELS_SSE2)
+    const __m128i base4 = _mm_set1_epi32(int(base));
+    const __m128i zero = _mm_setzero_si128();
+    if constexpr(sizeof(TIndex) == 1)
+    {
+        for(; i + 16 <= count; i += 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            __m128i lo16 = _mm_unpacklo_epi8(bytes, zero);
+            __m128i hi16 = _mm_unpackhi_epi8(bytes, zero);
+            __m128i *dst = reinterpret_cast<__m128i *>(out + i);
+            _mm_storeu_si128(dst + 0, _mm_add_epi32(_mm_unpacklo_epi16(lo16, zero), base4));
+            _mm_storeu_si128(dst + 1, _mm_add_epi32(_mm_unpackhi_epi16(lo16, zero), base4));
+            _mm_storeu_si128(dst + 2, _mm_add_epi32(_mm_unpacklo_epi16(hi16, zero), base4));
+            _mm_storeu_si128(dst + 3, _mm_add_epi32(_mm_unpackhi_epi16(hi16, zero), base4));
+        }
+    }
+    else if constexpr(sizeof(TIndex) == 2)
+    {
+        for(; i + 8 <= count; i += 8)
+        {
+            __m128i shorts = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 2));
+            __m128i *dst = reinterpret_cast<__m128i *>(out + i);
+            _mm_storeu_si128(dst + 0, _mm_add_epi32(_mm_unpacklo_epi16(shorts, zero), base4));
+            _mm_storeu_si128(dst + 1, _mm_add_epi32(_mm_unpackhi_epi16(shorts, zero), base4));
+        }
+    }
+    else
+    {
+        for(; i + 4 <= count; i += 4)
+        {
+            __m128i ints = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_add_epi32(ints, base4));
+        }
+    }
+#endif
+
+    // Scalar fallback / remainder
+    for(; i < count; i++)
+    {
+        TIndex index;
+        std::memcpy(&index, in + i * sizeof(TIndex), sizeof(TIndex));
+        out[i] = comp::Mesh::Index(index) + base;
+    }
+}
+
+/// Returns true if all `count` indices at `indices` refer to one of `nVertices` vertices.
+inline bool IndicesInRange(const comp::Mesh::Index *indices, size_t count, size_t nVertices)
+{
+    comp::Mesh::Index maxIndex = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        maxIndex = std::max(maxIndex, indices[i]);
+    }
+    return count == 0 || size_t(maxIndex) < nVertices;
+}
+
+/// Converts a single vertex attribute component to float.
+/// Normalized integers are mapped to [0, 1] (unsigned) or [-1, 1] (signed) like OpenGL does.
+template <typename TComponent>
+inline float ComponentToFloat(TComponent value, bool normalized)
+{
+    if constexpr(std::is_floating_point<TComponent>::value)
+    {
+        return float(value);
+    }
+    else
+    {
+        if(!normalized)
+        {
+            return float(value);
+        }
+        constexpr float MAX = float(std::numeric_limits<TComponent>::max());
+        return std::is_signed<TComponent>::value ? std::max(float(value) / MAX, -1.0f) : float(value) / MAX;
+    }
+}
+
+/// Reads `count` attribute values of `N` components of type `TComponent` - one every `inStride` bytes from `in` -
+/// and writes them as `N` floats every `outStride` bytes to `out` (i.e. scatters them into an array of vertices).
+template <typename TComponent, size_t N>
+inline void ScatterAttribute(const uint8_t *in, size_t inStride, size_t count, bool normalized, uint8_t *out,
+                             size_t outStride)
+{
+    static_assert(N >= 1 && N <= 4, "Attributes have 1 to 4 components");
+
+    if constexpr(std::is_same<TComponent, float>::value)
+    {
+        // A plain strided copy: fixed-size copies, that the compiler turns into a couple of moves per value.
+        // (Not vectorized: every value goes to a different vertex, so there is nothing to do in parallel but moves)
+        for(size_t i = 0; i < count; i++, in += inStride, out += outStride)
+        {
+            std::memcpy(out, in, N * sizeof(float));
+        }
+    }
+    else
+    {
+        for(size_t i = 0; i < count; i++, in += inStride, out += outStride)
+        {
+            TComponent values[N];
+            std::memcpy(values, in, sizeof(values));
+            float converted[N];
+            for(size_t c = 0; c < N; c++)
+            {
+                converted[c] = ComponentToFloat(values[c], normalized);
+            }
+            std::memcpy(out, converted, sizeof(converted));
+        }
+    }
+}
+
+/// Same as `ScatterAttribute<TComponent, N>()`, but with the number of components picked at runtime.
+/// Returns false if `nComponents` is not supported.
+template <typename TComponent>
+inline bool ScatterAttribute(const uint8_t *in, size_t inStride, size_t count, size_t nComponents, bool normalized,
+                             uint8_t *out, size_t outStride)
+{
+    switch(nComponents)
+    {
+    case 1:
+        ScatterAttribute<TComponent, 1>(in, inStride, count, normalized, out, outStride);
+        return true;
+    case 2:
+        ScatterAttribute<TComponent, 2>(in, inStride, count, normalized, out, outStride);
+        return true;
+    case 3:
+        ScatterAttribute<TComponent, 3>(in, inStride, count, normalized, out, outStride);
+        return true;
+    case 4:
+        ScatterAttribute<TComponent, 4>(in, inStride, count, normalized, out, outStride);
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace kernels
+} // namespace boyd
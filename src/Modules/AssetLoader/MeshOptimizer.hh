@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../../Components/Mesh.hh"
+#include "MeshKernels.hh"
+
+namespace boyd
+{
+namespace meshopt
+{
+
+using Index = comp::Mesh::Index;
+using Vertex = comp::Mesh::Vertex;
+
+/// Size of the (FIFO) post-transform vertex cache that is assumed by the optimizations and used to compute statistics.
+static constexpr unsigned CACHE_SIZE = 16;
+
+/// Statistics about how well a mesh uses the post-transform vertex cache (the lower the better).
+struct CacheStats
+{
+    float acmr{0.0f}; ///< Average Cache Miss Ratio = vertex shader invocations / triangles (best: ~0.5; worst: 3)
+    float atvr{0.0f}; ///< Average Transformed Vertex Ratio = vertex shader invocations / vertices (best: 1)
+};
+
+/// Simulates a FIFO vertex cache of `cacheSize` entries to compute the `CacheStats` of the given triangle list.
+inline CacheStats AnalyzeVertexCache(const std::vector<Index> &indices, size_t nVertices,
+                                     unsigned cacheSize = CACHE_SIZE)
+{
+    assert(kernels::IndicesInRange(indices.data(), indices.size(), nVertices));
+    CacheStats stats;
+    if(indices.size() < 3 || nVertices == 0)
+    {
+        return stats;
+    }
+
+    // NOTE: Each vertex stores the "time" at which it entered the cache; it is in the cache if it entered it less than
+    //       `cacheSize` misses ago
+    std::vector<size_t> enteredAt(nVertices, 0);
+    size_t nMisses = 0;
+    for(Index index : indices)
+    {
+        if(enteredAt[index] == 0 || nMisses - enteredAt[index] + 1 > cacheSize)
+        {
+            nMisses++;
+            enteredAt[index] = nMisses;
+        }
+    }
+
+    stats.acmr = float(nMisses) / float(indices.size() / 3);
+    stats.atvr = float(nMisses) / float(nVertices);
+    return stats;
+}
+
+/// Merges all vertices that are bitwise-identical, remapping `indices` accordingly.
+/// Returns the number of vertices removed.
+inline size_t WeldVertices(std::vector<Vertex> &vertices, std::vector<Index> &indices)
+{
+    assert(kernels::IndicesInRange(indices.data(), indices.size(), vertices.size()));
+    auto bytesOf = [&](Index index) {
+        return std::string_view{reinterpret_cast<const char *>(&vertices[index]), sizeof(Vertex)};
+    };
+
+    std::unordered_map<std::string_view, Index> uniqueVertices;
+    uniqueVertices.reserve(vertices.size());
+    std::vector<Index> remap(vertices.size());
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+    for(size_t i = 0; i < vertices.size(); i++)
+    {
+        auto insertion = uniqueVertices.emplace(bytesOf(Index(i)), Index(welded.size()));
+        if(insertion.second)
+        {
+            welded.push_back(vertices[i]);
+        }
+        remap[i] = insertion.first->second;
+    }
+
+    for(auto &index : indices)
+    {
+        index = remap[index];
+    }
+
+    size_t nRemoved = vertices.size() - welded.size();
+    uniqueVertices.clear(); // (Its keys point into `vertices`!)
+    vertices = std::move(welded);
+    return nRemoved;
+}
+
+/// Reorders triangles to improve vertex cache hits (Sander et al., "Fast Triangle Reordering for Vertex Locality and
+/// Reduced Overdraw", 2007 - "Tipsify"). Linear in the number of triangles.
+/// If given, `clusters` receives the index (in triangles) of the first triangle of each cluster: the cache is likely
+/// to be cold at the start of each, so they can be reordered freely, see `OptimizeOverdraw()`.
+inline void OptimizeVertexCache(std::vector<Index> &indices, size_t nVertices, unsigned cacheSize = CACHE_SIZE,
+                                std::vector<size_t> *clusters = nullptr)
+{
+    assert(kernels::IndicesInRange(indices.data(), indices.size(), nVertices));
+    const size_t nTriangles = indices.size() / 3;
+    if(nTriangles == 0)
+    {
+        return;
+    }
+
+    // Vertex -> triangle adjacency (CSR)
+    std::vector<unsigned> liveTriangles(nVertices, 0);
+    for(size_t i = 0; i < nTriangles * 3; i++)
+    {
+        liveTriangles[indices[i]]++;
+    }
+    std::vector<size_t> adjacencyStart(nVertices + 1, 0);
+    for(size_t v = 0; v < nVertices; v++)
+    {
+        adjacencyStart[v + 1] = adjacencyStart[v] + liveTriangles[v];
+    }
+    std::vector<size_t> adjacency(adjacencyStart[nVertices]);
+    {
+        std::vector<size_t> fill{adjacencyStart.begin(), adjacencyStart.end() - 1};
+        for(size_t i = 0; i < nTriangles * 3; i++)
+        {
+            adjacency[fill[indices[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<size_t> cacheTime(nVertices, 0);
+    std::vector<bool> emitted(nTriangles, false);
+    std::vector<Index> deadEnd; // (A stack)
+    std::vector<Index> candidates;
+    std::vector<Index> output;
+    output.reserve(nTriangles * 3);
+
+    size_t time = cacheSize + 1;
+    size_t cursor = 0; // Next vertex to consider when looking for a new fanning vertex in input order
+    long fanning = 0;
+    if(clusters)
+    {
+        clusters->assign(1, 0);
+    }
+
+    while(fanning >= 0)
+    {
+        // Emit all live triangles around the fanning vertex
+        candidates.clear();
+        for(size_t a = adjacencyStart[fanning]; a < adjacencyStart[fanning + 1]; a++)
+        {
+            size_t triangle = adjacency[a];
+            if(emitted[triangle])
+            {
+                continue;
+            }
+            for(size_t k = 0; k < 3; k++)
+            {
+                Index v = indices[triangle * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if(time - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // Pick the next fanning vertex: the candidate that will still be in the cache after fanning around it
+        // (and otherwise the oldest in cache), ...
+        long next = -1;
+        long bestPriority = -1;
+        for(Index v : candidates)
+        {
+            if(liveTriangles[v] == 0)
+            {
+                continue;
+            }
+            long priority = 0;
+            if(time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+            {
+                priority = long(time - cacheTime[v]);
+            }
+            if(priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = long(v);
+            }
+        }
+
+        if(next < 0)
+        {
+            // ... or, on a dead end, the most recently used vertex that still has live triangles, ...
+            while(!deadEnd.empty() && next < 0)
+            {
+                Index v = deadEnd.back();
+                deadEnd.pop_back();
+                if(liveTriangles[v] > 0)
+                {
+                    next = long(v);
+                }
+            }
+            // ... or the next one in input order with live triangles (the cache is cold by now: new cluster)
+            while(next < 0 && cursor < nVertices)
+            {
+                if(liveTriangles[cursor] > 0)
+                {
+                    next = long(cursor);
+                    if(clusters && output.size() / 3 != clusters->back())
+                    {
+                        clusters->push_back(output.size() / 3);
+                    }
+                }
+                cursor++;
+            }
+        }
+        fanning = next;
+    }
+
+    indices = std::move(output);
+}
+
+/// Reorders the `clusters` of triangles output by `OptimizeVertexCache()` so that the ones facing outwards of the mesh
+/// are drawn first, which tends to reduce overdraw as they occlude the others (Sander et al. 2007).
+/// The order of triangles inside each cluster is preserved, so the vertex cache efficiency barely changes.
+inline void OptimizeOverdraw(std::vector<Index> &indices, const std::vector<Vertex> &vertices,
+                             const std::vector<size_t> &clusters)
+{
+    const size_t nTriangles = indices.size() / 3;
+    if(clusters.size() < 2 || nTriangles == 0)
+    {
+        return;
+    }
+
+    glm::vec3 meshCentroid{0.0f};
+    for(const auto &vertex : vertices)
+    {
+        meshCentroid = meshCentroid + vertex.position;
+    }
+    meshCentroid = meshCentroid / float(std::max<size_t>(vertices.size(), 1));
+
+    struct Cluster
+    {
+        size_t begin, end; ///< Triangle range
+        float sortKey;     ///< How much it faces outwards
+    };
+    std::vector<Cluster> sorted;
+    sorted.reserve(clusters.size());
+    for(size_t c = 0; c < clusters.size(); c++)
+    {
+        Cluster cluster{clusters[c], c + 1 < clusters.size() ? clusters[c + 1] : nTriangles, 0.0f};
+
+        glm::vec3 centroid{0.0f}, normal{0.0f};
+        float totalArea = 0.0f;
+        for(size_t t = cluster.begin; t < cluster.end; t++)
+        {
+            const glm::vec3 &p0 = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0); // (Length = 2x area)
+            float area = glm::length(areaNormal);
+            centroid = centroid + (p0 + p1 + p2) * (area / 3.0f);
+            normal = normal + areaNormal;
+            totalArea += area;
+        }
+        if(totalArea > 0.0f)
+        {
+            centroid = centroid / totalArea;
+            cluster.sortKey = glm::dot(centroid - meshCentroid, normal / totalArea);
+        }
+        sorted.push_back(cluster);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &lhs, const Cluster &rhs) {
+        return lhs.sortKey > rhs.sortKey;
+    });
+
+    std::vector<Index> output;
+    output.reserve(indices.size());
+    for(const auto &cluster : sorted)
+    {
+        output.insert(output.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    }
+    indices = std::move(output);
+}
+
+/// Reorders vertices in the order they are first referenced by `indices`, so that vertex fetches are as sequential as
+/// possible; vertices that are not referenced at all are removed.
+/// Returns the number of vertices removed.
+inline size_t OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<Index> &indices)
+{
+    static constexpr Index UNMAPPED = Index(-1);
+    assert(kernels::IndicesInRange(indices.data(), indices.size(), vertices.size()));
+
+    std::vector<Index> remap(vertices.size(), UNMAPPED);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+    for(auto &index : indices)
+    {
+        if(remap[index] == UNMAPPED)
+        {
+            remap[index] = Index(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    size_t nRemoved = vertices.size() - reordered.size();
+    vertices = std::move(reordered);
+    return nRemoved;
+}
+
+/// A report of what `Optimize()` did.
+struct Report
+{
+    size_t nVerticesBefore{0}, nVerticesAfter{0};
+    CacheStats before, after;
+};
+
+/// Runs all optimizations on the given mesh data, in order: vertex welding, vertex cache, overdraw, vertex fetch.
+inline Report Optimize(comp::Mesh::Data &data)
+{
+    Report report;
+    report.nVerticesBefore = data.vertices.size();
+    report.before = AnalyzeVertexCache(data.indices, data.vertices.size());
+
+    WeldVertices(data.vertices, data.indices);
+
+    std::vector<size_t> clusters;
+    OptimizeVertexCache(data.indices, data.vertices.size(), CACHE_SIZE, &clusters);
+    OptimizeOverdraw(data.indices, data.vertices, clusters);
+
+    OptimizeVertexFetch(data.vertices, data.indices);
+
+    report.nVerticesAfter = data.vertices.size();
+    report.after = AnalyzeVertexCache(data.indices, data.vertices.size());
+    return report;
+}
+
+} // namespace meshopt
+} // namespace boyd
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <numeric>
+#include <vector>
+
+#include "../../Components/Texture.hh"
+
+namespace boyd
+{
+
+/// Packing of small textures into bigger "atlas" textures, so that the materials that use them can share a single
+/// texture (and be drawn without rebinding it in between).
+/// Textures are packed on shelves, each surrounded by `PADDING` texels that replicate its edges, so that filtering
+/// (and the first few mip levels) do not bleed its neighbours in.
+/// NOTE: Textures in an atlas can't repeat: only pack textures that are sampled with coordinates in [0, 1]!
+namespace atlas
+{
+
+static constexpr unsigned MAX_SIZE = 1024;        ///< Max width/height of an atlas
+static constexpr unsigned MAX_TEXTURE_SIZE = 128; ///< Only textures at most this big are packed
+static constexpr unsigned PADDING = 4;            ///< (Also keeps textures aligned to 4x4 compressed blocks)
+static constexpr unsigned MAX_LEVELS = 3;         ///< Mip levels of an atlas that still have a texel of padding
+
+/// Where a texture was packed: its texture coordinates map to `uv * scale + offset` in atlas number `atlas`.
+struct Placement
+{
+    size_t atlas;
+    glm::vec2 scale, offset;
+};
+
+/// Returns true if the texture is small (and simple) enough to be packed into an atlas.
+inline bool CanPack(const comp::Texture::Data &data)
+{
+    return !comp::Texture::IsCompressed(data.format) && data.levels == 1 && data.width > 0 && data.height > 0
+           && data.width <= MAX_TEXTURE_SIZE && data.height <= MAX_TEXTURE_SIZE
+           && data.pixels.size() == data.LevelSize(0);
+}
+
+/// Returns true if two textures can be packed into the same atlas.
+inline bool Compatible(const comp::Texture::Data &a, const comp::Texture::Data &b)
+{
+    return a.format == b.format && a.minFilter == b.minFilter && a.magFilter == b.magFilter && a.usage == b.usage;
+}
+
+/// Packs `textures` (which must all be `CanPack()` and `Compatible()` with each other) into as few atlases as needed.
+/// Returns the atlases; `outPlacements[i]` is where `textures[i]` was packed.
+inline std::vector<comp::Texture::Data> Pack(const std::vector<const comp::Texture::Data *> &textures,
+                                             std::vector<Placement> &outPlacements)
+{
+    outPlacements.clear();
+    if(textures.empty())
+    {
+        return {};
+    }
+    auto cellSize = [](unsigned size) {
+        return (size + 2 * PADDING + 3) / 4 * 4;
+    };
+
+    // Tallest first, so that shelves waste less space
+    std::vector<size_t> order(textures.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return textures[a]->height > textures[b]->height;
+    });
+
+    // Make atlases roughly square (but at least as wide as the widest texture)
+    size_t area = 0;
+    unsigned width = 4, widest = 0;
+    for(const auto *texture : textures)
+    {
+        area += size_t(cellSize(texture->width)) * cellSize(texture->height);
+        widest = std::max(widest, cellSize(texture->width));
+    }
+    while(size_t(width) * width < area && width < MAX_SIZE)
+    {
+        width *= 2;
+    }
+    width = std::max(width, widest);
+
+    // Place textures on shelves, starting a new atlas when one fills up
+    std::vector<unsigned> xs(textures.size()), ys(textures.size());
+    std::vector<unsigned> heights;
+    outPlacements.resize(textures.size());
+    unsigned x = 0, y = 0, shelfHeight = 0;
+    for(size_t i : order)
+    {
+        const unsigned cellWidth = cellSize(textures[i]->width), cellHeight = cellSize(textures[i]->height);
+        if(x + cellWidth > width)
+        {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        if(y + cellHeight > MAX_SIZE)
+        {
+            heights.push_back(y);
+            x = y = shelfHeight = 0;
+        }
+        xs[i] = x + PADDING;
+        ys[i] = y + PADDING;
+        outPlacements[i].atlas = heights.size();
+        x += cellWidth;
+        shelfHeight = std::max(shelfHeight, cellHeight);
+    }
+    heights.push_back(y + shelfHeight);
+
+    std::vector<comp::Texture::Data> atlases(heights.size());
+    for(size_t a = 0; a < atlases.size(); a++)
+    {
+        const auto &first = *textures[0];
+        atlases[a] = comp::Texture::Data{first.format, width, heights[a], {}, first.minFilter, first.magFilter,
+                                         first.usage};
+        atlases[a].pixels.resize(atlases[a].LevelSize(0), 0);
+    }
+
+    // Copy textures in place, replicating their edges in their padding
+    const size_t pixelSize = comp::Texture::ImageSize(textures[0]->format, 1, 1);
+    for(size_t i = 0; i < textures.size(); i++)
+    {
+        const auto &texture = *textures[i];
+        auto &atlas = atlases[outPlacements[i].atlas];
+        const size_t srcPitch = texture.width * pixelSize, dstPitch = atlas.width * pixelSize;
+        for(int row = -int(PADDING); row < int(texture.height + PADDING); row++)
+        {
+            const unsigned srcRow = unsigned(std::clamp(row, 0, int(texture.height) - 1));
+            const uint8_t *src = texture.pixels.data() + srcRow * srcPitch;
+            uint8_t *dst = atlas.pixels.data() + size_t(int(ys[i]) + row) * dstPitch + (xs[i] - PADDING) * pixelSize;
+            for(unsigned p = 0; p < PADDING; p++)
+            {
+                std::memcpy(dst + p * pixelSize, src, pixelSize);
+                std::memcpy(dst + (PADDING + texture.width + p) * pixelSize, src + srcPitch - pixelSize, pixelSize);
+            }
+            std::memcpy(dst + PADDING * pixelSize, src, srcPitch);
+        }
+
+        outPlacements[i].scale = glm::vec2{float(texture.width) / atlas.width, float(texture.height) / atlas.height};
+        outPlacements[i].offset = glm::vec2{float(xs[i]) / atlas.width, float(ys[i]) / atlas.height};
+    }
+    return atlases;
+}
+
+} // namespace atlas
+} // namespace boyd
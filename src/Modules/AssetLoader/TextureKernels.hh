@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "../../Components/Texture.hh"
+#include "../../Core/BlockCompression.hh"
+#include "../Gfx/VertexPacking.hh"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define BOYD_TEXTURE_KERNELS_SSE2
+#endif
+
+// NOTE: Kernels that prepare decoded texture data for the GPU (mip chains, block compression) on the loader threads,
+//       so that uploading a texture is just a matter of handing each level to GL.
+
+namespace boyd
+{
+namespace kernels
+{
+
+/// Returns the number of channels of an uncompressed texture format.
+inline unsigned TextureChannels(comp::Texture::Format format)
+{
+    return unsigned(format) % 4 + 1; // (R, RG, RGB, RGBA for both 8-bit and 16F)
+}
+
+/// Sums two rows of `count` bytes to 16-bit integers - the vertical half of a 2x2 box filter.
+inline void SumRows(const uint8_t *row0, const uint8_t *row1, size_t count, uint16_t *out)
+{
+    size_t i = 0;
+#if defined(BOYD_TEXTURE_KERNELS_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 16 <= count; i += 16)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + i));
+        const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 8), hi);
+    }
+#endif
+    for(; i < count; i++)
+    {
+        out[i] = uint16_t(row0[i] + row1[i]);
+    }
+}
+
+/// Averages horizontal pairs of pixels in a row of `SumRows()` - the horizontal half of a 2x2 box filter.
+template <unsigned NChannels>
+inline void AverageColumns(const uint16_t *sums, unsigned srcWidth, unsigned dstWidth, uint8_t *out)
+{
+    for(unsigned x = 0; x < dstWidth; x++)
+    {
+        const uint16_t *left = sums + size_t(2 * x) * NChannels;
+        const uint16_t *right = sums + size_t(std::min(2 * x + 1, srcWidth - 1)) * NChannels;
+        for(unsigned c = 0; c < NChannels; c++)
+        {
+            out[x * NChannels + c] = uint8_t((left[c] + right[c] + 2) >> 2);
+        }
+    }
+}
+
+/// Downsamples a `srcWidth`x`srcHeight` image with 8-bit channels to the next mip level (2x2 box filter; the last
+/// row/column of odd-sized images is repeated).
+inline void Downsample8(const uint8_t *src, unsigned srcWidth, unsigned srcHeight, unsigned channels, uint8_t *dst,
+                        unsigned dstWidth, unsigned dstHeight)
+{
+    const size_t srcPitch = size_t(srcWidth) * channels, dstPitch = size_t(dstWidth) * channels;
+    std::vector<uint16_t> sums(srcPitch);
+    for(unsigned y = 0; y < dstHeight; y++)
+    {
+        const uint8_t *row0 = src + size_t(2 * y) * srcPitch;
+        const uint8_t *row1 = src + size_t(std::min(2 * y + 1, srcHeight - 1)) * srcPitch;
+        SumRows(row0, row1, srcPitch, sums.data());
+
+        uint8_t *out = dst + y * dstPitch;
+        switch(channels)
+        {
+        case 1:
+            AverageColumns<1>(sums.data(), srcWidth, dstWidth, out);
+            break;
+        case 2:
+            AverageColumns<2>(sums.data(), srcWidth, dstWidth, out);
+            break;
+        case 3:
+            AverageColumns<3>(sums.data(), srcWidth, dstWidth, out);
+            break;
+        default:
+            AverageColumns<4>(sums.data(), srcWidth, dstWidth, out);
+            break;
+        }
+    }
+}
+
+/// Like `Downsample8()`, but for half float channels (averaged as floats).
+inline void Downsample16F(const uint8_t *src, unsigned srcWidth, unsigned srcHeight, unsigned channels, uint8_t *dst,
+                          unsigned dstWidth, unsigned dstHeight)
+{
+    auto read = [src, srcWidth, channels](unsigned x, unsigned y, unsigned c) {
+        uint16_t half;
+        std::memcpy(&half, src + ((size_t(y) * srcWidth + x) * channels + c) * sizeof(half), sizeof(half));
+        return HalfToFloat(half);
+    };
+    for(unsigned y = 0; y < dstHeight; y++)
+    {
+        const unsigned y0 = 2 * y, y1 = std::min(2 * y + 1, srcHeight - 1);
+        for(unsigned x = 0; x < dstWidth; x++)
+        {
+            const unsigned x0 = 2 * x, x1 = std::min(2 * x + 1, srcWidth - 1);
+            for(unsigned c = 0; c < channels; c++)
+            {
+                const float average = (read(x0, y0, c) + read(x1, y0, c) + read(x0, y1, c) + read(x1, y1, c)) * 0.25f;
+                const uint16_t half = FloatToHalf(average);
+                std::memcpy(dst + ((size_t(y) * dstWidth + x) * channels + c) * sizeof(half), &half, sizeof(half));
+            }
+        }
+    }
+}
+
+/// Builds the full mip chain (down to 1x1, or `maxLevels` levels at most) of a single-level, uncompressed texture.
+inline void GenerateMipmaps(comp::Texture::Data &data, unsigned maxLevels = ~0u)
+{
+    if(data.levels != 1 || comp::Texture::IsCompressed(data.format) || data.width == 0 || data.height == 0)
+    {
+        return;
+    }
+
+    unsigned levels = 1;
+    while((std::max(data.width, data.height) >> levels) > 0 && levels < maxLevels)
+    {
+        levels++;
+    }
+    data.levels = levels;
+    data.pixels.resize(data.LevelOffset(levels));
+
+    const unsigned channels = TextureChannels(data.format);
+    const bool isHalf = data.format >= comp::Texture::R16F;
+    for(unsigned level = 1; level < levels; level++)
+    {
+        const uint8_t *src = data.pixels.data() + data.LevelOffset(level - 1);
+        uint8_t *dst = data.pixels.data() + data.LevelOffset(level);
+        const unsigned srcWidth = data.LevelWidth(level - 1), srcHeight = data.LevelHeight(level - 1);
+        const unsigned dstWidth = data.LevelWidth(level), dstHeight = data.LevelHeight(level);
+        if(isHalf)
+        {
+            Downsample16F(src, srcWidth, srcHeight, channels, dst, dstWidth, dstHeight);
+        }
+        else
+        {
+            Downsample8(src, srcWidth, srcHeight, channels, dst, dstWidth, dstHeight);
+        }
+    }
+}
+
+/// Block-compresses all levels of a RGB8 (to BC1) or RGBA8 (to BC3) texture.
+/// Returns false, leaving it untouched, if it is in any other format.
+inline bool CompressTexture(comp::Texture::Data &data)
+{
+    if(data.format != comp::Texture::RGB8 && data.format != comp::Texture::RGBA8)
+    {
+        return false;
+    }
+    const unsigned channels = TextureChannels(data.format);
+
+    comp::Texture::Data compressed{};
+    compressed.format = (data.format == comp::Texture::RGB8) ? comp::Texture::BC1 : comp::Texture::BC3;
+    compressed.width = data.width;
+    compressed.height = data.height;
+    compressed.levels = data.levels;
+    compressed.pixels.resize(compressed.LevelOffset(compressed.levels));
+    for(unsigned level = 0; level < data.levels; level++)
+    {
+        bcn::CompressImage(data.pixels.data() + data.LevelOffset(level), data.LevelWidth(level),
+                           data.LevelHeight(level), channels, compressed.pixels.data() + compressed.LevelOffset(level));
+    }
+
+    data.format = compressed.format;
+    data.pixels = std::move(compressed.pixels);
+    return true;
+}
+
+/// Prepares freshly decoded texture data for the GPU: builds its mip chain if it is going to be sampled with mipmaps,
+/// then - if `compress` - block-compresses it if it is a static RGB(A)8 texture at least one block big.
+inline void PrepareTexture(comp::Texture::Data &data, bool compress, unsigned maxLevels = ~0u)
+{
+    if(data.minFilter == comp::Texture::Trilinear || data.minFilter == comp::Texture::Anisotropic)
+    {
+        GenerateMipmaps(data, maxLevels);
+    }
+    if(compress && data.usage == comp::Texture::Static && data.width >= bcn::BLOCK_SIZE
+       && data.height >= bcn::BLOCK_SIZE)
+    {
+        CompressTexture(data);
+    }
+}
+
+} // namespace kernels
+} // namespace boyd
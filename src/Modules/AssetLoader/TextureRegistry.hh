@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include "../../Components/Texture.hh"
+#include "../../Core/Platform.hh"
+
+namespace boyd
+{
+
+/// Global (singleton) registry of the textures loaded so far, so that all assets that load the same pixels share a
+/// single `comp::Texture` - and so a single GPU texture, which can stay bound across materials.
+/// Textures are identified by a hash of their whole data. They are only referenced weakly: the registry never keeps a
+/// texture alive, and forgets about the ones that were destroyed in `Prune()`.
+/// NOTE: Interned textures are shared, so treat them as immutable: `Edit()`ing one edits it for every asset!
+/// Thread-safe.
+class BOYD_API TextureRegistry
+{
+private:
+    TextureRegistry() = default;
+
+    TextureRegistry(const TextureRegistry &toCopy) = delete;
+    TextureRegistry &operator=(const TextureRegistry &toCopy) = delete;
+    TextureRegistry(TextureRegistry &&toMove) = delete;
+    TextureRegistry &operator=(TextureRegistry &&toMove) = delete;
+
+public:
+    ~TextureRegistry() = default;
+
+    static TextureRegistry &instance()
+    {
+        static TextureRegistry inst;
+        return inst;
+    }
+
+    /// Returns the registered texture with exactly the same data as `data`, or registers a new one made from it.
+    comp::Texture Intern(comp::Texture::Data &&data)
+    {
+        const uint64_t hash = Hash(data);
+        std::lock_guard<std::mutex> lock{mutex};
+
+        const auto range = textures.equal_range(hash);
+        for(auto it = range.first; it != range.second; ++it)
+        {
+            auto registered = it->second.Lock();
+            if(registered && SameData(*registered, data))
+            {
+                return comp::Texture{std::move(registered)};
+            }
+        }
+        comp::Texture texture{std::move(data)};
+        textures.emplace(hash, texture.data);
+        return texture;
+    }
+
+    /// Forgets all registered textures that were destroyed since. (The AssetLoader module calls this every frame)
+    void Prune()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        for(auto it = textures.begin(); it != textures.end();)
+        {
+            it = it->second.Expired() ? textures.erase(it) : std::next(it);
+        }
+    }
+
+    /// Forgets all registered textures. (Textures still referenced by assets stay valid, just not shared anymore)
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        textures.clear();
+    }
+
+private:
+    std::mutex mutex;
+    std::unordered_multimap<uint64_t, Versioned<comp::Texture::Data>::Weak> textures; ///< Data hash -> texture
+
+    static uint64_t Hash(const comp::Texture::Data &data)
+    {
+        const std::string_view pixels{reinterpret_cast<const char *>(data.pixels.data()), data.pixels.size()};
+        uint64_t hash = std::hash<std::string_view>{}(pixels);
+        for(uint64_t value : {uint64_t(data.format), uint64_t(data.width), uint64_t(data.height),
+                              uint64_t(data.minFilter), uint64_t(data.magFilter), uint64_t(data.usage),
+                              uint64_t(data.levels)})
+        {
+            hash ^= value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+        }
+        return hash;
+    }
+
+    static bool SameData(const comp::Texture::Data &a, const comp::Texture::Data &b)
+    {
+        return a.format == b.format && a.width == b.width && a.height == b.height && a.minFilter == b.minFilter
+               && a.magFilter == b.magFilter && a.usage == b.usage && a.levels == b.levels && a.pixels == b.pixels;
+    }
+};
+
+} // namespace boyd
@@ -7,13 +7,20 @@
 #include "../../Core/Platform.hh"
 #include "../../Debug/Log.hh"
 
-#include "Utils.hh"
+#include "Backend.hh"
+#include "Mixer.hh"
+#include "OpenALBackend.hh"
+#include "Sink.hh"
 
 #include <AL/al.h>
-#include <AL/alc.h>
+#include <BoydEngine.hh>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <glm/glm.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
@@ -23,59 +30,78 @@ using namespace boyd;
 /// TODO: add state transfer
 struct BoydAudioState
 {
-    ALCcontext *context;
-    ALCdevice *device;
-
     entt::observer entt_clipAndSource;
+    entt::observer entt_movedSources; ///< Sources whose Transform was replaced since the last update
+
+    std::unique_ptr<audio::Backend> backend; ///< Plays the clips that are given a voice
 
-    bool isEnabled{true};
+    glm::mat4 listenerMatrix = glm::identity<glm::mat4>(); ///< Of the active camera (identity = default listener)
+    glm::vec3 listenerPosition{0.0f};                      ///< (Its translation)
+    std::chrono::steady_clock::time_point lastFrame;
+
+    /// A clip that is playing (or virtually playing), ranked by how much it deserves a voice.
+    struct Candidate
+    {
+        entt::entity entity;
+        boyd::comp::AudioSource *source;
+        boyd::comp::AudioInternals *internals;
+    };
+    std::vector<Candidate> candidates; ///< (Kept between frames so that it does not reallocate)
+
+    /// SFX entities that are done playing. Entities are only destroyed once all modules are done with this frame (see
+    /// `Defer()`), so that the Audio module can be updated concurrently with the others.
+    std::vector<entt::entity> finished;
 
     BoydAudioState()
     {
-        if(!(device = alcOpenDevice(nullptr)))
+        const std::string_view backendName = BOYD_AUDIO_BACKEND;
+        if(backendName == "OpenAL")
         {
-            BOYD_LOG(Error, "Could not access the device");
-            BOYD_OPENALC_ERROR(device);
-            BOYD_LOG(Error, "Audio will be disabled");
-            isEnabled = false;
+            backend = audio::OpenALBackend::Create();
         }
-        else if(!(context = alcCreateContext(device, nullptr)) || alcMakeContextCurrent(context) == ALC_FALSE)
+        else if(backendName == "Mixer")
         {
-            BOYD_LOG(Error, "Could not create an OpenAL context. Audio will be muted.");
-            BOYD_OPENALC_ERROR(device);
-            BOYD_LOG(Error, "Audio will be disabled");
-            isEnabled = false;
+            if(auto sink = audio::OpenALSink::Create(BOYD_AUDIO_MIXER_RATE))
+            {
+                backend = std::make_unique<audio::Mixer>(BOYD_AUDIO_VOICES, std::move(sink));
+            }
         }
-        else
+        else if(backendName == "Wav")
         {
-            // Load all available extensions, similarly to GLEW for OpenGL.
-            const char *name = nullptr;
-            if(alcIsExtensionPresent(device, "ALC_ENUMERATE_ALL_EXT"))
-                name = alcGetString(device, ALC_ALL_DEVICES_SPECIFIER);
-            if(!name || alcGetError(device) != AL_NO_ERROR)
-                name = alcGetString(device, ALC_DEVICE_SPECIFIER);
-
-            BOYD_LOG(Debug, "OpenAL extension detected: {}", name);
-
-            auto &registry = Boyd_GameState()->ecs;
-
-            entt_clipAndSource.connect(registry, entt::collector.group<boyd::comp::AudioClip,
-                                                                       boyd::comp::AudioSource>());
+            if(auto sink = audio::WavSink::Create(BOYD_AUDIO_WAV_FILE, BOYD_AUDIO_MIXER_RATE))
+            {
+                backend = std::make_unique<audio::Mixer>(BOYD_AUDIO_VOICES, std::move(sink));
+            }
         }
-    }
-    ~BoydAudioState()
-    {
-        BOYD_LOG(Debug, "Destroying OpenAL context");
-        alcMakeContextCurrent(nullptr);
-        if(context)
+        else if(backendName != "Null")
         {
-            alcDestroyContext(context);
+            BOYD_LOG(Error, "Unknown audio backend: {}", backendName);
         }
-        BOYD_LOG(Debug, "Closing OpenAL device");
-        if(device)
+
+        if(!backend)
         {
-            alcCloseDevice(device);
+            // No audio device (e.g. a dedicated server or a CI runner): still play all clips - so that they end when
+            // they should -, without outputting them anywhere
+            BOYD_LOG(Info, "Audio will be mixed, but not output");
+            backend = std::make_unique<audio::Mixer>(BOYD_AUDIO_VOICES,
+                                                     std::make_unique<audio::NullSink>(BOYD_AUDIO_MIXER_RATE));
         }
+
+        auto &registry = Boyd_GameState()->ecs;
+        // (Not a component the other modules use, so its pool is created here - see `ModuleScheduler`)
+        registry.reserve<boyd::comp::AudioInternals>(0);
+        entt_clipAndSource.connect(registry, entt::collector.group<boyd::comp::AudioClip,
+                                                                   boyd::comp::AudioSource>());
+        entt_movedSources.connect(registry, entt::collector.replace<boyd::comp::Transform>()
+                                                .where<boyd::comp::AudioInternals>());
+        lastFrame = std::chrono::steady_clock::now();
+    }
+    ~BoydAudioState()
+    {
+        // Give all voices back while the backend is still there
+        auto &registry = Boyd_GameState()->ecs;
+        registry.view<boyd::comp::AudioInternals>().each([](auto, auto &internals) { internals.Virtualize(); });
+        backend.reset();
     }
 };
 
@@ -84,115 +110,218 @@ inline BoydAudioState *GetState(void *state)
     return reinterpret_cast<BoydAudioState *>(state);
 }
 
-extern "C" {
-BOYD_API void *BoydInit_Audio()
+/// Clips quieter than this (-60dB) are never given a voice.
+static constexpr float INAUDIBLE_GAIN = 0.001f;
+
+/// How much more audible a virtual clip has to be to steal a voice from a clip that is as important as itself (so
+/// that voices do not keep flipping between clips that are about as loud).
+static constexpr float STEAL_THRESHOLD = 1.25f;
+
+/// Follows the active camera (if any) with the listener. Returns true if it moved.
+static bool PlaceListener(BoydAudioState &state, entt::registry &registry)
 {
-    BOYD_LOG(Info, "Starting Audio module");
-    return new BoydAudioState();
+    auto cameraView = registry.view<boyd::comp::Camera, boyd::comp::ActiveCamera>();
+    const auto *transform = cameraView.empty() ? nullptr : registry.try_get<boyd::comp::Transform>(*cameraView.begin());
+    const glm::mat4 matrix = transform ? transform->matrix : glm::identity<glm::mat4>();
+    if(matrix == state.listenerMatrix)
+    {
+        return false;
+    }
+    state.listenerMatrix = matrix;
+    state.listenerPosition = glm::vec3(matrix[3]);
+    return true;
 }
 
-BOYD_API void BoydUpdate_Audio(void *state)
+/// Gives a voice to a virtual clip, resuming it from its playback time.
+static void Realize(BoydAudioState &state, entt::registry &registry, entt::entity entity,
+                    const boyd::comp::AudioSource &source, boyd::comp::AudioInternals &internals)
 {
-    auto *audioState = GetState(state);
-    entt::registry &registry = Boyd_GameState()->ecs;
+    using boyd::comp::AudioSource;
 
-    alcMakeContextCurrent(audioState->context);
-    BOYD_OPENALC_ERROR(audioState->device);
+    if(!state.backend->HasFreeVoice())
+    {
+        return; // (Not the clip's fault: it stays virtual, and gets another try in the next updates)
+    }
 
-    auto entt_clipAndSourceView = registry.view<boyd::comp::AudioClip, boyd::comp::AudioSource>();
-    auto entt_transform = registry.view<boyd::comp::AudioSource, boyd::comp::AudioInternals, boyd::comp::Transform>();
+    const auto *transform = registry.try_get<boyd::comp::Transform>(entity);
+    const bool isBGM = source.soundType == AudioSource::SoundType::BGM;
+    const audio::Backend::Clip clip{
+        registry.get<boyd::comp::AudioClip>(entity).wave,
+        internals.format,
+        internals.time,
+        source.soundType != AudioSource::SoundType::SFX, // (Loop?)
+        isBGM,                           // (Stream? Music is long, so stream it instead of decoding all of it at once)
+        !isBGM && transform != nullptr,  // (Positional? Music is heard the same from anywhere)
+        transform ? glm::vec3(transform->matrix[3]) : glm::vec3(0.0f),
+    };
 
-    if(!audioState->isEnabled)
+    if(!(internals.voice = state.backend->Play(clip))) // (There was a free voice, so the clip itself is at fault)
     {
-        // Delete all the audiosources. Keep the ECS clean
-        auto view = registry.view<boyd::comp::AudioSource>();
-        registry.destroy(view.begin(), view.end());
+        BOYD_LOG(Warn, "Could not decode an audio clip");
+        internals.format = AL_NONE; // (Don't try again)
     }
-    else
+}
+
+/// Takes the voice of a clip away, keeping track of its playback time.
+static void Virtualize(BoydAudioState &state, boyd::comp::AudioInternals &internals)
+{
+    const float time = state.backend->Tell(internals.voice.get());
+    if(time >= 0.0f)
     {
-        // Register new pairs <AudioSource, AudioClip> if any
-        for(const auto entity : audioState->entt_clipAndSource)
-        {
-            auto tuple = entt_clipAndSourceView.get<boyd::comp::AudioClip, boyd::comp::AudioSource>(entity);
-            boyd::comp::AudioClip &clip = std::get<0>(tuple);
-            boyd::comp::AudioSource &source = std::get<1>(tuple);
-            boyd::comp::AudioInternals &internals = registry.get_or_assign<boyd::comp::AudioInternals>(entity, clip);
+        internals.time = time;
+    }
+    internals.Virtualize();
+}
 
-            if(!internals.isSet)
-            {
-                alGenBuffers(1, &internals.dataBuffer);
-                BOYD_OPENAL_ERROR();
-                alBufferData(internals.dataBuffer, internals.format,
-                             clip.wave.data.get(), clip.wave.sampleCount * clip.wave.channels * clip.wave.sampleSize / 8,
-                             clip.wave.sampleRate);
-                BOYD_OPENAL_ERROR();
-                alGenSources(1, &internals.source);
-                BOYD_OPENAL_ERROR();
-                alSourcei(internals.source, AL_BUFFER, internals.dataBuffer);
-                BOYD_OPENAL_ERROR();
-
-                switch(source.soundType)
-                {
-                case boyd::comp::AudioSource::SoundType::SFX_LOOPABLE:
-                case boyd::comp::AudioSource::SoundType::BGM:
-                    alSourcei(internals.source, AL_LOOPING, AL_TRUE);
-                    break;
-                case boyd::comp::AudioSource::SoundType::SFX:
-                    alSourcei(internals.source, AL_LOOPING, AL_FALSE);
-                }
-                BOYD_OPENAL_ERROR();
-                alSourcePlay(internals.source);
-                BOYD_OPENAL_ERROR();
+/// Advances all clips (virtual ones included), finds the SFX that are done playing, then hands the voices out to
+/// the clips that deserve them the most: BGM first, then by priority, then by audibility - stealing voices from clips
+/// that deserve them less, which turn virtual.
+static void UpdateVoices(BoydAudioState &state, entt::registry &registry, float timeDelta)
+{
+    using boyd::comp::AudioSource;
 
-                internals.isSet = true;
+    auto &candidates = state.candidates;
+    candidates.clear();
+    auto &finished = state.finished;
+
+    registry.view<AudioSource, boyd::comp::AudioInternals>().each([&](entt::entity entity, auto &source,
+                                                                       auto &internals) {
+        const bool isLooping = source.soundType != AudioSource::SoundType::SFX;
+        if(internals.format == AL_NONE)
+        {
+            if(!isLooping)
+            {
+                finished.push_back(entity); // (Can't be played)
             }
+            return;
         }
 
-        boyd::comp::Camera *camera = nullptr;
-        registry.view<boyd::comp::Camera>().each([&camera](entt::entity entity, auto &cameraComp) { camera = &cameraComp; });
-
-        /// TODO: Replace camera.position with the corresponding transform
-        if(camera)
+        internals.time += timeDelta;
+        const bool isDone = internals.IsReal() ? state.backend->IsDone(internals.voice.get())
+                                               : internals.time >= internals.duration;
+        if(isDone && !isLooping)
         {
-            // FIXME - get camera position and orientation from its transform!
-            //
-            //alListenerfv(AL_POSITION, (const ALfloat *)&(camera->camera.position));
-            //BOYD_OPENAL_ERROR();
-            //
-            //Vector3 orientation[] = {camera->camera.target, camera->camera.up};
-            //alListenerfv(AL_ORIENTATION, (const ALfloat *)orientation);
-            //BOYD_OPENAL_ERROR();
+            internals.Virtualize(); // (Frees its voice for the others right away)
+            finished.push_back(entity);
+            return;
+        }
+        if(isLooping && internals.duration > 0.0f)
+        {
+            internals.time = std::fmod(internals.time, internals.duration);
         }
 
-        std::vector<entt::entity> flushPool;
-
-        entt_transform.each([&flushPool](entt::entity entity, auto &source, auto &internals, auto &transform) {
-            /// If the audio element is a SFX and the reproduction stream has run out, delete it.
-            ALenum state;
+        internals.audibility = 1.0f;
+        const auto *transform = registry.try_get<boyd::comp::Transform>(entity);
+        if(transform && source.soundType != AudioSource::SoundType::BGM)
+        {
+            const float distance = glm::length(glm::vec3(transform->matrix[3]) - state.listenerPosition);
+            internals.audibility = audio::Backend::REFERENCE_DISTANCE /
+                                   std::max(distance, audio::Backend::REFERENCE_DISTANCE);
+        }
+        candidates.push_back(BoydAudioState::Candidate{entity, &source, &internals});
+    });
 
-            alGetSourcei(internals.source, AL_SOURCE_STATE, &state);
+    auto rank = [](const BoydAudioState::Candidate &candidate) {
+        const float bonus = candidate.internals->IsReal() ? STEAL_THRESHOLD : 1.0f;
+        return std::make_tuple(candidate.source->soundType == AudioSource::SoundType::BGM, candidate.source->priority,
+                               candidate.internals->audibility * bonus);
+    };
+    std::sort(candidates.begin(), candidates.end(), [&rank](const auto &a, const auto &b) {
+        return rank(a) > rank(b);
+    });
 
-            if(source.soundType == boyd::comp::AudioSource::SoundType::SFX && state == AL_STOPPED)
+    // The first audible candidates get the voices; take them away from all others first, so that there are enough
+    size_t nReal = 0;
+    for(const auto &candidate : candidates)
+    {
+        if(nReal < state.backend->VoiceCount() && candidate.internals->audibility >= INAUDIBLE_GAIN)
+        {
+            nReal++;
+        }
+        else if(candidate.internals->IsReal())
+        {
+            Virtualize(state, *candidate.internals);
+        }
+    }
+    for(const auto &candidate : candidates)
+    {
+        if(nReal == 0)
+        {
+            break;
+        }
+        if(candidate.internals->audibility >= INAUDIBLE_GAIN)
+        {
+            nReal--;
+            if(!candidate.internals->IsReal())
             {
-                flushPool.push_back(entity);
+                Realize(state, registry, candidate.entity, *candidate.source, *candidate.internals);
             }
-            else if(source.soundType != boyd::comp::AudioSource::SoundType::BGM)
+        }
+    }
+}
+
+extern "C" {
+BOYD_API void *BoydInit_Audio()
+{
+    BOYD_LOG(Info, "Starting Audio module");
+    return new BoydAudioState();
+}
+
+BOYD_API void BoydUpdate_Audio(void *state)
+{
+    auto *audioState = GetState(state);
+    entt::registry &registry = Boyd_GameState()->ecs;
+    audio::Backend &backend = *audioState->backend;
+
+    auto entt_clipAndSourceView = registry.view<boyd::comp::AudioClip, boyd::comp::AudioSource>();
+
+    const auto now = std::chrono::steady_clock::now();
+    const float timeDelta = std::chrono::duration<float>{now - audioState->lastFrame}.count();
+    audioState->lastFrame = now;
+
+    backend.BeginFrame();
+
+    // Register new pairs <AudioSource, AudioClip> if any; they get a voice below (if they deserve one)
+    for(const auto entity : audioState->entt_clipAndSource)
+    {
+        auto &clip = entt_clipAndSourceView.get<boyd::comp::AudioClip>(entity);
+        registry.get_or_assign<boyd::comp::AudioInternals>(entity, clip);
+    }
+    audioState->entt_clipAndSource.clear();
+
+    const bool listenerMoved = PlaceListener(*audioState, registry);
+    UpdateVoices(*audioState, registry, timeDelta);
+
+    // Only move what moved (the backend applies all changes at once, in `EndFrame()`)
+    if(listenerMoved)
+    {
+        backend.PlaceListener(audioState->listenerMatrix);
+    }
+    for(const auto entity : audioState->entt_movedSources)
+    {
+        const auto *internals = registry.try_get<boyd::comp::AudioInternals>(entity);
+        const auto *transform = registry.try_get<boyd::comp::Transform>(entity);
+        if(internals && transform && internals->IsReal())
+        {
+            backend.Move(internals->voice.get(), glm::vec3(transform->matrix[3]));
+        }
+    }
+    audioState->entt_movedSources.clear();
+
+    backend.EndFrame(timeDelta);
+
+    if(!audioState->finished.empty())
+    {
+        Boyd_GameState()->Defer([audioState](entt::registry &registry) {
+            for(auto entity : audioState->finished)
             {
-                /// ENRICO: strangely my compiler (GCC 9.2.0) decided to crash if I tried to create
-                /// the arrays on the fly. I did not submit a report though 'cause I am a bad kid.
-                glm::vec3 translation = glm::vec3(transform.matrix[3]);
-                ALfloat zeroArray[3] = {0.0f, 0.0f, 0.0f};
-
-                // Position is given only by the translation right now
-                alSourcefv(internals.source, AL_POSITION, (const ALfloat *)&translation);
-                BOYD_OPENAL_ERROR();
-                alSourcefv(internals.source, AL_DIRECTION, zeroArray);
-                BOYD_OPENAL_ERROR();
+                if(registry.valid(entity)) // (Could have been destroyed since)
+                {
+                    registry.destroy(entity);
+                }
             }
+            audioState->finished.clear();
         });
-
-        for(auto entity : flushPool)
-            registry.destroy(entity);
     }
 }
 
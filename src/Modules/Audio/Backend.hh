@@ -0,0 +1,71 @@
+#pragma once
+
+#include "../../Components/AudioClip.hh"
+
+#include <AL/al.h>
+#include <glm/glm.hpp>
+#include <memory>
+
+namespace boyd
+{
+namespace audio
+{
+
+/// Where the Audio module plays clips: it hands voices out to the clips that deserve them, and tells the backend what
+/// to play on them - the backend does the playing (see "OpenALBackend.hh" and "Mixer.hh").
+/// NOTE: Only used from the Audio module's update.
+class Backend
+{
+public:
+    /// What to play on a voice.
+    struct Clip
+    {
+        const Wave &wave;
+        ALenum format;      ///< (As in `AudioInternals`)
+        float time;         ///< Where to start playing from, in seconds
+        bool loop;          ///< Loop the clip, or stop at its end?
+        bool stream;        ///< Stream the clip (for long clips that are only played once at a time, like music)?
+        bool positional;    ///< Heard from `position`, or heard the same from everywhere?
+        glm::vec3 position; ///< (World-space)
+    };
+
+    /// All backends attenuate positional voices like OpenAL's default distance model: the gain is
+    /// `REFERENCE_DISTANCE / distance` from the listener (but never more than 1).
+    static constexpr float REFERENCE_DISTANCE = 1.0f;
+
+    virtual ~Backend() = default;
+
+    /// Returns the number of clips that can be played at once.
+    virtual unsigned VoiceCount() const = 0;
+
+    /// Returns true if there is a free voice for `Play()` to play a clip on.
+    virtual bool HasFreeVoice() const = 0;
+
+    /// Starts playing `clip` on a free voice. Returns the voice - releasing it stops it -, or null if the clip can't
+    /// be decoded (or if there is no free voice, see `HasFreeVoice()`).
+    virtual std::shared_ptr<void> Play(const Clip &clip) = 0;
+
+    /// Returns true if the (non-looping) clip on `voice` played until its end.
+    virtual bool IsDone(void *voice) = 0;
+
+    /// Returns the playback time of the clip on `voice`, in seconds - or a negative value if the backend can't tell.
+    virtual float Tell(void *voice) = 0;
+
+    /// Called at the start of every update, before any other method.
+    virtual void BeginFrame()
+    {
+    }
+
+    /// Moves the listener to the given (camera) transform; the listener looks down its -Z.
+    virtual void PlaceListener(const glm::mat4 &matrix) = 0;
+
+    /// Moves a positional voice (non-positional ones stay where they are).
+    virtual void Move(void *voice, const glm::vec3 &position) = 0;
+
+    /// Called at the end of every update: applies the changes made since `BeginFrame()` - and, if the backend mixes
+    /// in software, outputs the `timeDelta` seconds of audio that passed.
+    virtual void EndFrame(float timeDelta) = 0;
+};
+
+} // namespace audio
+} // namespace boyd
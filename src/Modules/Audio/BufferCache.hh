@@ -0,0 +1,131 @@
+#pragma once
+
+#include "../../Components/AudioClip.hh"
+#include "../../Core/Flac.hh"
+
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace boyd
+{
+namespace audio
+{
+
+/// Keeps one buffer per clip - e.g. an OpenAL buffer -, shared by all voices that play it - so that playing a clip
+/// again (or many times at once) does not upload it again. Compressed clips are decoded once, when first played.
+/// Buffers of clips that are gone are dropped; the least recently used ones are dropped too once over budget (but
+/// only when no voice is playing them).
+/// NOTE: Not thread-safe - only use it from the Audio module's update.
+template <typename TBuffer>
+class BufferCache
+{
+public:
+    using Buffer = std::shared_ptr<const TBuffer>;
+
+    explicit BufferCache(size_t budgetBytes)
+        : budget{budgetBytes}
+    {
+    }
+
+    BufferCache(const BufferCache &toCopy) = delete;
+    BufferCache &operator=(const BufferCache &toCopy) = delete;
+    BufferCache(BufferCache &&toMove) = delete;
+    BufferCache &operator=(BufferCache &&toMove) = delete;
+
+    /// Returns the buffer holding all samples of `wave`, decoding them and calling `upload(samples, size)` - which
+    /// returns a `Buffer` with a copy of the PCM samples - if not cached. Returns null if it fails to decode or upload.
+    template <typename TUpload>
+    Buffer Get(const Wave &wave, TUpload &&upload)
+    {
+        const uint8_t *key = wave.data.get();
+        auto found = entries.find(key);
+        if(found != entries.end())
+        {
+            if(!found->second->clip.expired())
+            {
+                lru.splice(lru.begin(), lru, found->second);
+                return found->second->buffer;
+            }
+            Evict(found->second); // (The clip was unloaded, and this is a different one at the same address)
+        }
+
+        const uint8_t *samples = wave.data.get();
+        size_t size = wave.PcmSize();
+        std::vector<int16_t> decoded;
+        if(wave.codec == Wave::FLAC)
+        {
+            flac::Decoder decoder;
+            if(!decoder.Open(wave.data.get(), wave.dataSize))
+            {
+                return nullptr;
+            }
+            decoded.resize(size_t(wave.sampleCount) * wave.channels);
+            decoded.resize(decoder.Read(decoded.data(), wave.sampleCount) * wave.channels);
+            samples = reinterpret_cast<const uint8_t *>(decoded.data());
+            size = decoded.size() * sizeof(int16_t);
+        }
+
+        Buffer buffer = upload(samples, size);
+        if(!buffer)
+        {
+            return nullptr;
+        }
+
+        lru.push_front(Entry{key, wave.data, buffer, size});
+        entries[key] = lru.begin();
+        total += size;
+        Trim();
+        return buffer;
+    }
+
+    /// Drops the buffers of clips that are gone, then the least recently used ones until within budget.
+    /// Buffers that are still playing are only deleted once the last voice playing them releases them.
+    void Trim()
+    {
+        for(auto entry = lru.begin(); entry != lru.end();)
+        {
+            entry = entry->clip.expired() ? Evict(entry) : std::next(entry);
+        }
+        for(auto entry = lru.end(); entry != lru.begin() && total > budget;)
+        {
+            if((--entry)->buffer.use_count() == 1) // (Only referenced by the cache = not playing)
+            {
+                entry = Evict(entry);
+            }
+        }
+    }
+
+    /// Returns the size in bytes of the samples in all cached buffers.
+    inline size_t Size() const
+    {
+        return total;
+    }
+
+private:
+    struct Entry
+    {
+        const uint8_t *key;
+        std::weak_ptr<uint8_t> clip; ///< (Does not keep the clip alive)
+        Buffer buffer;
+        size_t size;
+    };
+
+    /// Drops an entry; returns the one after it.
+    typename std::list<Entry>::iterator Evict(typename std::list<Entry>::iterator entry)
+    {
+        total -= entry->size;
+        entries.erase(entry->key);
+        return lru.erase(entry);
+    }
+
+    size_t budget, total{0};
+    std::list<Entry> lru; ///< Most recently used first
+    std::unordered_map<const uint8_t *, typename std::list<Entry>::iterator> entries;
+};
+
+} // namespace audio
+} // namespace boyd
@@ -0,0 +1,479 @@
+#include "Mixer.hh"
+#include "../../Core/Flac.hh"
+#include "../../Debug/Log.hh"
+
+#include <BoydEngine.hh>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// (Emscripten compiles the SSE2 path too, to WebAssembly SIMD, if built with `-msimd128 -msse2`)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define BOYD_MIXER_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#    include <arm_neon.h>
+#    define BOYD_MIXER_NEON
+#endif
+
+namespace boyd
+{
+namespace audio
+{
+
+/// (16-bit sample -> float in [-1, 1])
+static constexpr float SAMPLE_SCALE = 1.0f / 32768.0f;
+
+struct Mixer::Voice
+{
+    bool active{false}; ///< Handed out?
+    bool done{false};   ///< Played until its end?
+    bool loop{false};
+    bool positional{false};
+    glm::vec3 position{0.0f}; ///< (World-space)
+    float gains[2]{};         ///< Gains of the block mixed last (the next one is ramped from them)
+
+    unsigned channels{1};
+    unsigned sampleRate{1};
+    double step{1.0}; ///< Clip frames played per output frame
+    double time{0.0}; ///< The next clip frame to play - fractional, as it is resampled
+
+    // -- Played from memory
+    std::shared_ptr<const int16_t> samples; ///< All of the clip's frames; null if streamed
+    size_t nFrames{0};
+
+    // -- Streamed (`time` then counts frames since the start of the stream, looping included)
+    Wave wave; ///< (Also keeps the samples alive)
+    flac::Decoder decoder;
+    std::vector<int16_t> chunk; ///< Frames [chunkStart, chunkStart + chunk.size() / channels) of the stream
+    size_t chunkStart{0};
+    bool ended{false}; ///< Nothing left to decode?
+};
+
+struct Mixer::Voices
+{
+    std::vector<Voice> all; ///< (Never resized: handles point to them)
+    std::vector<unsigned> free;
+};
+
+/// Converts `n` mono 16-bit samples from `from` to floats in `left`.
+static void ConvertMono(const int16_t *from, float *left, size_t n)
+{
+    size_t i = 0;
+#if defined(BOYD_MIXER_SSE2)
+    const __m128 scale = _mm_set1_ps(SAMPLE_SCALE);
+    for(; i + 8 <= n; i += 8)
+    {
+        // (Sign-extend by putting each sample in the high half of a 32-bit lane, then shifting it down)
+        const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + i));
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+        _mm_storeu_ps(left + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(left + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#elif defined(BOYD_MIXER_NEON)
+    for(; i + 8 <= n; i += 8)
+    {
+        const int16x8_t samples = vld1q_s16(from + i);
+        vst1q_f32(left + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples))), SAMPLE_SCALE));
+        vst1q_f32(left + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples))), SAMPLE_SCALE));
+    }
+#endif
+    for(; i < n; i++)
+    {
+        left[i] = float(from[i]) * SAMPLE_SCALE;
+    }
+}
+
+/// Converts `n` interleaved stereo 16-bit sample frames from `from` to floats in `left` and `right`.
+static void ConvertStereo(const int16_t *from, float *left, float *right, size_t n)
+{
+    size_t i = 0;
+#if defined(BOYD_MIXER_SSE2)
+    const __m128 scale = _mm_set1_ps(SAMPLE_SCALE);
+    for(; i + 4 <= n; i += 4)
+    {
+        const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + i * 2));
+        const __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16)); // L0 R0 L1 R1
+        const __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16)); // L2 R2 L3 R3
+        _mm_storeu_ps(left + i, _mm_mul_ps(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)), scale));
+        _mm_storeu_ps(right + i, _mm_mul_ps(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)), scale));
+    }
+#elif defined(BOYD_MIXER_NEON)
+    for(; i + 4 <= n; i += 4)
+    {
+        const int16x4x2_t samples = vld2_s16(from + i * 2); // (Deinterleaved as it is loaded)
+        vst1q_f32(left + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(samples.val[0])), SAMPLE_SCALE));
+        vst1q_f32(right + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(samples.val[1])), SAMPLE_SCALE));
+    }
+#endif
+    for(; i < n; i++)
+    {
+        left[i] = float(from[i * 2]) * SAMPLE_SCALE;
+        right[i] = float(from[i * 2 + 1]) * SAMPLE_SCALE;
+    }
+}
+
+/// Adds `n` samples of `from` to `to`, scaled by a gain ramping from `gain` by `step` per sample.
+static void Accumulate(const float *from, float *to, size_t n, float gain, float step)
+{
+    size_t i = 0;
+#if defined(BOYD_MIXER_SSE2)
+    const __m128 gain4 = _mm_set1_ps(gain), step4 = _mm_set1_ps(step), lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    for(; i + 4 <= n; i += 4)
+    {
+        // (Same gains as the scalar loop below computes: `float(i) + lane` is exact)
+        const __m128 gains = _mm_add_ps(gain4, _mm_mul_ps(step4, _mm_add_ps(_mm_set1_ps(float(i)), lanes)));
+        _mm_storeu_ps(to + i, _mm_add_ps(_mm_loadu_ps(to + i), _mm_mul_ps(_mm_loadu_ps(from + i), gains)));
+    }
+#elif defined(BOYD_MIXER_NEON)
+    static const float LANES[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    const float32x4_t gain4 = vdupq_n_f32(gain), step4 = vdupq_n_f32(step), lanes = vld1q_f32(LANES);
+    for(; i + 4 <= n; i += 4)
+    {
+        const float32x4_t gains = vaddq_f32(gain4, vmulq_f32(step4, vaddq_f32(vdupq_n_f32(float(i)), lanes)));
+        vst1q_f32(to + i, vaddq_f32(vld1q_f32(to + i), vmulq_f32(vld1q_f32(from + i), gains)));
+    }
+#endif
+    for(; i < n; i++)
+    {
+        to[i] += from[i] * (gain + step * float(i));
+    }
+}
+
+/// Interleaves `n` samples of `left` and `right` into `to`.
+static void Interleave(const float *left, const float *right, float *to, size_t n)
+{
+    size_t i = 0;
+#if defined(BOYD_MIXER_SSE2)
+    for(; i + 4 <= n; i += 4)
+    {
+        const __m128 l = _mm_loadu_ps(left + i), r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(to + i * 2, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(to + i * 2 + 4, _mm_unpackhi_ps(l, r));
+    }
+#elif defined(BOYD_MIXER_NEON)
+    for(; i + 4 <= n; i += 4)
+    {
+        vst2q_f32(to + i * 2, float32x4x2_t{{vld1q_f32(left + i), vld1q_f32(right + i)}});
+    }
+#endif
+    for(; i < n; i++)
+    {
+        to[i * 2] = left[i];
+        to[i * 2 + 1] = right[i];
+    }
+}
+
+/// Resamples - linearly - up to `n` frames of `samples` (`nFrames` frames of `channels` interleaved channels) to
+/// `left` and `right` (if stereo), from frame `time` onwards and `step` frames apart; wraps around if `loop`.
+/// Returns the number of frames written - less than `n` if the samples ended first.
+static size_t Resample(const int16_t *samples, size_t nFrames, unsigned channels, bool loop, double &time, double step,
+                       float *left, float *right, size_t n)
+{
+    size_t i = 0;
+    if(step == 1.0 && time == std::floor(time))
+    {
+        // Same rate, and on a frame: just convert runs of samples
+        while(i < n)
+        {
+            size_t first = size_t(time);
+            if(first >= nFrames)
+            {
+                if(!loop || nFrames == 0)
+                {
+                    break;
+                }
+                first %= nFrames;
+            }
+            const size_t run = std::min(n - i, nFrames - first);
+            const int16_t *from = samples + first * channels;
+            if(channels == 1)
+            {
+                ConvertMono(from, left + i, run);
+            }
+            else
+            {
+                ConvertStereo(from, left + i, right + i, run);
+            }
+            i += run;
+            time = double(first + run);
+        }
+        return i;
+    }
+
+    for(; i < n; i++, time += step)
+    {
+        if(time >= double(nFrames))
+        {
+            if(!loop || nFrames == 0)
+            {
+                break;
+            }
+            time = std::fmod(time, double(nFrames));
+        }
+        const auto i0 = size_t(time);
+        const size_t i1 = (i0 + 1 < nFrames) ? i0 + 1 : (loop ? 0 : i0);
+        const float frac = float(time - double(i0));
+        const int16_t *a = samples + i0 * channels, *b = samples + i1 * channels;
+        left[i] = (float(a[0]) + float(b[0] - a[0]) * frac) * SAMPLE_SCALE;
+        if(channels == 2)
+        {
+            right[i] = (float(a[1]) + float(b[1] - a[1]) * frac) * SAMPLE_SCALE;
+        }
+    }
+    return i;
+}
+
+Mixer::Mixer(unsigned nVoices, std::unique_ptr<Sink> sink)
+    : sink{std::move(sink)}, voices{std::make_shared<Voices>()},
+      buffers{size_t(BOYD_AUDIO_PCM_CACHE_MB) * 1024 * 1024}, left(BLOCK_FRAMES), right(BLOCK_FRAMES),
+      mixLeft(BLOCK_FRAMES), mixRight(BLOCK_FRAMES)
+{
+    voices->all.resize(nVoices);
+    for(unsigned i = nVoices; i > 0; i--)
+    {
+        voices->free.push_back(i - 1);
+    }
+}
+
+unsigned Mixer::VoiceCount() const
+{
+    return unsigned(voices->all.size());
+}
+
+bool Mixer::HasFreeVoice() const
+{
+    return !voices->free.empty();
+}
+
+std::shared_ptr<void> Mixer::Play(const Clip &clip)
+{
+    const Wave &wave = clip.wave;
+    if(voices->free.empty() || (wave.channels != 1 && wave.channels != 2) || wave.sampleRate == 0)
+    {
+        return nullptr;
+    }
+    const unsigned index = voices->free.back();
+    Voice &voice = voices->all[index];
+    voice.loop = clip.loop;
+    voice.channels = wave.channels;
+    voice.sampleRate = wave.sampleRate;
+    voice.step = double(wave.sampleRate) / sink->SampleRate();
+    voice.time = std::floor(double(clip.time) * wave.sampleRate);
+
+    if(clip.stream && wave.codec == Wave::FLAC)
+    {
+        // Compressed music: decode it a chunk at a time, while it is played, instead of all of it at once
+        voice.wave = wave;
+        voice.ended = false;
+        voice.chunk.clear();
+        if(!voice.decoder.Open(wave.data.get(), wave.dataSize))
+        {
+            BOYD_LOG(Warn, "Can't stream a corrupt FLAC clip");
+            voice.wave = Wave{};
+            return nullptr;
+        }
+        voice.time = (wave.sampleCount > 0) ? std::fmod(voice.time, double(wave.sampleCount)) : 0.0;
+        for(size_t toSkip = size_t(voice.time); toSkip > 0 && !voice.ended; voice.chunk.clear())
+        {
+            Decode(voice, std::min(toSkip, size_t(BLOCK_FRAMES) * 16));
+            toSkip -= std::min(toSkip, voice.chunk.size() / voice.channels);
+        }
+        voice.chunkStart = size_t(voice.time);
+    }
+    else if(wave.codec == Wave::PCM && wave.sampleSize == 16)
+    {
+        // Already what is mixed: play it right from the clip
+        voice.samples = std::shared_ptr<const int16_t>(wave.data, reinterpret_cast<const int16_t *>(wave.data.get()));
+        voice.nFrames = wave.sampleCount;
+    }
+    else
+    {
+        auto buffer = buffers.Get(wave, [&wave](const uint8_t *samples, size_t size) {
+            auto converted = std::make_shared<std::vector<int16_t>>();
+            if(wave.codec == Wave::FLAC || wave.sampleSize == 16)
+            {
+                converted->resize(size / sizeof(int16_t));
+                std::memcpy(converted->data(), samples, converted->size() * sizeof(int16_t));
+            }
+            else if(wave.sampleSize == 8)
+            {
+                converted->resize(size);
+                for(size_t i = 0; i < size; i++)
+                {
+                    (*converted)[i] = int16_t((int(samples[i]) - 128) * 256); // (8-bit samples are unsigned)
+                }
+            }
+            else
+            {
+                return std::shared_ptr<const std::vector<int16_t>>{};
+            }
+            return std::shared_ptr<const std::vector<int16_t>>{std::move(converted)};
+        });
+        if(!buffer)
+        {
+            return nullptr;
+        }
+        voice.samples = std::shared_ptr<const int16_t>(buffer, buffer->data());
+        voice.nFrames = buffer->size() / wave.channels;
+    }
+    if(voice.samples && clip.loop && voice.nFrames > 0)
+    {
+        voice.time = std::fmod(voice.time, double(voice.nFrames));
+    }
+
+    voice.active = true;
+    voice.done = false;
+    voice.positional = clip.positional;
+    voice.position = clip.position;
+    voice.gains[0] = voice.gains[1] = 0.0f; // (Fades in over the first block, so that it does not click)
+    voices->free.pop_back();
+
+    std::weak_ptr<Voices> pool = voices;
+    return std::shared_ptr<void>(&voice, [pool, index](void *) {
+        if(auto alive = pool.lock()) // (Else the voice is gone together with the mixer already)
+        {
+            Voice &voice = alive->all[index];
+            voice.active = false;
+            voice.samples.reset();
+            voice.nFrames = 0;
+            voice.wave = Wave{};
+            voice.chunk.clear();
+            alive->free.push_back(index);
+        }
+    });
+}
+
+bool Mixer::IsDone(void *voice)
+{
+    return static_cast<Voice *>(voice)->done;
+}
+
+float Mixer::Tell(void *voice)
+{
+    const auto *mixerVoice = static_cast<Voice *>(voice);
+    const double nFrames = mixerVoice->samples ? double(mixerVoice->nFrames) : double(mixerVoice->wave.sampleCount);
+    const double time = (mixerVoice->loop && nFrames > 0.0) ? std::fmod(mixerVoice->time, nFrames) : mixerVoice->time;
+    return float(time / mixerVoice->sampleRate);
+}
+
+void Mixer::PlaceListener(const glm::mat4 &matrix)
+{
+    listenerView = glm::inverse(matrix);
+}
+
+void Mixer::Move(void *voice, const glm::vec3 &position)
+{
+    static_cast<Voice *>(voice)->position = position;
+}
+
+void Mixer::EndFrame(float timeDelta)
+{
+    const size_t nFrames = sink->Wanted(timeDelta);
+    output.resize(nFrames * 2);
+    Mix(output.data(), nFrames);
+    sink->Write(output.data(), nFrames);
+    buffers.Trim();
+}
+
+void Mixer::Mix(float *output, size_t nFrames)
+{
+    for(size_t offset = 0; offset < nFrames; offset += BLOCK_FRAMES)
+    {
+        const size_t n = std::min(nFrames - offset, size_t(BLOCK_FRAMES));
+        std::fill(mixLeft.begin(), mixLeft.end(), 0.0f);
+        std::fill(mixRight.begin(), mixRight.end(), 0.0f);
+
+        for(auto &voice : voices->all)
+        {
+            if(!voice.active || voice.done)
+            {
+                continue;
+            }
+            const size_t nPulled = Pull(voice, n);
+            voice.done = (nPulled < n);
+
+            // Ramp the gains from the last block's to this one's, so that moving voices do not crackle
+            float gains[2];
+            Spatialize(voice, gains);
+            const float *right = (voice.channels == 2) ? this->right.data() : left.data(); // (Mono: to both sides)
+            const float leftStep = (gains[0] - voice.gains[0]) / n, rightStep = (gains[1] - voice.gains[1]) / n;
+            Accumulate(left.data(), mixLeft.data(), nPulled, voice.gains[0], leftStep);
+            Accumulate(right, mixRight.data(), nPulled, voice.gains[1], rightStep);
+            voice.gains[0] = gains[0];
+            voice.gains[1] = gains[1];
+        }
+
+        Interleave(mixLeft.data(), mixRight.data(), output + offset * 2, n);
+    }
+}
+
+size_t Mixer::Pull(Voice &voice, size_t nFrames)
+{
+    if(voice.samples)
+    {
+        return Resample(voice.samples.get(), voice.nFrames, voice.channels, voice.loop, voice.time, voice.step,
+                        left.data(), right.data(), nFrames);
+    }
+
+    // Streamed: drop the frames that were played from the chunk, then decode the ones to play (and the one after them,
+    // that the last one is interpolated with)
+    const auto first = size_t(voice.time);
+    const size_t nPlayed = std::min(first - voice.chunkStart, voice.chunk.size() / voice.channels);
+    voice.chunk.erase(voice.chunk.begin(), voice.chunk.begin() + nPlayed * voice.channels);
+    voice.chunkStart += nPlayed;
+
+    const size_t nNeeded = size_t(voice.time + double(nFrames) * voice.step) + 2 - voice.chunkStart;
+    while(!voice.ended && voice.chunk.size() / voice.channels < nNeeded)
+    {
+        Decode(voice, nNeeded - voice.chunk.size() / voice.channels);
+    }
+
+    double time = voice.time - double(voice.chunkStart);
+    const size_t nPulled = Resample(voice.chunk.data(), voice.chunk.size() / voice.channels, voice.channels, false,
+                                    time, voice.step, left.data(), right.data(), nFrames);
+    voice.time = double(voice.chunkStart) + time;
+    return nPulled;
+}
+
+void Mixer::Decode(Voice &voice, size_t nFrames)
+{
+    const size_t nDecoded = voice.chunk.size() / voice.channels;
+    voice.chunk.resize((nDecoded + nFrames) * voice.channels);
+    size_t nRead = voice.decoder.Read(voice.chunk.data() + nDecoded * voice.channels, nFrames);
+    if(nRead == 0 && voice.loop)
+    {
+        voice.decoder.Rewind();
+        nRead = voice.decoder.Read(voice.chunk.data() + nDecoded * voice.channels, nFrames);
+    }
+    voice.chunk.resize((nDecoded + nRead) * voice.channels);
+    voice.ended = (nRead == 0); // (Only if it does not loop - or if there is nothing to loop)
+}
+
+void Mixer::Spatialize(const Voice &voice, float gains[2]) const
+{
+    static constexpr float QUARTER_PI = 0.78539816f;
+    float attenuation = 1.0f, pan = 0.0f;
+    if(voice.positional)
+    {
+        const glm::vec3 relative = glm::vec3(listenerView * glm::vec4(voice.position, 1.0f));
+        const float distance = glm::length(relative);
+        attenuation = REFERENCE_DISTANCE / std::max(distance, REFERENCE_DISTANCE);
+        pan = (distance > 0.0f) ? glm::clamp(relative.x / distance, -1.0f, 1.0f) : 0.0f;
+    }
+    if(voice.channels == 1)
+    {
+        // Constant-power panning: as loud anywhere around the listener
+        const float angle = (pan + 1.0f) * QUARTER_PI;
+        gains[0] = std::cos(angle) * attenuation;
+        gains[1] = std::sin(angle) * attenuation;
+    }
+    else
+    {
+        gains[0] = gains[1] = attenuation; // (Stereo clips are not panned, like in OpenAL)
+    }
+}
+
+} // namespace audio
+} // namespace boyd
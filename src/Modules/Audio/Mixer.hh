@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Backend.hh"
+#include "BufferCache.hh"
+#include "Sink.hh"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <vector>
+
+namespace boyd
+{
+namespace audio
+{
+
+/// Mixes clips in software - resampling them (linearly) to the output rate, attenuating them with distance and panning
+/// them around the listener - and outputs the mix to a `Sink`: an OpenAL device, a WAV file or nothing at all.
+/// Unlike `OpenALBackend` it does not need an audio device, and with a clocked sink it only plays as much audio as
+/// the time that passed: playback (and so which clips end when) is deterministic.
+/// NOTE: Not thread-safe - only use it (and release the voices it hands out) from the Audio module's update.
+class Mixer : public Backend
+{
+public:
+    static constexpr unsigned BLOCK_FRAMES = 256; ///< Frames mixed at once (gains are ramped over each block)
+
+    /// Mixes up to `nVoices` clips at once to `sink`.
+    Mixer(unsigned nVoices, std::unique_ptr<Sink> sink);
+
+    Mixer(const Mixer &toCopy) = delete;
+    Mixer &operator=(const Mixer &toCopy) = delete;
+    Mixer(Mixer &&toMove) = delete;
+    Mixer &operator=(Mixer &&toMove) = delete;
+
+    unsigned VoiceCount() const override;
+    bool HasFreeVoice() const override;
+    std::shared_ptr<void> Play(const Clip &clip) override;
+    bool IsDone(void *voice) override;
+    float Tell(void *voice) override;
+    void PlaceListener(const glm::mat4 &matrix) override;
+    void Move(void *voice, const glm::vec3 &position) override;
+    void EndFrame(float timeDelta) override;
+
+    /// Mixes the next `nFrames` frames of all voices to `output` (interleaved stereo; overwritten).
+    /// (`EndFrame()` does this with as many frames as the sink wants, then writes them to it)
+    void Mix(float *output, size_t nFrames);
+
+private:
+    struct Voice;
+    struct Voices;
+
+    /// Pulls the next (up to) `nFrames` frames of a voice, resampled to the output rate, to `left` and `right` (only
+    /// `left` for mono clips). Returns the number of frames pulled - less than `nFrames` once the clip ended.
+    size_t Pull(Voice &voice, size_t nFrames);
+
+    /// Decodes up to `nFrames` more frames of a streamed voice to the end of its chunk, rewinding it if it loops.
+    static void Decode(Voice &voice, size_t nFrames);
+
+    /// Computes the gains to give to the left and right channels of a voice, given where it is.
+    void Spatialize(const Voice &voice, float gains[2]) const;
+
+    std::unique_ptr<Sink> sink;
+    std::shared_ptr<Voices> voices;
+    BufferCache<std::vector<int16_t>> buffers; ///< (16-bit) samples of the clips played recently, if not 16-bit PCM
+    glm::mat4 listenerView = glm::identity<glm::mat4>(); ///< (Inverse of the listener's transform)
+
+    std::vector<float> left, right;       ///< Samples of a voice, for the block being mixed
+    std::vector<float> mixLeft, mixRight; ///< The block being mixed
+    std::vector<float> output;            ///< (For `EndFrame()`)
+};
+
+} // namespace audio
+} // namespace boyd
@@ -0,0 +1,205 @@
+#include "OpenALBackend.hh"
+#include "../../Debug/Log.hh"
+#include "Utils.hh"
+
+#include <BoydEngine.hh>
+
+namespace boyd
+{
+namespace audio
+{
+
+std::unique_ptr<OpenALBackend> OpenALBackend::Create()
+{
+    ALCdevice *device = alcOpenDevice(nullptr);
+    if(!device)
+    {
+        BOYD_LOG(Error, "Could not access the device");
+        BOYD_OPENALC_ERROR(device);
+        return nullptr;
+    }
+    ALCcontext *context = alcCreateContext(device, nullptr);
+    if(!context || alcMakeContextCurrent(context) == ALC_FALSE)
+    {
+        BOYD_LOG(Error, "Could not create an OpenAL context");
+        BOYD_OPENALC_ERROR(device);
+        if(context)
+        {
+            alcDestroyContext(context);
+        }
+        alcCloseDevice(device);
+        return nullptr;
+    }
+
+    // Load all available extensions, similarly to GLEW for OpenGL.
+    const char *name = nullptr;
+    if(alcIsExtensionPresent(device, "ALC_ENUMERATE_ALL_EXT"))
+        name = alcGetString(device, ALC_ALL_DEVICES_SPECIFIER);
+    if(!name || alcGetError(device) != AL_NO_ERROR)
+        name = alcGetString(device, ALC_DEVICE_SPECIFIER);
+
+    BOYD_LOG(Debug, "OpenAL extension detected: {}", name);
+
+    return std::unique_ptr<OpenALBackend>(new OpenALBackend(device, context));
+}
+
+OpenALBackend::OpenALBackend(ALCdevice *device, ALCcontext *context)
+    : device{device}, context{context}
+{
+    voices = std::make_unique<VoicePool>(BOYD_AUDIO_VOICES);
+    buffers = std::make_unique<BufferCache<ALuint>>(size_t(BOYD_AUDIO_PCM_CACHE_MB) * 1024 * 1024);
+    streamer = std::make_unique<Streamer>();
+}
+
+OpenALBackend::~OpenALBackend()
+{
+    alcMakeContextCurrent(context);
+    streamer.reset();
+    voices.reset();
+    buffers.reset();
+    BOYD_LOG(Debug, "Destroying OpenAL context");
+    alcMakeContextCurrent(nullptr);
+    alcDestroyContext(context);
+    BOYD_LOG(Debug, "Closing OpenAL device");
+    alcCloseDevice(device);
+}
+
+unsigned OpenALBackend::VoiceCount() const
+{
+    return voices->Size();
+}
+
+bool OpenALBackend::HasFreeVoice() const
+{
+    return voices->FreeCount() > 0;
+}
+
+std::shared_ptr<void> OpenALBackend::Play(const Clip &clip)
+{
+    auto voice = std::make_shared<Voice>();
+    voice->positional = clip.positional;
+    if(!clip.stream)
+    {
+        // (Before acquiring the source, so that the buffer is released after it)
+        voice->buffer = buffers->Get(clip.wave, [&clip](const uint8_t *samples, size_t size) {
+            auto *name = new ALuint{0};
+            alGenBuffers(1, name);
+            alBufferData(*name, clip.format, samples, ALsizei(size), ALsizei(clip.wave.sampleRate));
+            BOYD_OPENAL_ERROR();
+            return std::shared_ptr<const ALuint>{name, [](const ALuint *name) {
+                                                     alDeleteBuffers(1, name);
+                                                     delete name;
+                                                 }};
+        });
+        if(!voice->buffer)
+        {
+            return nullptr;
+        }
+    }
+    if(!(voice->source = voices->Acquire()))
+    {
+        return nullptr;
+    }
+    const ALuint source = *voice->source;
+
+    alSourcei(source, AL_SOURCE_RELATIVE, clip.positional ? AL_FALSE : AL_TRUE);
+    if(clip.positional)
+    {
+        alSourcefv(source, AL_POSITION, (const ALfloat *)&clip.position);
+    }
+    if(clip.stream)
+    {
+        if(!(voice->stream = streamer->Play(source, clip.format, clip.wave, clip.loop, clip.time)))
+        {
+            return nullptr;
+        }
+    }
+    else
+    {
+        alSourcei(source, AL_BUFFER, *voice->buffer);
+        alSourcei(source, AL_LOOPING, clip.loop ? AL_TRUE : AL_FALSE);
+        alSourcef(source, AL_SEC_OFFSET, clip.time);
+        alSourcePlay(source);
+    }
+    BOYD_OPENAL_ERROR();
+    return voice;
+}
+
+bool OpenALBackend::IsDone(void *voice)
+{
+    auto *alVoice = static_cast<Voice *>(voice);
+    if(alVoice->stream)
+    {
+        return false; // (Streams are refilled - and restarted if they ran dry - until they are released)
+    }
+    ALint state = AL_STOPPED;
+    alGetSourcei(*alVoice->source, AL_SOURCE_STATE, &state);
+    return state == AL_STOPPED;
+}
+
+float OpenALBackend::Tell(void *voice)
+{
+    auto *alVoice = static_cast<Voice *>(voice);
+    if(alVoice->stream)
+    {
+        return Streamer::Tell(alVoice->stream.get()); // (The source only knows its offset into the queued buffers)
+    }
+    ALfloat time = 0.0f;
+    alGetSourcef(*alVoice->source, AL_SEC_OFFSET, &time);
+    BOYD_OPENAL_ERROR();
+    return time;
+}
+
+void OpenALBackend::BeginFrame()
+{
+    alcMakeContextCurrent(context);
+    BOYD_OPENALC_ERROR(device);
+}
+
+void OpenALBackend::PlaceListener(const glm::mat4 &matrix)
+{
+    Suspend();
+    const glm::vec3 position = glm::vec3(matrix[3]);
+    const glm::vec3 orientation[2] = {-glm::normalize(glm::vec3(matrix[2])), // ("At": cameras look down -Z)
+                                      glm::normalize(glm::vec3(matrix[1]))};  // ("Up")
+    alListenerfv(AL_POSITION, (const ALfloat *)&position);
+    alListenerfv(AL_ORIENTATION, (const ALfloat *)orientation);
+    BOYD_OPENAL_ERROR();
+}
+
+void OpenALBackend::Move(void *voice, const glm::vec3 &position)
+{
+    auto *alVoice = static_cast<Voice *>(voice);
+    if(alVoice->positional)
+    {
+        Suspend();
+        alSourcefv(*alVoice->source, AL_POSITION, (const ALfloat *)&position);
+        BOYD_OPENAL_ERROR();
+    }
+}
+
+void OpenALBackend::EndFrame(float timeDelta)
+{
+    if(isSuspended)
+    {
+        alcProcessContext(context);
+        isSuspended = false;
+    }
+#ifdef BOYD_PLATFORM_EMSCRIPTEN
+    streamer->Update(); // (No threads to stream on)
+#endif
+    buffers->Trim();
+}
+
+void OpenALBackend::Suspend()
+{
+    // Suspending the context batches the changes, so that they are all applied at once
+    if(!isSuspended)
+    {
+        alcSuspendContext(context);
+        isSuspended = true;
+    }
+}
+
+} // namespace audio
+} // namespace boyd
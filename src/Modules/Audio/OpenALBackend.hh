@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Backend.hh"
+#include "BufferCache.hh"
+#include "Streamer.hh"
+#include "VoicePool.hh"
+
+#include <AL/al.h>
+#include <AL/alc.h>
+#include <memory>
+
+namespace boyd
+{
+namespace audio
+{
+
+/// Plays clips on OpenAL sources (pooled, see "VoicePool.hh"), letting the OpenAL implementation mix them - usually
+/// in hardware or in its own mixer thread.
+class OpenALBackend : public Backend
+{
+public:
+    /// Opens the default OpenAL device. Returns null if there is none, or if it can't be used.
+    static std::unique_ptr<OpenALBackend> Create();
+
+    ~OpenALBackend() override;
+
+    OpenALBackend(const OpenALBackend &toCopy) = delete;
+    OpenALBackend &operator=(const OpenALBackend &toCopy) = delete;
+    OpenALBackend(OpenALBackend &&toMove) = delete;
+    OpenALBackend &operator=(OpenALBackend &&toMove) = delete;
+
+    unsigned VoiceCount() const override;
+    bool HasFreeVoice() const override;
+    std::shared_ptr<void> Play(const Clip &clip) override;
+    bool IsDone(void *voice) override;
+    float Tell(void *voice) override;
+    void BeginFrame() override;
+    void PlaceListener(const glm::mat4 &matrix) override;
+    void Move(void *voice, const glm::vec3 &position) override;
+    void EndFrame(float timeDelta) override;
+
+private:
+    /// What a voice handed out by `Play()` holds on to.
+    struct Voice
+    {
+        // (Declared in this order so that the stream is stopped first, then the source, then the buffer it played)
+        std::shared_ptr<const ALuint> buffer; ///< Null if streamed
+        std::shared_ptr<const ALuint> source;
+        std::shared_ptr<void> stream; ///< Null if not streamed
+        bool positional;
+    };
+
+    OpenALBackend(ALCdevice *device, ALCcontext *context);
+
+    /// Defers all changes to the context until `EndFrame()`, if not already.
+    void Suspend();
+
+    ALCdevice *device;
+    ALCcontext *context;
+    bool isSuspended{false};
+
+    std::unique_ptr<VoicePool> voices;            ///< Voices to play clips with
+    std::unique_ptr<BufferCache<ALuint>> buffers; ///< Buffers of the clips (but streamed ones) played recently
+    std::unique_ptr<Streamer> streamer;           ///< Plays streamed clips
+};
+
+} // namespace audio
+} // namespace boyd
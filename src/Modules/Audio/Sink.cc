@@ -0,0 +1,170 @@
+#include "Sink.hh"
+#include "../../Debug/Log.hh"
+#include "Utils.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace boyd
+{
+namespace audio
+{
+
+/// Converts float samples in [-1, 1] (clipping them) to 16-bit ones.
+static void ToInt16(const float *samples, size_t nSamples, std::vector<int16_t> &converted)
+{
+    converted.resize(nSamples);
+    for(size_t i = 0; i < nSamples; i++)
+    {
+        converted[i] = int16_t(std::lrint(std::min(std::max(samples[i], -1.0f), 1.0f) * 32767.0f));
+    }
+}
+
+// -- WavSink --------------------------------------------------------------------------------------------------------
+
+/// Size of the header of a canonical WAV file (RIFF + "fmt " + "data" chunk headers).
+static constexpr size_t WAV_HEADER_SIZE = 44;
+
+/// Writes a canonical 16-bit stereo WAV header (see http://soundfile.sapp.org/doc/WaveFormat/).
+static void WriteWavHeader(std::ofstream &file, unsigned sampleRate, size_t dataSize)
+{
+    // (RIFF is little-endian, like all our targets)
+    auto writeU32 = [&file](uint32_t value) { file.write(reinterpret_cast<const char *>(&value), sizeof(value)); };
+    auto writeU16 = [&file](uint16_t value) { file.write(reinterpret_cast<const char *>(&value), sizeof(value)); };
+
+    static constexpr uint16_t CHANNELS = 2, SAMPLE_SIZE = 16;
+    file.write("RIFF", 4);
+    writeU32(uint32_t(WAV_HEADER_SIZE - 8 + dataSize));
+    file.write("WAVEfmt ", 8);
+    writeU32(16);
+    writeU16(1); // (PCM)
+    writeU16(CHANNELS);
+    writeU32(sampleRate);
+    writeU32(sampleRate * CHANNELS * (SAMPLE_SIZE / 8));
+    writeU16(CHANNELS * (SAMPLE_SIZE / 8));
+    writeU16(SAMPLE_SIZE);
+    file.write("data", 4);
+    writeU32(uint32_t(dataSize));
+}
+
+std::unique_ptr<WavSink> WavSink::Create(const std::string &path, unsigned sampleRate)
+{
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    if(!file)
+    {
+        BOYD_LOG(Error, "{}: could not open for writing", path);
+        return nullptr;
+    }
+    WriteWavHeader(file, sampleRate, 0); // (Rewritten with the right sizes when done)
+    return std::unique_ptr<WavSink>(new WavSink(std::move(file), sampleRate));
+}
+
+WavSink::WavSink(std::ofstream &&file, unsigned sampleRate)
+    : ClockedSink{sampleRate}, file{std::move(file)}
+{
+}
+
+WavSink::~WavSink()
+{
+    file.seekp(0);
+    WriteWavHeader(file, SampleRate(), dataSize);
+}
+
+void WavSink::Write(const float *frames, size_t nFrames)
+{
+    ToInt16(frames, nFrames * 2, converted);
+    file.write(reinterpret_cast<const char *>(converted.data()), converted.size() * sizeof(int16_t));
+    dataSize += converted.size() * sizeof(int16_t);
+}
+
+// -- OpenALSink -----------------------------------------------------------------------------------------------------
+
+std::unique_ptr<OpenALSink> OpenALSink::Create(unsigned sampleRate)
+{
+    ALCdevice *device = alcOpenDevice(nullptr);
+    if(!device)
+    {
+        BOYD_LOG(Error, "Could not access the device");
+        BOYD_OPENALC_ERROR(device);
+        return nullptr;
+    }
+    const ALCint attributes[] = {ALC_FREQUENCY, ALCint(sampleRate), 0};
+    ALCcontext *context = alcCreateContext(device, attributes);
+    if(!context || alcMakeContextCurrent(context) == ALC_FALSE)
+    {
+        BOYD_LOG(Error, "Could not create an OpenAL context");
+        BOYD_OPENALC_ERROR(device);
+        if(context)
+        {
+            alcDestroyContext(context);
+        }
+        alcCloseDevice(device);
+        return nullptr;
+    }
+    return std::unique_ptr<OpenALSink>(new OpenALSink(device, context, sampleRate));
+}
+
+OpenALSink::OpenALSink(ALCdevice *device, ALCcontext *context, unsigned sampleRate)
+    : device{device}, context{context}, sampleRate{sampleRate}
+{
+    alGenSources(1, &source);
+    alSourcei(source, AL_SOURCE_RELATIVE, AL_TRUE); // (Already mixed: play it as is)
+    alGenBuffers(N_BUFFERS, buffers);
+    BOYD_OPENAL_ERROR();
+    freeBuffers.assign(std::begin(buffers), std::end(buffers));
+}
+
+OpenALSink::~OpenALSink()
+{
+    alcMakeContextCurrent(context);
+    alSourceStop(source);
+    alSourcei(source, AL_BUFFER, 0); // (Unqueues all buffers)
+    alDeleteSources(1, &source);
+    alDeleteBuffers(N_BUFFERS, buffers);
+    BOYD_OPENAL_ERROR();
+    alcMakeContextCurrent(nullptr);
+    alcDestroyContext(context);
+    alcCloseDevice(device);
+}
+
+size_t OpenALSink::Wanted(float timeDelta)
+{
+    alcMakeContextCurrent(context);
+    ALint nProcessed = 0;
+    alGetSourcei(source, AL_BUFFERS_PROCESSED, &nProcessed);
+    for(; nProcessed > 0; nProcessed--)
+    {
+        ALuint buffer = 0;
+        alSourceUnqueueBuffers(source, 1, &buffer);
+        freeBuffers.push_back(buffer);
+    }
+    BOYD_OPENAL_ERROR();
+    return freeBuffers.size() * BUFFER_FRAMES;
+}
+
+void OpenALSink::Write(const float *frames, size_t nFrames)
+{
+    alcMakeContextCurrent(context);
+    // (Only ever given what `Wanted()` asked for: whole buffers)
+    for(; nFrames >= BUFFER_FRAMES && !freeBuffers.empty(); nFrames -= BUFFER_FRAMES, frames += BUFFER_FRAMES * 2)
+    {
+        const ALuint buffer = freeBuffers.back();
+        freeBuffers.pop_back();
+        ToInt16(frames, BUFFER_FRAMES * 2, converted);
+        alBufferData(buffer, AL_FORMAT_STEREO16, converted.data(), ALsizei(converted.size() * sizeof(int16_t)),
+                     ALsizei(sampleRate));
+        alSourceQueueBuffers(source, 1, &buffer);
+    }
+
+    ALint state = AL_STOPPED;
+    alGetSourcei(source, AL_SOURCE_STATE, &state);
+    if(state != AL_PLAYING)
+    {
+        // First buffers, or underrun: the source played all it had before it could be refilled
+        alSourcePlay(source);
+    }
+    BOYD_OPENAL_ERROR();
+}
+
+} // namespace audio
+} // namespace boyd
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <AL/al.h>
+#include <AL/alc.h>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace boyd
+{
+namespace audio
+{
+
+/// Where the software mixer (see "Mixer.hh") outputs the audio it mixes.
+/// Audio is output as interleaved stereo frames of float samples in [-1, 1].
+class Sink
+{
+public:
+    virtual ~Sink() = default;
+
+    /// Returns the output sample rate.
+    virtual unsigned SampleRate() const = 0;
+
+    /// Returns how many frames to mix and `Write()` now, given that `timeDelta` seconds passed since the last call.
+    virtual size_t Wanted(float timeDelta) = 0;
+
+    /// Outputs the given frames.
+    virtual void Write(const float *frames, size_t nFrames) = 0;
+};
+
+/// A sink that wants as much audio as the time that passed - be it real time or not -, regardless of how fast it is
+/// actually played (if at all). Audio mixed to it is deterministic: it only depends on the time deltas it is given.
+class ClockedSink : public Sink
+{
+public:
+    explicit ClockedSink(unsigned sampleRate)
+        : sampleRate{sampleRate}
+    {
+    }
+
+    unsigned SampleRate() const override
+    {
+        return sampleRate;
+    }
+
+    size_t Wanted(float timeDelta) override
+    {
+        // (Keeps the fraction of a frame that is left over, so that no time is lost over many frames)
+        pending += double(timeDelta) * sampleRate;
+        const auto nFrames = size_t(pending);
+        pending -= double(nFrames);
+        return nFrames;
+    }
+
+private:
+    unsigned sampleRate;
+    double pending{0.0};
+};
+
+/// Discards all audio - for dedicated servers and CI runners, which have no audio device.
+class NullSink : public ClockedSink
+{
+public:
+    using ClockedSink::ClockedSink;
+
+    void Write(const float *, size_t) override
+    {
+    }
+};
+
+/// Records all audio to a 16-bit stereo WAV file.
+class WavSink : public ClockedSink
+{
+public:
+    /// Creates (or overwrites) the file at `path`. Returns null if it can't.
+    static std::unique_ptr<WavSink> Create(const std::string &path, unsigned sampleRate);
+
+    ~WavSink() override;
+
+    void Write(const float *frames, size_t nFrames) override;
+
+private:
+    WavSink(std::ofstream &&file, unsigned sampleRate);
+
+    std::ofstream file;
+    size_t dataSize{0}; ///< (Bytes of samples written so far)
+    std::vector<int16_t> converted;
+};
+
+/// Plays the audio through the default OpenAL device, by queueing it to a single source.
+class OpenALSink : public Sink
+{
+public:
+    static constexpr unsigned N_BUFFERS = 4;        ///< Buffers queued to the source
+    static constexpr unsigned BUFFER_FRAMES = 1024; ///< Length of each buffer
+
+    /// Opens the default OpenAL device. Returns null if there is none, or if it can't be used.
+    static std::unique_ptr<OpenALSink> Create(unsigned sampleRate);
+
+    ~OpenALSink() override;
+
+    OpenALSink(const OpenALSink &toCopy) = delete;
+    OpenALSink &operator=(const OpenALSink &toCopy) = delete;
+    OpenALSink(OpenALSink &&toMove) = delete;
+    OpenALSink &operator=(OpenALSink &&toMove) = delete;
+
+    unsigned SampleRate() const override
+    {
+        return sampleRate;
+    }
+
+    /// Wants to refill the buffers that were played (regardless of `timeDelta`), so that the source never runs dry.
+    size_t Wanted(float timeDelta) override;
+
+    void Write(const float *frames, size_t nFrames) override;
+
+private:
+    OpenALSink(ALCdevice *device, ALCcontext *context, unsigned sampleRate);
+
+    ALCdevice *device;
+    ALCcontext *context;
+    unsigned sampleRate;
+    ALuint source{0};
+    ALuint buffers[N_BUFFERS]{};
+    std::vector<ALuint> freeBuffers; ///< (Not queued)
+    std::vector<int16_t> converted;
+};
+
+} // namespace audio
+} // namespace boyd
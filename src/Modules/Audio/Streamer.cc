@@ -0,0 +1,261 @@
+#include "Streamer.hh"
+#include "../../Debug/Log.hh"
+#include "Utils.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+
+namespace boyd
+{
+namespace audio
+{
+
+struct Streamer::Stream
+{
+    std::mutex mutex;               ///< (Locked while the stream is being refilled or stopped)
+    std::atomic<bool> active{true}; ///< False once stopped
+
+    ALuint source{0};
+    ALenum format{AL_NONE};
+    bool loop{false};
+    Wave wave; ///< (Also keeps the samples alive)
+    ALuint buffers[N_BUFFERS]{};
+    size_t bufferFrames[N_BUFFERS]{}; ///< The number of sample frames last put into each buffer
+    size_t queueStart{0};             ///< The sample frame of the wave the first buffer still queued starts at
+
+    size_t position{0};    ///< The next sample frame to play, for PCM waves
+    flac::Decoder decoder; ///< For FLAC waves
+    std::vector<uint8_t> chunk;
+
+    /// The number of sample frames last put into `buffer` (one of `buffers`).
+    size_t &FramesIn(ALuint buffer)
+    {
+        return bufferFrames[std::find(std::begin(buffers), std::end(buffers), buffer) - std::begin(buffers)];
+    }
+
+    /// Wraps `frame` around the wave if the stream loops, or clamps it to its end if not.
+    size_t Wrap(size_t frame) const
+    {
+        const size_t nFrames = wave.sampleCount;
+        return (loop && nFrames > 0) ? frame % nFrames : std::min(frame, nFrames);
+    }
+};
+
+Streamer::Streamer()
+    : running{true}
+{
+#ifndef BOYD_PLATFORM_EMSCRIPTEN
+    thread = std::thread(&Streamer::ThreadLoop, this);
+#endif
+}
+
+Streamer::~Streamer()
+{
+    {
+        std::unique_lock<std::mutex> lock{threadMutex};
+        running = false;
+    }
+    threadCondVar.notify_all();
+    if(thread.joinable())
+    {
+        thread.join();
+    }
+
+    // Free all buffers while the OpenAL context is still there (handles to the streams may outlive it)
+    for(auto &stream : streams)
+    {
+        Stop(*stream);
+    }
+}
+
+std::shared_ptr<void> Streamer::Play(ALuint source, ALenum format, const Wave &wave, bool loop, float time)
+{
+    auto stream = std::make_shared<Stream>();
+    stream->source = source;
+    stream->format = format;
+    stream->loop = loop;
+    stream->wave = wave;
+    if(wave.codec == Wave::FLAC && !stream->decoder.Open(wave.data.get(), wave.dataSize))
+    {
+        BOYD_LOG(Warn, "Can't stream a corrupt FLAC clip");
+        return nullptr;
+    }
+    Seek(*stream, size_t(double(std::max(time, 0.0f)) * wave.sampleRate));
+
+    alGenBuffers(N_BUFFERS, stream->buffers);
+    BOYD_OPENAL_ERROR();
+    for(ALuint buffer : stream->buffers)
+    {
+        if(Fill(*stream, buffer))
+        {
+            alSourceQueueBuffers(source, 1, &buffer);
+        }
+    }
+    alSourcei(source, AL_LOOPING, AL_FALSE); // (Looping is done by rewinding the stream instead)
+    alSourcePlay(source);
+    BOYD_OPENAL_ERROR();
+
+    {
+        std::unique_lock<std::mutex> lock{streamsMutex};
+        streams.push_back(stream);
+    }
+    return std::shared_ptr<void>(stream.get(), [stream](void *) { Stop(*stream); });
+}
+
+float Streamer::Tell(void *handle)
+{
+    auto &stream = *static_cast<Stream *>(handle);
+    std::unique_lock<std::mutex> lock{stream.mutex};
+    if(!stream.active || stream.wave.sampleRate == 0)
+    {
+        return -1.0f;
+    }
+    // (The source's offset is relative to the first buffer still queued - processed or not)
+    ALint offset = 0;
+    alGetSourcei(stream.source, AL_SAMPLE_OFFSET, &offset);
+    BOYD_OPENAL_ERROR();
+    const size_t frame = stream.Wrap(stream.queueStart + size_t(std::max(offset, 0)));
+    return float(double(frame) / stream.wave.sampleRate);
+}
+
+void Streamer::Update()
+{
+    std::vector<std::shared_ptr<Stream>> toRefill;
+    {
+        std::unique_lock<std::mutex> lock{streamsMutex};
+        streams.erase(std::remove_if(streams.begin(), streams.end(),
+                                     [](const std::shared_ptr<Stream> &stream) { return !stream->active; }),
+                      streams.end());
+        toRefill = streams;
+    }
+
+    for(auto &stream : toRefill)
+    {
+        std::unique_lock<std::mutex> lock{stream->mutex};
+        if(stream->active)
+        {
+            Refill(*stream);
+        }
+    }
+}
+
+void Streamer::Seek(Stream &stream, size_t frame)
+{
+    frame = stream.Wrap(frame);
+    if(stream.wave.codec == Wave::FLAC)
+    {
+        stream.decoder.Rewind();
+        stream.decoder.Skip(frame);
+    }
+    stream.position = frame;
+    stream.queueStart = frame;
+}
+
+bool Streamer::Fill(Stream &stream, ALuint buffer)
+{
+    const Wave &wave = stream.wave;
+    const size_t frameSize = wave.channels * (wave.sampleSize / 8);
+    const size_t chunkFrames = std::max(size_t(wave.sampleRate) * BUFFER_MS / 1000, size_t(1));
+    stream.chunk.resize(chunkFrames * frameSize);
+
+    size_t nFrames = 0;
+    for(bool rewound = false; nFrames < chunkFrames;)
+    {
+        size_t nRead;
+        if(wave.codec == Wave::FLAC)
+        {
+            auto *samples = reinterpret_cast<int16_t *>(stream.chunk.data()) + nFrames * wave.channels;
+            nRead = stream.decoder.Read(samples, chunkFrames - nFrames);
+        }
+        else
+        {
+            nRead = std::min(chunkFrames - nFrames, size_t(wave.sampleCount) - stream.position);
+            std::memcpy(stream.chunk.data() + nFrames * frameSize, wave.data.get() + stream.position * frameSize,
+                        nRead * frameSize);
+            stream.position += nRead;
+        }
+        nFrames += nRead;
+
+        if(nRead == 0 && rewound)
+        {
+            break; // (Empty clip)
+        }
+        rewound = false;
+        if(nFrames < chunkFrames)
+        {
+            if(!stream.loop)
+            {
+                break;
+            }
+            stream.decoder.Rewind();
+            stream.position = 0;
+            rewound = true;
+        }
+    }
+
+    stream.FramesIn(buffer) = nFrames;
+    if(nFrames == 0)
+    {
+        return false;
+    }
+    alBufferData(buffer, stream.format, stream.chunk.data(), ALsizei(nFrames * frameSize), ALsizei(wave.sampleRate));
+    BOYD_OPENAL_ERROR();
+    return true;
+}
+
+void Streamer::Refill(Stream &stream)
+{
+    ALint nProcessed = 0;
+    alGetSourcei(stream.source, AL_BUFFERS_PROCESSED, &nProcessed);
+    for(; nProcessed > 0; nProcessed--)
+    {
+        ALuint buffer = 0;
+        alSourceUnqueueBuffers(stream.source, 1, &buffer);
+        stream.queueStart = stream.Wrap(stream.queueStart + stream.FramesIn(buffer));
+        if(Fill(stream, buffer))
+        {
+            alSourceQueueBuffers(stream.source, 1, &buffer);
+        }
+    }
+
+    ALint state = AL_STOPPED, nQueued = 0;
+    alGetSourcei(stream.source, AL_SOURCE_STATE, &state);
+    alGetSourcei(stream.source, AL_BUFFERS_QUEUED, &nQueued);
+    if(state == AL_STOPPED && nQueued > 0)
+    {
+        // Underrun: the source played all it had before it could be refilled
+        alSourcePlay(stream.source);
+    }
+    BOYD_OPENAL_ERROR();
+}
+
+void Streamer::Stop(Stream &stream)
+{
+    std::unique_lock<std::mutex> lock{stream.mutex};
+    if(!stream.active)
+    {
+        return;
+    }
+    stream.active = false;
+    alSourceStop(stream.source);
+    alSourcei(stream.source, AL_BUFFER, 0); // (Unqueues all buffers)
+    alDeleteBuffers(N_BUFFERS, stream.buffers);
+    BOYD_OPENAL_ERROR();
+}
+
+void Streamer::ThreadLoop()
+{
+    std::unique_lock<std::mutex> lock{threadMutex};
+    while(running)
+    {
+        lock.unlock();
+        Update();
+        lock.lock();
+        threadCondVar.wait_for(lock, std::chrono::milliseconds(REFILL_MS), [this]() { return !running; });
+    }
+}
+
+} // namespace audio
+} // namespace boyd
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../../Components/AudioClip.hh"
+#include "../../Core/Flac.hh"
+#include "../../Core/Platform.hh"
+
+#include <AL/al.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace boyd
+{
+namespace audio
+{
+
+/// Plays clips by decoding them a chunk at a time into a few OpenAL buffers, which are queued to a source and
+/// refilled as soon as they have been played - instead of uploading the whole clip at once.
+/// Streams are refilled by a background thread (or by `Update()` on platforms without threads).
+class Streamer
+{
+public:
+    static constexpr unsigned N_BUFFERS = 4;    ///< Buffers queued to each source
+    static constexpr unsigned BUFFER_MS = 250;  ///< Length of each buffer
+    static constexpr unsigned REFILL_MS = 50;   ///< How often streams are refilled (must be way less than BUFFER_MS)
+
+    Streamer();
+    ~Streamer();
+
+    Streamer(const Streamer &toCopy) = delete;
+    Streamer &operator=(const Streamer &toCopy) = delete;
+    Streamer(Streamer &&toMove) = delete;
+    Streamer &operator=(Streamer &&toMove) = delete;
+
+    /// Starts playing `wave` on `source` (which must have no buffer attached), as `format`, from `time` seconds into
+    /// it; loops it if `loop`.
+    /// Returns a handle that keeps the stream going: releasing it stops the source and frees the stream's buffers.
+    /// Returns null if the wave can't be decoded.
+    std::shared_ptr<void> Play(ALuint source, ALenum format, const Wave &wave, bool loop, float time = 0.0f);
+
+    /// Returns the playback time of the stream behind `handle` (as returned by `Play()`) into its wave, in seconds.
+    static float Tell(void *handle);
+
+    /// Refills the buffers of all streams that played some, and restarts the ones that ran dry in the meantime.
+    /// Done by the streamer's own thread, except on Emscripten - where it must be called every frame instead.
+    void Update();
+
+private:
+    struct Stream;
+
+    /// Moves `stream` to the sample frame `frame` of its wave (wrapped around if it loops).
+    static void Seek(Stream &stream, size_t frame);
+
+    /// Decodes the next chunk of `stream` into `buffer`. Returns false if there is nothing left to play.
+    static bool Fill(Stream &stream, ALuint buffer);
+
+    /// Refills the processed buffers of a stream; `stream.mutex` must be locked.
+    static void Refill(Stream &stream);
+
+    /// Stops a stream and frees its buffers.
+    static void Stop(Stream &stream);
+
+    void ThreadLoop();
+
+    std::mutex streamsMutex;
+    std::vector<std::shared_ptr<Stream>> streams;
+
+    std::thread thread;
+    std::mutex threadMutex;
+    std::condition_variable threadCondVar;
+    std::atomic<bool> running;
+};
+
+} // namespace audio
+} // namespace boyd
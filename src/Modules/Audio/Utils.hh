@@ -1,3 +1,5 @@
+#pragma once
+
 #include <AL/alc.h>
 
 namespace boyd
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "../../Debug/Log.hh"
+#include "Utils.hh"
+
+#include <AL/al.h>
+#include <memory>
+#include <vector>
+
+namespace boyd
+{
+namespace audio
+{
+
+/// A fixed set of OpenAL sources ("voices"), generated once and then handed out to whatever clips need to be heard,
+/// so that playing a sound never allocates driver resources - and never runs into the driver's limit on sources.
+/// NOTE: Not thread-safe - only use it (and release the voices it hands out) from the Audio module's update.
+class VoicePool
+{
+public:
+    /// Generates up to `nVoices` sources (less if the device does not support that many).
+    explicit VoicePool(unsigned nVoices)
+        : voices{std::make_shared<Voices>()}
+    {
+        voices->all.reserve(nVoices);
+        for(unsigned i = 0; i < nVoices; i++)
+        {
+            ALuint source = 0;
+            alGenSources(1, &source);
+            if(alGetError() != AL_NO_ERROR)
+            {
+                BOYD_LOG(Warn, "Only {} of {} audio voices are available", i, nVoices);
+                break;
+            }
+            voices->all.push_back(source);
+        }
+        voices->free = voices->all;
+    }
+
+    ~VoicePool()
+    {
+        alDeleteSources(ALsizei(voices->all.size()), voices->all.data());
+        BOYD_OPENAL_ERROR();
+    }
+
+    VoicePool(const VoicePool &toCopy) = delete;
+    VoicePool &operator=(const VoicePool &toCopy) = delete;
+    VoicePool(VoicePool &&toMove) = delete;
+    VoicePool &operator=(VoicePool &&toMove) = delete;
+
+    /// Takes a free voice; returns null if there is none left.
+    /// The voice goes back to the pool - stopped, and reset to the default settings - when the handle is released.
+    std::shared_ptr<const ALuint> Acquire()
+    {
+        if(voices->free.empty())
+        {
+            return nullptr;
+        }
+        auto *source = new ALuint{voices->free.back()};
+        voices->free.pop_back();
+
+        std::weak_ptr<Voices> pool = voices;
+        return std::shared_ptr<const ALuint>(source, [pool](const ALuint *source) {
+            if(auto alive = pool.lock()) // (Else the source has been deleted together with the pool already)
+            {
+                static constexpr ALfloat ORIGIN[3] = {0.0f, 0.0f, 0.0f};
+                alSourceStop(*source);
+                alSourcei(*source, AL_BUFFER, 0);
+                alSourcei(*source, AL_LOOPING, AL_FALSE);
+                alSourcei(*source, AL_SOURCE_RELATIVE, AL_FALSE);
+                alSourcefv(*source, AL_POSITION, ORIGIN);
+                BOYD_OPENAL_ERROR();
+                alive->free.push_back(*source);
+            }
+            delete source;
+        });
+    }
+
+    /// Returns the total number of voices.
+    inline unsigned Size() const
+    {
+        return unsigned(voices->all.size());
+    }
+
+    /// Returns the number of voices that are not in use.
+    inline unsigned FreeCount() const
+    {
+        return unsigned(voices->free.size());
+    }
+
+private:
+    struct Voices
+    {
+        std::vector<ALuint> all, free;
+    };
+    std::shared_ptr<Voices> voices;
+};
+
+} // namespace audio
+} // namespace boyd
@@ -7,7 +7,9 @@
 #include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #ifdef BOYD_PLATFORM_WIN32
 #    define WIN32_LEAN_AND_MEAN
@@ -23,6 +25,71 @@
 namespace boyd
 {
 
+/// The components (and other shared resources) that a module reads and/or writes in its `Update()`.
+/// Used by the scheduler to find out which modules can be updated concurrently.
+///
+/// Resources are identified by name - usually a component's typename (e.g. "Transform"). Some names are special:
+/// - "*" stands for every possible resource;
+/// - "Entities" is entity creation/destruction. Every module implicitly reads it, so a module that writes it (i.e.
+///   that creates or destroys entities) never runs concurrently with any other module.
+/// Changes that are deferred with `GameState::Defer()` are not accesses: they are applied once no module is running.
+struct ModuleAccess
+{
+    std::vector<std::string> reads;
+    std::vector<std::string> writes;
+    bool mainThread; ///< If true, the module must always be updated on the main thread.
+
+    /// Parses `reads` and `writes` from strings of whitespace-separated resource names.
+    /// A module that declares no accesses at all is assumed to write everything.
+    static ModuleAccess Parse(const char *reads, const char *writes, bool mainThread)
+    {
+        auto split = [](const char *names) {
+            std::vector<std::string> result;
+            std::istringstream stream{names};
+            std::string name;
+            while(stream >> name)
+            {
+                result.push_back(name);
+            }
+            return result;
+        };
+
+        ModuleAccess access{split(reads), split(writes), mainThread};
+        if(access.reads.empty() && access.writes.empty())
+        {
+            access.writes.push_back("*");
+        }
+        access.reads.push_back("Entities");
+        return access;
+    }
+
+    /// Returns true if this and `other` can not be updated concurrently.
+    bool ConflictsWith(const ModuleAccess &other) const
+    {
+        if(mainThread && other.mainThread)
+        {
+            return true; // (Both would run on the main thread anyways)
+        }
+        return Overlap(writes, other.writes) || Overlap(writes, other.reads) || Overlap(reads, other.writes);
+    }
+
+private:
+    static bool Overlap(const std::vector<std::string> &a, const std::vector<std::string> &b)
+    {
+        for(const auto &nameA : a)
+        {
+            for(const auto &nameB : b)
+            {
+                if(nameA == "*" || nameB == "*" || nameA == nameB)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+};
+
 /// Just a wrapper to a module.
 /// Avoid using this directly!
 struct BoydModule
@@ -33,11 +100,12 @@ struct BoydModule
     void (*UpdateFunc)(void *);
     void (*HaltFunc)(void *);
     void *data;
+    ModuleAccess access;
 
     BoydModule(std::string modname,
                decltype(InitFunc) init, decltype(UpdateFunc) update, decltype(HaltFunc) halt,
-               void *data, int priority)
-        : modname{modname}, priority{priority}, InitFunc{init}, UpdateFunc{update}, HaltFunc{halt}, data{data}
+               void *data, int priority, ModuleAccess access)
+        : modname{modname}, priority{priority}, InitFunc{init}, UpdateFunc{update}, HaltFunc{halt}, data{data}, access{access}
     {
     }
 
@@ -56,6 +124,7 @@ struct BoydModule
         this->InitFunc = toMove.InitFunc;
         this->UpdateFunc = toMove.UpdateFunc;
         this->HaltFunc = toMove.HaltFunc;
+        this->access = std::move(toMove.access);
 
         // invalidate handle and function pointers
         toMove.data = nullptr;
@@ -144,8 +213,8 @@ public:
     ///
     /// Note: this wrapper strictly forbids copy constructors.
     const std::filesystem::path filepath;
-    Dll(std::string modname, int priority)
-        : BoydModule{modname, nullptr, nullptr, nullptr, nullptr, priority}, filepath{GetModulePath(modname)}
+    Dll(std::string modname, int priority, ModuleAccess access)
+        : BoydModule{modname, nullptr, nullptr, nullptr, nullptr, priority, access}, filepath{GetModulePath(modname)}
     {
         BOYD_LOG(Info, "Loading module {}", modname);
 
@@ -166,7 +235,7 @@ public:
     Dll &operator=(const Dll &toCopy) = delete;
 
     Dll(Dll &&toMove)
-        : BoydModule({}, nullptr, nullptr, nullptr, nullptr, -1)
+        : BoydModule({}, nullptr, nullptr, nullptr, nullptr, -1, {})
     {
         *this = std::move(toMove);
     }
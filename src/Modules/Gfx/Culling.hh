@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+#include "../../Components/Material.hh"
+#include "../../Components/Mesh.hh"
+#include "../../Components/Transform.hh"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#    include <xmmintrin.h>
+#    define BOYD_CULLING_SSE
+#endif
+
+// NOTE: Nothing in here depends on OpenGL, so that culling can be run (and checked) without a GPU - see
+//       BoydCullingCheck.cc
+
+namespace boyd
+{
+
+/// Per-frame rendering statistics.
+/// (Only computed on the CPU - i.e. valid even when nothing actually gets to the GPU)
+struct RenderStats
+{
+    size_t nEntities{0};    ///< Number of renderable entities in the ECS
+    size_t nCulled{0};      ///< Number of them that were outside of the view frustum
+    size_t nBatches{0};     ///< Number of (instanced) drawcalls issued
+    size_t nTextureSets{0}; ///< Number of distinct sets of textures used by the drawcalls
+};
+
+/// Bounding volumes of a mesh, in model space.
+struct MeshBounds
+{
+    glm::vec3 min{0.0f}, max{0.0f}; ///< Axis-aligned bounding box
+    glm::vec3 center{0.0f};         ///< Bounding sphere center (= the center of the AABB)
+    float radius{-1.0f};            ///< Bounding sphere radius; negative if the mesh is empty
+
+    /// Computes the bounding volumes of the given mesh data.
+    static MeshBounds Compute(const comp::Mesh::Data &data)
+    {
+        MeshBounds bounds;
+        if(data.vertices.empty())
+        {
+            return bounds;
+        }
+
+        bounds.min = bounds.max = data.vertices[0].position;
+        for(const auto &vertex : data.vertices)
+        {
+            bounds.min = glm::min(bounds.min, vertex.position);
+            bounds.max = glm::max(bounds.max, vertex.position);
+        }
+        bounds.center = (bounds.min + bounds.max) * 0.5f;
+
+        float radius2 = 0.0f;
+        for(const auto &vertex : data.vertices)
+        {
+            glm::vec3 delta = vertex.position - bounds.center;
+            radius2 = std::max(radius2, glm::dot(delta, delta));
+        }
+        bounds.radius = std::sqrt(radius2);
+        return bounds;
+    }
+};
+
+/// A world-space bounding sphere.
+struct BoundingSphere
+{
+    glm::vec3 center;
+    float radius;
+
+    /// Transforms the bounding sphere of `bounds` by the `modelMtx`.
+    /// The radius is scaled by the largest scale factor of the matrix, so the result is conservative.
+    static inline BoundingSphere Transformed(const MeshBounds &bounds, const glm::mat4 &modelMtx)
+    {
+        glm::vec3 center = glm::vec3(modelMtx * glm::vec4(bounds.center, 1.0f));
+        float scale2 = std::max({glm::dot(glm::vec3(modelMtx[0]), glm::vec3(modelMtx[0])),
+                                 glm::dot(glm::vec3(modelMtx[1]), glm::vec3(modelMtx[1])),
+                                 glm::dot(glm::vec3(modelMtx[2]), glm::vec3(modelMtx[2]))});
+        return {center, bounds.radius * std::sqrt(scale2)};
+    }
+};
+
+/// A view frustum in world space, made of 6 inward-facing normalized planes.
+///
+/// The planes are stored SoA - padded to 8, by repeating the last two - so that a sphere is tested against 4 of them
+/// at a time.
+class Frustum
+{
+public:
+    static constexpr unsigned N_PLANES = 8;
+
+    /// Extracts the frustum planes from a view-projection matrix (Gribb/Hartmann).
+    explicit Frustum(const glm::mat4 &viewProjectionMtx)
+    {
+        const glm::mat4 m = glm::transpose(viewProjectionMtx); // (So that `m[i]` is the i-th row)
+        const glm::vec4 planes[6] = {
+            m[3] + m[0], // Left
+            m[3] - m[0], // Right
+            m[3] + m[1], // Bottom
+            m[3] - m[1], // Top
+            m[3] + m[2], // Near
+            m[3] - m[2], // Far
+        };
+        for(unsigned i = 0; i < N_PLANES; i++)
+        {
+            glm::vec4 plane = planes[std::min(i, 5u)];
+            float invLength = 1.0f / glm::length(glm::vec3(plane));
+            if(!std::isfinite(invLength))
+            {
+                invLength = 0.0f; // (Degenerate plane, e.g. infinite far plane: never culls)
+            }
+            nx[i] = plane.x * invLength;
+            ny[i] = plane.y * invLength;
+            nz[i] = plane.z * invLength;
+            d[i] = plane.w * invLength;
+        }
+    }
+
+    /// Returns true if the sphere is (even partially) inside the frustum.
+    inline bool Intersects(const BoundingSphere &sphere) const
+    {
+        if(sphere.radius < 0.0f)
+        {
+            return false; // (Empty mesh)
+        }
+
+#ifdef BOYD_CULLING_SSE
+        const __m128 cx = _mm_set1_ps(sphere.center.x);
+        const __m128 cy = _mm_set1_ps(sphere.center.y);
+        const __m128 cz = _mm_set1_ps(sphere.center.z);
+        const __m128 negRadius = _mm_set1_ps(-sphere.radius);
+        int outside = 0;
+        for(unsigned i = 0; i < N_PLANES; i += 4)
+        {
+            __m128 dist = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&nx[i]), cx), _mm_load_ps(&d[i]));
+            dist = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&ny[i]), cy), dist);
+            dist = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&nz[i]), cz), dist);
+            outside |= _mm_movemask_ps(_mm_cmplt_ps(dist, negRadius));
+        }
+        return outside == 0;
+#else
+        bool outside = false;
+        for(unsigned i = 0; i < N_PLANES; i++)
+        {
+            float dist = nx[i] * sphere.center.x + ny[i] * sphere.center.y + nz[i] * sphere.center.z + d[i];
+            outside |= dist < -sphere.radius;
+        }
+        return !outside;
+#endif
+    }
+
+private:
+    alignas(16) float nx[N_PLANES];
+    alignas(16) float ny[N_PLANES];
+    alignas(16) float nz[N_PLANES];
+    alignas(16) float d[N_PLANES];
+};
+
+/// Calls `visible(transform, mesh, material, sphere)` for every renderable entity (one with a Transform, a Mesh and a
+/// Material) whose world-space bounding `sphere` intersects the `frustum`, counting the renderable and culled entities
+/// in `stats`. Entities whose mesh or material has no data are culled.
+/// `boundsOf(mesh)` returns the `MeshBounds` of a mesh (with data); they can be cached, as the Gfx module does.
+template <typename TBoundsOf, typename TVisible>
+inline void CullRenderables(entt::registry &ecs, const Frustum &frustum, RenderStats &stats, TBoundsOf &&boundsOf,
+                            TVisible &&visible)
+{
+    ecs.view<comp::Transform, comp::Mesh, comp::Material>().each(
+        [&](auto, const comp::Transform &transform, const comp::Mesh &mesh, const comp::Material &material) {
+            stats.nEntities++;
+            if(!mesh.data || !material.data)
+            {
+                stats.nCulled++;
+                return;
+            }
+            const BoundingSphere sphere = BoundingSphere::Transformed(boundsOf(mesh), transform.matrix);
+            if(!frustum.Intersects(sphere))
+            {
+                stats.nCulled++;
+                return;
+            }
+            visible(transform, mesh, material, sphere);
+        });
+}
+
+} // namespace boyd
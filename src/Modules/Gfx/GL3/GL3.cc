@@ -1,7 +1,18 @@
 #include "GL3.hh"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "../../Core/BlockCompression.hh"
 #include "../../Core/Utils.hh"
 #include "../../Debug/Log.hh"
+#include "../VertexPacking.hh"
+
+#ifdef BOYD_PLATFORM_EMSCRIPTEN
+#    include <emscripten/html5.h>
+#endif
 
 #define BOYD_CHECK(cond, ...)                           \
     if(!(cond))                                         \
@@ -10,9 +21,6 @@
         return false;                                   \
     }
 
-#define BOYD_OFFSETOF(type, field) \
-    reinterpret_cast<void *>(offsetof(type, field))
-
 namespace boyd
 {
 namespace gl3
@@ -40,70 +48,217 @@ static constexpr const GLenum GL_USAGE_MAP[] = {
     GL_STREAM_DRAW,  // Streaming
 };
 
-bool UploadMesh(const comp::Mesh &mesh, gl3::SharedMesh &gpuMesh)
+/// Uploads `count` elements of `elementSize` bytes each from `data` to the `buffer` bound to `target`, whose storage is
+/// currently `capacity` bytes, according to `usage`.
+/// `dirty` is the range of elements that changed since the data was last uploaded to the buffer, if known.
+static void UploadBufferData(GLenum target, size_t &capacity, const void *data, size_t count, size_t elementSize,
+                             comp::Mesh::Usage usage, const comp::Mesh::Range *dirty)
 {
+    const size_t size = count * elementSize;
+    const auto *bytes = reinterpret_cast<const uint8_t *>(data);
+
+    switch(usage)
+    {
+    case comp::Mesh::Static:
+        // Static: (re)specify the whole buffer, exactly as big as needed
+        glBufferData(target, size, data, GL_USAGE_MAP[usage]);
+        capacity = size;
+        break;
+
+    case comp::Mesh::Dynamic:
+        if(size > capacity)
+        {
+            // Grow geometrically, so that meshes that keep growing do not reallocate every time
+            capacity = std::max(size, capacity + capacity / 2);
+            glBufferData(target, capacity, nullptr, GL_USAGE_MAP[usage]);
+            dirty = nullptr; // (Must upload everything)
+        }
+        if(dirty && !dirty->Empty() && dirty->begin < count)
+        {
+            // Only upload the range that changed
+            size_t end = std::min(dirty->end, count);
+            glBufferSubData(target, dirty->begin * elementSize, (end - dirty->begin) * elementSize,
+                            bytes + dirty->begin * elementSize);
+        }
+        else if(!dirty)
+        {
+            glBufferSubData(target, 0, size, data);
+        }
+        break;
+
+    default: // comp::Mesh::Stream
+        // Orphan the old storage and write to a fresh one, so that the driver does not have to wait for the GPU to
+        // finish drawing with the old data (= the driver's own ring of buffers)
+        capacity = std::max(size, capacity);
+        glBufferData(target, capacity, nullptr, GL_USAGE_MAP[usage]);
+        glBufferSubData(target, 0, size, data);
+        break;
+    }
+}
+
+bool UploadMesh(const comp::Mesh &mesh, gl3::SharedMesh &gpuMesh, unsigned gpuVersion)
+{
+    const auto &data = *mesh.data;
+
+    // Use 16-bit indices whenever all vertices can be indexed with them - except 0xFFFF, which WebGL 2 always treats
+    // as the primitive restart index
+    const GLenum indexType = data.vertices.size() <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    const size_t vertexStride = VertexStride(data.layout);
+
+    // The dirty ranges in the data cover all that changed since the last upload; can't use them if the format of the
+    // data on the GPU changes - or if the edits did not tell what they changed
+    const bool sameFormat = gpuMesh.layout == data.layout && gpuMesh.indexType == indexType;
+    const bool rangesKnown = gpuVersion != 0 && sameFormat
+                             && !(data.dirtyVertices.Empty() && data.dirtyIndices.Empty());
+    const comp::Mesh::Range *dirtyVertices = rangesKnown ? &data.dirtyVertices : nullptr;
+    const comp::Mesh::Range *dirtyIndices = rangesKnown ? &data.dirtyIndices : nullptr;
+
+    // Convert the indices/vertices to the format they are stored with on the GPU, if it differs from the one in RAM
+    // NOTE: The scratch buffers are reused across calls to avoid reallocating them every time
+    static thread_local std::vector<uint16_t> indices16;
+    static thread_local std::vector<uint8_t> packedVertices;
+
+    const void *indexData = data.indices.data();
+    if(indexType == GL_UNSIGNED_SHORT)
+    {
+        indices16.resize(data.indices.size());
+        PackIndices16(data.indices.data(), data.indices.size(), indices16.data());
+        indexData = indices16.data();
+    }
+
+    const void *vertexData = data.vertices.data();
+    if(data.layout != comp::Mesh::Layout::Full())
+    {
+        packedVertices.resize(data.vertices.size() * vertexStride);
+        PackVertices(data.vertices.data(), data.vertices.size(), data.layout, packedVertices.data());
+        vertexData = packedVertices.data();
+    }
+
+    bool newVao = !sameFormat; // (The attribute pointers need to change along with the vertex layout)
     if(gpuMesh.vao == 0)
     {
         gpuMesh.vao = SharedVertexArray();
         BOYD_CHECK(gpuMesh.vao != 0, "Failed to create VAO")
+        newVao = true;
     }
     glBindVertexArray(gpuMesh.vao);
 
     if(gpuMesh.ibo == 0)
     {
-        gpuMesh.ibo = SharedBuffer(GL_ELEMENT_ARRAY_BUFFER,
-                                   mesh.data->indices.size() * sizeof(comp::Mesh::Index),
-                                   mesh.data->indices.data(),
-                                   GL_USAGE_MAP[mesh.data->usage]);
+        gpuMesh.ibo = SharedBuffer();
         BOYD_CHECK(gpuMesh.ibo != 0, "Failed to create IBO")
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.ibo);
-    }
-    else
-    {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.ibo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     mesh.data->indices.size() * sizeof(comp::Mesh::Index),
-                     mesh.data->indices.data(),
-                     GL_USAGE_MAP[mesh.data->usage]);
+        gpuMesh.iboCapacity = 0;
+        dirtyIndices = nullptr;
+        newVao = true;
     }
+    // NOTE: The IBO binding is part of the VAO state
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.ibo);
+    UploadBufferData(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.iboCapacity,
+                     indexData, data.indices.size(), indexSize,
+                     data.usage, dirtyIndices);
 
     if(gpuMesh.vbo == 0)
     {
-        gpuMesh.vbo = SharedBuffer(GL_ARRAY_BUFFER,
-                                   mesh.data->vertices.size() * sizeof(comp::Mesh::Vertex),
-                                   mesh.data->vertices.data(),
-                                   GL_USAGE_MAP[mesh.data->usage]);
+        gpuMesh.vbo = SharedBuffer();
         BOYD_CHECK(gpuMesh.vbo != 0, "Failed to create VBO")
-        glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.vbo);
+        gpuMesh.vboCapacity = 0;
+        dirtyVertices = nullptr;
+        newVao = true;
     }
-    else
+    glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.vbo);
+    UploadBufferData(GL_ARRAY_BUFFER, gpuMesh.vboCapacity,
+                     vertexData, data.vertices.size(), vertexStride,
+                     data.usage, dirtyVertices);
+
+    gpuMesh.indexType = indexType;
+    gpuMesh.layout = data.layout;
+
+    if(!newVao)
     {
-        glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.ibo);
-        glBufferData(GL_ARRAY_BUFFER,
-                     mesh.data->vertices.size() * sizeof(comp::Mesh::Vertex),
-                     mesh.data->vertices.data(),
-                     GL_USAGE_MAP[mesh.data->usage]);
+        // The buffers are the same as before (just their contents changed), so the attribute pointers still hold
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+        return true;
     }
 
-    // Vertex attrib pointers - see the layout of `comp::Mesh::Vertex`!
+    // Vertex attrib pointers - see `VertexOffsets` and `comp::Mesh::Layout`!
+    using Layout = comp::Mesh::Layout;
+    const VertexOffsets offsets{data.layout};
+    auto offsetPtr = [](size_t offset) {
+        return reinterpret_cast<void *>(offset);
+    };
 
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, false,
-                          sizeof(comp::Mesh::Vertex), BOYD_OFFSETOF(comp::Mesh::Vertex, position));
+    glVertexAttribPointer(0, 3, GL_FLOAT, false, vertexStride, offsetPtr(offsets.position));
+
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, true, //< NOTE: normalized
-                          sizeof(comp::Mesh::Vertex), BOYD_OFFSETOF(comp::Mesh::Vertex, normal));
+    if(data.layout.normal == Layout::NormalOct16)
+    {
+        // NOTE: Decoded in the vertex shader, see `u_OctahedralNormals`
+        glVertexAttribPointer(1, 2, GL_SHORT, true, vertexStride, offsetPtr(offsets.normal));
+    }
+    else
+    {
+        glVertexAttribPointer(1, 3, GL_FLOAT, true, vertexStride, offsetPtr(offsets.normal));
+    }
+
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, false,
-                          sizeof(comp::Mesh::Vertex), BOYD_OFFSETOF(comp::Mesh::Vertex, tint));
+    if(data.layout.tint == Layout::TintRGBA8)
+    {
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, true, vertexStride, offsetPtr(offsets.tint));
+    }
+    else
+    {
+        glVertexAttribPointer(2, 4, GL_FLOAT, false, vertexStride, offsetPtr(offsets.tint));
+    }
+
     glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 2, GL_FLOAT, false,
-                          sizeof(comp::Mesh::Vertex), BOYD_OFFSETOF(comp::Mesh::Vertex, texCoord));
+    switch(data.layout.texCoord)
+    {
+    case Layout::TexCoordHalf2:
+        glVertexAttribPointer(3, 2, GL_HALF_FLOAT, false, vertexStride, offsetPtr(offsets.texCoord));
+        break;
+    case Layout::TexCoordUnorm16:
+        glVertexAttribPointer(3, 2, GL_UNSIGNED_SHORT, true, vertexStride, offsetPtr(offsets.texCoord));
+        break;
+    default: // Layout::TexCoordFloat2
+        glVertexAttribPointer(3, 2, GL_FLOAT, false, vertexStride, offsetPtr(offsets.texCoord));
+        break;
+    }
+
+    // Per-instance model matrix - see `BindInstanceTransforms()`
+    for(GLuint iColumn = 0; iColumn < 4; iColumn++)
+    {
+        glEnableVertexAttribArray(INSTANCE_TRANSFORM_LOCATION + iColumn);
+        glVertexAttribDivisor(INSTANCE_TRANSFORM_LOCATION + iColumn, 1);
+    }
 
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
     return true;
 }
 
+void BindInstanceTransforms(GLuint buffer, size_t firstInstance)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for(GLuint iColumn = 0; iColumn < 4; iColumn++)
+    {
+        size_t offset = firstInstance * sizeof(glm::mat4) + iColumn * sizeof(glm::vec4);
+        glVertexAttribPointer(INSTANCE_TRANSFORM_LOCATION + iColumn, 4, GL_FLOAT, false,
+                              sizeof(glm::mat4), reinterpret_cast<void *>(offset));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// (Not in the GLES3 headers; EXT_texture_compression_s3tc / WEBGL_compressed_texture_s3tc)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#    define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#    define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
 /// Map Texture::Format to OpenGL <internalFormat, format, input data type>.
 struct ImageFormat
 {
@@ -118,10 +273,13 @@ static constexpr const ImageFormat GL_IMAGEFORMAT_MAP[] = {
     {GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE},
     {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE},
     // 16-bit float
-    {GL_R16F, GL_RED, GL_FLOAT},
-    {GL_RG16F, GL_RG, GL_FLOAT},
-    {GL_RGB16F, GL_RGB, GL_FLOAT},
-    {GL_RGBA16F, GL_RGBA, GL_FLOAT},
+    {GL_R16F, GL_RED, GL_HALF_FLOAT},
+    {GL_RG16F, GL_RG, GL_HALF_FLOAT},
+    {GL_RGB16F, GL_RGB, GL_HALF_FLOAT},
+    {GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT},
+    // Block-compressed (format/dtype unused)
+    {GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_RGB, GL_UNSIGNED_BYTE},
+    {GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_RGBA, GL_UNSIGNED_BYTE},
 };
 
 /// Map Texture::Filter to OpenGL filtering modes.
@@ -132,6 +290,35 @@ static constexpr const GLenum GL_IMAGEFILTER_MAP[] = {
     GL_LINEAR_MIPMAP_LINEAR, // Anisotropic
 };
 
+/// Returns true if the GL context can sample S3TC (BC1/BC3) textures.
+static bool HasS3tc()
+{
+    static const bool hasS3tc = [] {
+#ifdef BOYD_PLATFORM_EMSCRIPTEN
+        // WebGL 2 exposes S3TC as WEBGL_compressed_texture_s3tc (when the GPU has it, i.e. on desktop - mostly), which
+        // has to be enabled before it can be used
+        if(emscripten_webgl_enable_extension(emscripten_webgl_get_current_context(), "WEBGL_compressed_texture_s3tc"))
+        {
+            return true;
+        }
+#else
+        GLint nExtensions = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &nExtensions);
+        for(GLint i = 0; i < nExtensions; i++)
+        {
+            const auto *name = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+            if(name && std::strstr(name, "texture_compression_s3tc"))
+            {
+                return true;
+            }
+        }
+#endif
+        BOYD_LOG(Warn, "S3TC textures not supported by the GPU; decompressing them on the CPU");
+        return false;
+    }();
+    return hasS3tc;
+}
+
 bool UploadTexture(const comp::Texture &texture, gl3::SharedTexture &gpuTexture)
 {
     if(gpuTexture == 0)
@@ -141,31 +328,180 @@ bool UploadTexture(const comp::Texture &texture, gl3::SharedTexture &gpuTexture)
         BOYD_CHECK(gpuTexture != 0, "Failed to create texture")
     }
 
-    const auto &imgFormat = GL_IMAGEFORMAT_MAP[texture.data->format];
+    const auto &data = *texture.data;
+    // If the GPU can't sample block-compressed textures, decompress them to RGB(A)8 here as a fallback
+    const bool decompress = comp::Texture::IsCompressed(data.format) && !HasS3tc();
+    const bool isCompressed = comp::Texture::IsCompressed(data.format) && !decompress;
+    const unsigned channels = (data.format == comp::Texture::BC1) ? 3 : 4;
+    const auto &imgFormat = GL_IMAGEFORMAT_MAP[!decompress     ? data.format
+                                               : channels == 3 ? comp::Texture::RGB8
+                                                               : comp::Texture::RGBA8];
 
     glBindTexture(GL_TEXTURE_2D, gpuTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0,
-                 imgFormat.internalFormat,
-                 texture.data->width, texture.data->height, 0,
-                 imgFormat.format,
-                 imgFormat.dtype,
-                 texture.data->pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // (Rows of RGB8 or small mip levels are not 4-byte aligned)
+
+    // Upload all levels stored in RAM (mipmaps are usually built by the asset loader)
+    std::vector<uint8_t> decompressed;
+    for(unsigned level = 0; level < data.levels; level++)
+    {
+        const GLsizei width = GLsizei(data.LevelWidth(level)), height = GLsizei(data.LevelHeight(level));
+        const uint8_t *pixels = data.pixels.data() + data.LevelOffset(level);
+        if(isCompressed)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, GLint(level), imgFormat.internalFormat, width, height, 0,
+                                   GLsizei(data.LevelSize(level)), pixels);
+            continue;
+        }
+        if(decompress)
+        {
+            decompressed.resize(size_t(width) * size_t(height) * channels);
+            bcn::DecompressImage(pixels, unsigned(width), unsigned(height), channels, decompressed.data());
+            pixels = decompressed.data();
+        }
+        glTexImage2D(GL_TEXTURE_2D, GLint(level), imgFormat.internalFormat, width, height, 0,
+                     imgFormat.format, imgFormat.dtype, pixels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
     // (NOTE: might be required on Emscripten)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_IMAGEFILTER_MAP[texture.data->minFilter]);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_IMAGEFILTER_MAP[texture.data->magFilter]);
-    if(texture.data->minFilter == comp::Texture::Trilinear || texture.data->minFilter == comp::Texture::Anisotropic)
+    GLenum minFilter = GL_IMAGEFILTER_MAP[data.minFilter];
+    const bool wantsMipmaps = data.minFilter == comp::Texture::Trilinear
+                              || data.minFilter == comp::Texture::Anisotropic;
+    if(wantsMipmaps && data.levels == 1)
     {
-        glGenerateMipmap(gpuTexture);
+        if(isCompressed)
+        {
+            minFilter = GL_LINEAR; // (Can't generate mipmaps for compressed textures, would be incomplete otherwise)
+        }
+        else
+        {
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
     }
+    else
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(data.levels - 1));
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_IMAGEFILTER_MAP[data.magFilter]);
 
     glBindTexture(GL_TEXTURE_2D, 0);
     return true;
 }
 
+bool UploadCubemap(const comp::Skybox::Cubemap &cubemap, gl3::SharedTexture &gpuTexture)
+{
+    const auto &first = cubemap.faces[0];
+    for(const auto &face : cubemap.faces)
+    {
+        BOYD_CHECK(!comp::Texture::IsCompressed(face.format) && face.format == first.format
+                       && face.width == first.width && face.height == first.width && face.levels == first.levels
+                       && face.pixels.size() >= face.LevelOffset(face.levels),
+                   "Cube map faces must be uncompressed, square and all alike")
+    }
+    if(gpuTexture == 0)
+    {
+        gpuTexture = gl3::SharedTexture{0};
+        glGenTextures(1, gpuTexture.handle.get());
+        BOYD_CHECK(gpuTexture != 0, "Failed to create texture")
+    }
+
+    const auto &imgFormat = GL_IMAGEFORMAT_MAP[first.format];
+    glBindTexture(GL_TEXTURE_CUBE_MAP, gpuTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for(GLenum face = 0; face < comp::Skybox::Cubemap::_Count; face++)
+    {
+        const auto &data = cubemap.faces[face];
+        for(unsigned level = 0; level < data.levels; level++)
+        {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, GLint(level), imgFormat.internalFormat,
+                         GLsizei(data.LevelWidth(level)), GLsizei(data.LevelHeight(level)), 0, imgFormat.format,
+                         imgFormat.dtype, data.pixels.data() + data.LevelOffset(level));
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // (Mip chains of cube maps are built - or prefiltered - by the asset loader, and may stop before 1x1)
+    GLenum minFilter = GL_IMAGEFILTER_MAP[first.minFilter];
+    if(first.levels == 1 && minFilter == GL_LINEAR_MIPMAP_LINEAR)
+    {
+        minFilter = GL_LINEAR; // (Would be incomplete otherwise)
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, GLint(first.levels - 1));
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_IMAGEFILTER_MAP[first.magFilter]);
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    return true;
+}
+
+static void PackFloats(std::vector<float> &values, const float *floats, size_t nFloats)
+{
+    values.insert(values.end(), floats, floats + nFloats);
+}
+
+CompiledMaterial CompileMaterial(const comp::Material &material, SharedProgram &program)
+{
+    CompiledMaterial compiled;
+    compiled.source = material.data;
+    compiled.version = material.data.Version();
+    if(!material.data)
+    {
+        return compiled;
+    }
+
+    std::string uniformName;
+    for(const auto &param : material.data->parameters)
+    {
+        uniformName = fmt::format(FMT_STRING("u_{}"), param.first);
+        GLint uniformLoc = program.uniformLocation(uniformName);
+        if(uniformLoc < 0)
+        {
+            continue;
+        }
+
+        if(const auto *texture = std::get_if<comp::Texture>(&param.second))
+        {
+            compiled.samplers.push_back({uniformLoc, *texture});
+            continue;
+        }
+
+        size_t offset = compiled.values.size();
+        switch(param.second.index())
+        {
+        case 0: // float
+            PackFloats(compiled.values, &std::get<float>(param.second), 1);
+            break;
+        case 1: // glm::vec2
+            PackFloats(compiled.values, &std::get<glm::vec2>(param.second)[0], 2);
+            break;
+        case 2: // glm::vec3
+            PackFloats(compiled.values, &std::get<glm::vec3>(param.second)[0], 3);
+            break;
+        case 3: // glm::vec4
+            PackFloats(compiled.values, &std::get<glm::vec4>(param.second)[0], 4);
+            break;
+        case 4: // glm::mat3
+            PackFloats(compiled.values, &std::get<glm::mat3>(param.second)[0][0], 9);
+            break;
+        case 5: // glm::mat4
+            PackFloats(compiled.values, &std::get<glm::mat4>(param.second)[0][0], 16);
+            break;
+        default:
+            continue;
+        }
+        compiled.uniforms.push_back({uniformLoc, param.second.index(), offset});
+    }
+
+    return compiled;
+}
+
 GLuint CompileShader(GLenum type, std::string source)
 {
     GLuint shader = glCreateShader(type);
@@ -5,7 +5,9 @@
 #include <utility>
 #include <vector>
 
+#include "../../Components/Material.hh"
 #include "../../Components/Mesh.hh"
+#include "../../Components/Skybox.hh"
 #include "../../Components/Texture.hh"
 #include "../../Debug/Log.hh"
 
@@ -22,15 +24,56 @@ namespace gl3
 GLuint UploadBuffer(GLenum target, const void *data, size_t dataSize, GLenum usage = GL_STATIC_DRAW);
 
 /// Uploads a mesh from RAM to the GPU.
-/// Creates a VBO, IBO and VAO for `gpuMesh` if required - otherwise just changes the contained data.
+/// Creates a VBO, IBO and VAO for `gpuMesh` if required - otherwise just changes the contained data, according to the
+/// mesh's `Usage`. `gpuVersion` is the version of the mesh data that is currently in `gpuMesh` (0 if none).
 /// Either generates or updates the given `gpuMesh` to match `mesh` or returns false on error.
-bool UploadMesh(const comp::Mesh &mesh, gl3::SharedMesh &gpuMesh);
+bool UploadMesh(const comp::Mesh &mesh, gl3::SharedMesh &gpuMesh, unsigned gpuVersion = 0);
+
+/// The first vertex attribute location of the per-instance model matrix (which takes 4 locations, one per column).
+static constexpr GLuint INSTANCE_TRANSFORM_LOCATION = 4;
+
+/// Points the per-instance model matrix attributes of the currently-bound VAO to the `glm::mat4`s stored in `buffer`,
+/// starting from the one at index `firstInstance`.
+void BindInstanceTransforms(GLuint buffer, size_t firstInstance);
 
 /// Uploads a texture from RAM to the GPU.
 /// Creates a texture for `gpuTexture` if required - otherwise just changes the contained data.
 /// Either generates or updates the given `gpuTexture` to match `texture` or returns false on error.
 bool UploadTexture(const comp::Texture &texture, gl3::SharedTexture &gpuTexture);
 
+/// Uploads a cube map (all levels of its six faces, which must be uncompressed) from RAM to the GPU.
+/// Creates a texture for `gpuTexture` if required - otherwise just changes the contained data.
+/// Either generates or updates the given `gpuTexture` to match `cubemap` or returns false on error.
+bool UploadCubemap(const comp::Skybox::Cubemap &cubemap, gl3::SharedTexture &gpuTexture);
+
+/// A `comp::Material` whose parameters have been resolved to the uniforms of a certain shader program.
+/// Applying it to the program requires no string formatting nor lookups, just going through flat arrays.
+struct CompiledMaterial
+{
+    struct Uniform
+    {
+        GLint location;
+        size_t type;   ///< Index of the value's type in `comp::MaterialParameter`
+        size_t offset; ///< Offset of the value in `values` (in floats)
+    };
+    struct Sampler
+    {
+        GLint location;
+        comp::Texture texture;
+    };
+
+    std::vector<Uniform> uniforms; ///< The non-texture parameters that the program uses
+    std::vector<float> values;     ///< The values of all `uniforms`, packed
+    std::vector<Sampler> samplers; ///< The texture parameters that the program uses (in texture unit order)
+
+    Versioned<comp::Material::Data>::Weak source; ///< The material data this was compiled from (not kept alive!)
+    unsigned version{0};                          ///< Version of the material data this was compiled from
+    unsigned long lastUsed{0};                    ///< The last frame in which this was used
+};
+
+/// Compiles `material` for the given `program`. Parameters that the program does not use are skipped.
+CompiledMaterial CompileMaterial(const comp::Material &material, SharedProgram &program);
+
 /// Compiles a OpenGL shader.
 /// Returns 0 on error.
 GLuint CompileShader(GLenum type, std::string source);
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "../../Components/Mesh.hh"
 #include "../../Core/Platform.hh"
 #include "../../Debug/Log.hh"
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -176,7 +179,8 @@ public:
         {
             glGetActiveUniform(handle, GLuint(i), sizeof(uniformName), &uniformNameLen, &uSize, &uType, uniformName);
             std::string nameStr{uniformName, size_t(uniformNameLen)};
-            uniforms[nameStr] = i;
+            // NOTE: The uniform's location is not necessarily its index!
+            uniforms[nameStr] = glGetUniformLocation(handle, nameStr.c_str());
             //BOYD_LOG(Debug, "Program {}: uniform {} is {}", handle, i, nameStr);
         }
     }
@@ -214,15 +218,21 @@ struct SharedMesh
     SharedVertexArray vao;
     SharedBuffer vbo;
     SharedBuffer ibo;
+    size_t vboCapacity;         ///< Size of the storage allocated for `vbo`, in bytes
+    size_t iboCapacity;         ///< Size of the storage allocated for `ibo`, in bytes
+    GLenum indexType;           ///< Type of the indices in `ibo` (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT)
+    comp::Mesh::Layout layout;  ///< Layout of the vertices in `vbo`
 
     /// Creates a new, uninitialized mesh.
     SharedMesh()
-        : vao{0}, vbo{0}, ibo{0}
+        : vao{0}, vbo{0}, ibo{0}, vboCapacity{0}, iboCapacity{0}, indexType{GL_UNSIGNED_INT}, layout{}
     {
     }
     /// Creates a new mesh from the given VAO and buffers (that will be implicitly shared).
-    SharedMesh(SharedVertexArray vao, SharedBuffer vbo, SharedBuffer ibo)
-        : vao{vao}, vbo{vbo}, ibo{ibo}
+    SharedMesh(SharedVertexArray vao, SharedBuffer vbo, SharedBuffer ibo, size_t vboCapacity, size_t iboCapacity,
+               GLenum indexType, comp::Mesh::Layout layout)
+        : vao{vao}, vbo{vbo}, ibo{ibo}, vboCapacity{vboCapacity}, iboCapacity{iboCapacity}, indexType{indexType},
+          layout{layout}
     {
     }
 
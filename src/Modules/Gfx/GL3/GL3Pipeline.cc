@@ -16,6 +16,7 @@ struct ShaderPaths
 /// Shader filepaths, indexed by pipeline step...
 static constexpr const ShaderPaths SHADERS_PATHS[] = {
     {"assets/Shaders/Forward.vs", "assets/Shaders/Forward.fs"},
+    {"assets/Shaders/Skybox.vs", "assets/Shaders/Skybox.fs"},
 };
 
 /// Loads & compiles a shader.
@@ -13,7 +13,8 @@ struct Pipeline
     enum Stages : unsigned
     {
         Forward = 0, ///< Forward rendering + lighting.
-        _Last = Forward,
+        Skybox,      ///< Skybox, drawn behind everything rendered before it.
+        _Last = Skybox,
     };
     struct Stage
     {
@@ -21,6 +22,10 @@ struct Pipeline
     };
     Stage stages[_Last + 1];
 
+    /// A VAO with no attributes, for drawcalls that generate their vertices from `gl_VertexID`.
+    /// (A VAO must be bound to draw anything, even without any attribute)
+    gl3::SharedVertexArray emptyVao;
+
     /// Load all pipeline stages & their resources.
     Pipeline();
     ~Pipeline();
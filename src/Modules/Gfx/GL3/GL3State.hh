@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "../Glfw.hh"
+
+namespace boyd
+{
+namespace gl3
+{
+
+/// A shadow copy of (some of) the OpenGL state, used to skip redundant state changes between drawcalls.
+///
+/// WARNING: All state changes that go through it must *only* go through it - or it must be `Invalidate()`d after!
+class StateCache
+{
+public:
+    static constexpr unsigned MAX_TEXTURE_UNITS = 16;
+
+    StateCache()
+    {
+        Invalidate();
+    }
+
+    /// Forget all cached state, so that the next calls will all hit OpenGL.
+    /// (Cached uniform values are kept, since they are stored in the program objects)
+    void Invalidate()
+    {
+        program = INVALID;
+        InvalidateBindings();
+    }
+
+    /// Forget the cached VAO and texture bindings only - e.g. after uploading a mesh or texture, which binds it but
+    /// does not change the program in use.
+    void InvalidateBindings()
+    {
+        vao = INVALID;
+        activeTextureUnit = INVALID;
+        for(unsigned unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+        {
+            textures[unit] = INVALID;
+            cubemaps[unit] = INVALID;
+        }
+    }
+
+    /// Forget all cached uniform values of the given program (e.g. because it was relinked).
+    void InvalidateUniforms(GLuint program)
+    {
+        for(auto uniformIt = uniforms.begin(); uniformIt != uniforms.end();)
+        {
+            if(GLuint(uniformIt->first >> 32) == program)
+            {
+                uniformIt = uniforms.erase(uniformIt);
+            }
+            else
+            {
+                ++uniformIt;
+            }
+        }
+    }
+
+    inline void UseProgram(GLuint newProgram)
+    {
+        if(program != newProgram)
+        {
+            glUseProgram(newProgram);
+            program = newProgram;
+        }
+    }
+
+    inline void BindVertexArray(GLuint newVao)
+    {
+        if(vao != newVao)
+        {
+            glBindVertexArray(newVao);
+            vao = newVao;
+        }
+    }
+
+    /// Binds `texture` to GL_TEXTURE_2D of the given texture unit.
+    inline void BindTexture(unsigned unit, GLuint texture)
+    {
+        Bind(GL_TEXTURE_2D, textures, unit, texture);
+    }
+
+    /// Binds `texture` to GL_TEXTURE_CUBE_MAP of the given texture unit.
+    inline void BindCubemap(unsigned unit, GLuint texture)
+    {
+        Bind(GL_TEXTURE_CUBE_MAP, cubemaps, unit, texture);
+    }
+
+    /// Returns true if the uniform at `location` of the current program does not hold the `size` bytes at `value` (and
+    /// stores them as its new value, i.e. assumes the caller then sets it); returns false if it would be a redundant
+    /// `glUniform*()`.
+    inline bool UniformChanged(GLint location, const void *value, size_t size)
+    {
+        if(size > sizeof(UniformValue::bytes) || program == INVALID)
+        {
+            return true; // (Too big to cache, or not known which program it is set to - see `UseProgram()`)
+        }
+
+        auto &cached = uniforms[(uint64_t(program) << 32) | uint32_t(location)];
+        if(cached.size == size && std::memcmp(cached.bytes, value, size) == 0)
+        {
+            return false;
+        }
+        cached.size = size;
+        std::memcpy(cached.bytes, value, size);
+        return true;
+    }
+
+    template <typename T>
+    inline bool UniformChanged(GLint location, const T &value)
+    {
+        return UniformChanged(location, &value, sizeof(T));
+    }
+
+private:
+    static constexpr GLuint INVALID = GLuint(-1);
+
+    struct UniformValue
+    {
+        size_t size{0};
+        unsigned char bytes[sizeof(float) * 16]; // (Big enough for a mat4)
+    };
+
+    GLuint program;
+    GLuint vao;
+    GLuint activeTextureUnit;
+    GLuint textures[MAX_TEXTURE_UNITS]; ///< GL_TEXTURE_2D of each unit
+    GLuint cubemaps[MAX_TEXTURE_UNITS]; ///< GL_TEXTURE_CUBE_MAP of each unit
+    std::unordered_map<uint64_t, UniformValue> uniforms; ///< (program << 32 | location) -> last value set
+
+    /// Binds `texture` to `target` of the given texture unit, given the cached bindings of `target`.
+    inline void Bind(GLenum target, GLuint *cache, unsigned unit, GLuint texture)
+    {
+        if(unit >= MAX_TEXTURE_UNITS)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(target, texture);
+            activeTextureUnit = unit;
+            return;
+        }
+        if(cache[unit] != texture)
+        {
+            if(activeTextureUnit != unit)
+            {
+                glActiveTexture(GL_TEXTURE0 + unit);
+                activeTextureUnit = unit;
+            }
+            glBindTexture(target, texture);
+            cache[unit] = texture;
+        }
+    }
+};
+
+} // namespace gl3
+} // namespace boyd
@@ -1,6 +1,8 @@
 #include "Gfx.hh"
 
+#include <algorithm>
 #include <entt/entt.hpp>
+#include <limits>
 
 #include "../../Components/Camera.hh"
 #include "../../Components/Material.hh"
@@ -68,118 +70,531 @@ bool BoydGfxState::InitContext()
     return true;
 }
 
-gl3::SharedTexture BoydGfxState::MapGpuTexture(const comp::Texture &texture)
+void BoydGfxState::ReloadPipeline()
 {
-    auto gpuTextureIt = textureMap.find(texture.data);
-    bool needsUploading = false;
-    if(gpuTextureIt == textureMap.end())
+    // Cached uniforms and compiled materials refer to programs by their GL name, which could be reused for new programs
+    // once the old ones are deleted: forget all of those that refer to the old programs, or to the new ones
+    if(pipeline)
     {
-        // Texture is not on GPU -> Add a entry for it and mark it as to be uploaded (current version from RAM to VRAM!)
-        gpuTextureIt = textureMap.emplace(texture.data, std::make_pair(gl3::SharedTexture{0}, texture.data.Version())).first;
-        needsUploading = true;
+        for(auto &stage : *pipeline)
+        {
+            stateCache.InvalidateUniforms(stage.program);
+        }
     }
-    else if(gpuTextureIt->second.second < texture.data.Version())
+    pipeline.reset();
+    pipeline = std::make_unique<gl3::Pipeline>();
+    for(auto &stage : *pipeline)
+    {
+        stateCache.InvalidateUniforms(stage.program);
+    }
+    compiledMaterials.clear();
+    stateCache.Invalidate();
+}
+
+/// Returns the number of bytes of VRAM that the given texture takes.
+static size_t TextureVramSize(const comp::Texture::Data &data)
+{
+    size_t size = data.LevelOffset(data.levels); // (All levels in RAM are uploaded as they are)
+    if(data.levels == 1 && !comp::Texture::IsCompressed(data.format)
+       && (data.minFilter == comp::Texture::Trilinear || data.minFilter == comp::Texture::Anisotropic))
+    {
+        size += size / 3; // (Mipmaps generated by the GPU)
+    }
+    return size;
+}
+
+/// Returns the number of bytes of VRAM that the given skybox's cube maps take.
+static size_t SkyboxVramSize(const comp::Skybox::Data &data)
+{
+    size_t size = 0;
+    for(const auto *cubemap : {&data.environment, &data.irradiance, &data.specular})
     {
-        // Texture on GPU is outdated -> Need to upload the modifications
-        needsUploading = true;
+        for(const auto &face : cubemap->faces)
+        {
+            size += TextureVramSize(face);
+        }
     }
+    return size;
+}
 
-    if(needsUploading)
+gl3::SharedTexture BoydGfxState::MapGpuTexture(const comp::Texture &texture)
+{
+    auto &entry = MapTextureEntry(texture);
+    entry.lastUsed = frameIndex;
+
+    // NOTE: New entries have `version = 0`, so they are always uploaded (current version from RAM to VRAM!)
+    if(entry.version < texture.data.Version())
     {
-        bool uploadOk = gl3::UploadTexture(texture, gpuTextureIt->second.first);
+        // Texture is not on GPU (or was evicted) or the texture on GPU is outdated -> Need to upload it
+        unsigned version = texture.data.Version();
+        bool uploadOk = gl3::UploadTexture(texture, entry.gpuTexture);
+        stateCache.InvalidateBindings(); // (Uploading changes the texture bindings)
         if(!uploadOk)
         {
             BOYD_LOG(Warn, "Failed to upload texture to GPU");
             return gl3::SharedTexture{0};
         }
+        entry.version = version;
+
+        vramUsed -= entry.vramSize;
+        entry.vramSize = TextureVramSize(*texture.data);
+        vramUsed += entry.vramSize;
     }
 
-    return gpuTextureIt->second.first;
+    return entry.gpuTexture;
 }
 
-gl3::SharedMesh BoydGfxState::MapGpuMesh(const comp::Mesh &mesh)
+bool BoydGfxState::MapGpuSkybox(const comp::Skybox &newSkybox)
 {
-    auto gpuMeshIt = meshMap.find(mesh.data);
-    bool needsUploading = false;
-    if(gpuMeshIt == meshMap.end())
+    if(skybox.source.Refers(newSkybox.data) && skybox.version >= newSkybox.data.Version())
     {
-        // Mesh is not on GPU -> Add a entry for it and mark it as to be uploaded (current version from RAM to VRAM!)
-        gpuMeshIt = meshMap.emplace(mesh.data, std::make_pair(gl3::SharedMesh{}, mesh.data.Version())).first;
-        needsUploading = true;
+        return skybox.environment != 0;
     }
-    else if(gpuMeshIt->second.second < mesh.data.Version())
+
+    // New skybox, or the current one changed -> Need to (re)upload it
+    const unsigned version = newSkybox.data.Version();
+    const auto &data = *newSkybox.data;
+    bool uploadOk = gl3::UploadCubemap(data.environment, skybox.environment);
+    uploadOk = uploadOk && gl3::UploadCubemap(data.irradiance, skybox.irradiance);
+    uploadOk = uploadOk && gl3::UploadCubemap(data.specular, skybox.specular);
+    stateCache.InvalidateBindings(); // (Uploading changes the texture bindings)
+
+    skybox.source = newSkybox.data;
+    skybox.version = version;
+    vramUsed -= skybox.vramSize;
+    if(!uploadOk)
     {
-        // Mesh on GPU is outdated -> Need to upload the modifications
-        needsUploading = true;
+        BOYD_LOG(Warn, "Failed to upload skybox to GPU");
+        skybox.environment = gl3::SharedTexture{0};
+        skybox.vramSize = 0;
+        return false;
     }
+    // (Counts towards `vramBudget`, but is never evicted: the skybox is used every frame)
+    skybox.vramSize = SkyboxVramSize(data);
+    vramUsed += skybox.vramSize;
+    return true;
+}
+
+gl3::SharedMesh BoydGfxState::MapGpuMesh(const comp::Mesh &mesh)
+{
+    auto &entry = MapMeshEntry(mesh);
+    entry.lastUsed = frameIndex;
 
-    if(needsUploading)
+    // NOTE: New entries have `version = 0`, so they are always uploaded (current version from RAM to VRAM!)
+    if(entry.version < mesh.data.Version())
     {
-        bool uploadOk = gl3::UploadMesh(mesh, gpuMeshIt->second.first);
+        // Mesh is not on GPU (or was evicted) or the mesh on GPU is outdated -> Need to upload it
+        unsigned version = mesh.data.Version();
+        bool uploadOk = gl3::UploadMesh(mesh, entry.gpuMesh, entry.version);
+        stateCache.InvalidateBindings(); // (Uploading changes the VAO binding)
         if(!uploadOk)
         {
             BOYD_LOG(Warn, "Failed to upload mesh to GPU");
             return gl3::SharedMesh{};
         }
+        entry.version = version;
+
+        // The GPU is up to date: track the changes from scratch (without bumping the version - nothing changed)
+        auto data = mesh.data;
+        auto clearDirty = [](comp::Mesh::Data *data) {
+            data->dirtyVertices = data->dirtyIndices = comp::Mesh::Range{0, 0};
+            return false;
+        };
+        data.Edit(clearDirty);
+
+        vramUsed -= entry.vramSize;
+        entry.vramSize = entry.gpuMesh.vboCapacity + entry.gpuMesh.iboCapacity;
+        vramUsed += entry.vramSize;
     }
 
-    return gpuMeshIt->second.first;
+    return entry.gpuMesh;
 }
 
-unsigned BoydGfxState::ApplyMaterialParams(const comp::Material &material, gl3::SharedProgram &program)
+/// Gets the entry for `data` in `map` - creating it if there isn't one, or if the one there was for some other data
+/// that used to be at the same address (and is gone now).
+template <typename TMap, typename TData>
+static typename TMap::mapped_type &MapEntry(TMap &map, std::vector<const TData *> &young, const Versioned<TData> &data,
+                                            unsigned long frameIndex, size_t &vramUsed)
 {
-    std::string uniformName;
-    unsigned nTexturesApplied = 0;
+    auto entryIt = map.find(data.Get());
+    if(entryIt != map.end() && !entryIt->second.source.Refers(data))
+    {
+        vramUsed -= entryIt->second.vramSize;
+        map.erase(entryIt);
+        entryIt = map.end();
+    }
+    if(entryIt == map.end())
+    {
+        entryIt = map.emplace(data.Get(), typename TMap::mapped_type{}).first;
+        entryIt->second.source = data;
+        entryIt->second.created = frameIndex;
+        young.push_back(data.Get());
+    }
+    return entryIt->second;
+}
+
+GpuMeshEntry &BoydGfxState::MapMeshEntry(const comp::Mesh &mesh)
+{
+    return MapEntry(meshMap, youngMeshes, mesh.data, frameIndex, vramUsed);
+}
+
+GpuTextureEntry &BoydGfxState::MapTextureEntry(const comp::Texture &texture)
+{
+    return MapEntry(textureMap, youngTextures, texture.data, frameIndex, vramUsed);
+}
 
-    for(const auto &param : material.parameters)
+const MeshBounds &BoydGfxState::MapMeshBounds(const comp::Mesh &mesh)
+{
+    auto &entry = MapMeshEntry(mesh);
+    if(entry.boundsVersion < mesh.data.Version())
     {
-        uniformName = fmt::format(FMT_STRING("u_{}"), param.first);
-        GLint uniformLoc = program.uniformLocation(uniformName);
-        if(uniformLoc < 0)
-        {
-            continue;
-        }
+        entry.boundsVersion = mesh.data.Version();
+        entry.bounds = MeshBounds::Compute(*mesh.data);
+    }
+    return entry.bounds;
+}
+
+const gl3::CompiledMaterial &BoydGfxState::MapCompiledMaterial(const comp::Material &material,
+                                                               gl3::SharedProgram &program)
+{
+    CompiledMaterialKey key{material.data.Get(), GLuint(program)};
+    auto compiledIt = compiledMaterials.find(key);
+    if(compiledIt == compiledMaterials.end())
+    {
+        compiledIt = compiledMaterials.emplace(key, gl3::CompileMaterial(material, program)).first;
+    }
+    else if(!compiledIt->second.source.Refers(material.data)
+            || compiledIt->second.version != material.data.Version())
+    {
+        // (Edited since it was compiled, or a new material allocated where an old, destroyed one was)
+        compiledIt->second = gl3::CompileMaterial(material, program);
+    }
+    compiledIt->second.lastUsed = frameIndex;
+    return compiledIt->second;
+}
 
-        switch(param.second.index())
+unsigned BoydGfxState::ApplyMaterialParams(const gl3::CompiledMaterial &material)
+{
+    for(const auto &uniform : material.uniforms)
+    {
+        const float *value = &material.values[uniform.offset];
+        switch(uniform.type)
         {
         case 0: // float
-            glUniform1f(uniformLoc, std::get<float>(param.second));
+            if(stateCache.UniformChanged(uniform.location, value, sizeof(float)))
+            {
+                glUniform1fv(uniform.location, 1, value);
+            }
             break;
         case 1: // glm::vec2
-            glUniform2fv(uniformLoc, 1, &std::get<glm::vec2>(param.second)[0]);
+            if(stateCache.UniformChanged(uniform.location, value, sizeof(glm::vec2)))
+            {
+                glUniform2fv(uniform.location, 1, value);
+            }
             break;
         case 2: // glm::vec3
-            glUniform3fv(uniformLoc, 1, &std::get<glm::vec3>(param.second)[0]);
+            if(stateCache.UniformChanged(uniform.location, value, sizeof(glm::vec3)))
+            {
+                glUniform3fv(uniform.location, 1, value);
+            }
             break;
         case 3: // glm::vec4
-            glUniform4fv(uniformLoc, 1, &std::get<glm::vec4>(param.second)[0]);
+            if(stateCache.UniformChanged(uniform.location, value, sizeof(glm::vec4)))
+            {
+                glUniform4fv(uniform.location, 1, value);
+            }
             break;
         case 4: // glm::mat3
-            glUniformMatrix3fv(uniformLoc, 1, false, &std::get<glm::mat3>(param.second)[0][0]);
+            if(stateCache.UniformChanged(uniform.location, value, sizeof(glm::mat3)))
+            {
+                glUniformMatrix3fv(uniform.location, 1, false, value);
+            }
             break;
         case 5: // glm::mat4
-            glUniformMatrix4fv(uniformLoc, 1, false, &std::get<glm::mat4>(param.second)[0][0]);
+            if(stateCache.UniformChanged(uniform.location, value, sizeof(glm::mat4)))
+            {
+                glUniformMatrix4fv(uniform.location, 1, false, value);
+            }
             break;
-        case 6: // comp::Texture
-        {
-            auto gpuTexture = MapGpuTexture(*std::get_if<comp::Texture>(&param.second));
-            glActiveTexture(GL_TEXTURE0 + nTexturesApplied);
-            glBindTexture(GL_TEXTURE_2D, gpuTexture); // TODO: support non-2D textures?
-
-            glUniform1i(uniformLoc, nTexturesApplied); // Bind sampler to texture unit
-
-            nTexturesApplied++;
-        }
-        break;
         default:
             // *X-Files main theme*
             break;
         }
     }
 
+    unsigned nTexturesApplied = 0;
+    for(const auto &sampler : material.samplers)
+    {
+        auto gpuTexture = MapGpuTexture(sampler.texture);
+        stateCache.BindTexture(nTexturesApplied, gpuTexture); // TODO: support non-2D textures?
+
+        GLint textureUnit = GLint(nTexturesApplied);
+        if(stateCache.UniformChanged(sampler.location, textureUnit))
+        {
+            glUniform1i(sampler.location, textureUnit); // Bind sampler to texture unit
+        }
+
+        nTexturesApplied++;
+    }
+
     return nTexturesApplied;
 }
 
+void BoydGfxState::CollectCompiledMaterials()
+{
+    // NOTE: Allow for some slack, so that materials that are only culled for a few frames are not recompiled all the
+    //       time - but do collect them every once in a while, as they keep their textures alive
+    if(compiledMaterials.size() <= 2 * nBatches + 64 && frameIndex % GC_OLD_INTERVAL != 0)
+    {
+        return;
+    }
+
+    for(auto compiledIt = compiledMaterials.begin(); compiledIt != compiledMaterials.end();)
+    {
+        if(compiledIt->second.lastUsed != frameIndex)
+        {
+            compiledIt = compiledMaterials.erase(compiledIt);
+        }
+        else
+        {
+            ++compiledIt;
+        }
+    }
+}
+
+void BoydGfxState::GatherBatches(entt::registry &ecs, const glm::mat4 &viewProjectionMtx)
+{
+    const Frustum frustum{viewProjectionMtx};
+    const glm::vec4 depthRow = glm::row(viewProjectionMtx, 2); // (Clip-space Z of a point = dot(depthRow, point))
+
+    const size_t nLastBatches = nBatches;
+    for(size_t iBatch = 0; iBatch < nLastBatches; iBatch++)
+    {
+        batches[iBatch].transforms.clear();
+    }
+    nBatches = 0;
+    batchIndices.clear();
+    stats = {};
+
+    auto boundsOf = [this](const comp::Mesh &mesh) -> const MeshBounds & {
+        return MapMeshBounds(mesh);
+    };
+    auto addToBatch = [&](const comp::Transform &transform, const comp::Mesh &mesh, const comp::Material &material,
+                          const BoundingSphere &sphere) {
+        RenderBatchKey key{mesh.data.Get(), material.data.Get()};
+        auto batchIt = batchIndices.find(key);
+        if(batchIt == batchIndices.end())
+        {
+            // First entity with this mesh + material this frame -> new batch
+            if(nBatches == batches.size())
+            {
+                batches.emplace_back();
+            }
+            batches[nBatches].mesh = &mesh;
+            batches[nBatches].material = &material;
+            batches[nBatches].depth = std::numeric_limits<float>::infinity();
+            batchIt = batchIndices.emplace(key, nBatches).first;
+            nBatches++;
+        }
+        auto &batch = batches[batchIt->second];
+        batch.transforms.push_back(transform.matrix);
+        batch.depth = std::min(batch.depth, glm::dot(depthRow, glm::vec4(sphere.center, 1.0f)) - sphere.radius);
+    };
+    CullRenderables(ecs, frustum, stats, boundsOf, addToBatch);
+    stats.nBatches = nBatches;
+
+    // Drop what the batches that are not used anymore referenced: their GPU meshes must not be kept alive (they could
+    // be evicted by `EnforceVramBudget()`!), and their mesh and material were pointers into the ECS
+    for(size_t iBatch = nBatches; iBatch < nLastBatches; iBatch++)
+    {
+        batches[iBatch].mesh = nullptr;
+        batches[iBatch].material = nullptr;
+        batches[iBatch].gpuMesh = gl3::SharedMesh{};
+    }
+}
+
+void BoydGfxState::SortBatches(const gl3::SharedProgram &program)
+{
+    renderQueue.Clear();
+    textureSetIds.clear();
+
+    for(size_t iBatch = 0; iBatch < nBatches; iBatch++)
+    {
+        auto &batch = batches[iBatch];
+
+        // NOTE: Map all meshes now, so that no uploads happen in-between drawcalls
+        batch.gpuMesh = MapGpuMesh(*batch.mesh);
+
+        // Materials with the same textures in the same slots get the same texture set id, regardless of their other
+        // parameters. (Each texture is hashed together with its slot - so that swapping two textures makes another
+        // set -, then the slots are summed up, as the parameters come in no particular order)
+        size_t textureSetHash = 0;
+        for(const auto &param : batch.material->data->parameters)
+        {
+            if(const auto *texture = std::get_if<comp::Texture>(&param.second))
+            {
+                const size_t textureHash = std::hash<Versioned<comp::Texture::Data>>{}(texture->data);
+                textureSetHash += std::hash<std::string>{}(param.first) ^ (textureHash * 0x9E3779B97F4A7C15ull);
+            }
+        }
+        uint32_t textureSetId = textureSetIds.emplace(textureSetHash, uint32_t(textureSetIds.size())).first->second;
+
+        renderQueue.Push(RenderQueue::MakeKey(program, textureSetId, batch.gpuMesh.vao, batch.depth), uint32_t(iBatch));
+    }
+    renderQueue.Sort();
+
+    stats.nTextureSets = textureSetIds.size();
+}
+
+void BoydGfxState::UploadInstanceTransforms()
+{
+    instanceTransforms.clear();
+    for(size_t iBatch = 0; iBatch < nBatches; iBatch++)
+    {
+        auto &batch = batches[iBatch];
+        batch.firstInstance = instanceTransforms.size();
+        instanceTransforms.insert(instanceTransforms.end(), batch.transforms.begin(), batch.transforms.end());
+    }
+
+    if(instanceBuffer == 0)
+    {
+        instanceBuffer = gl3::SharedBuffer{};
+        instanceBufferCapacity = 0;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    if(instanceTransforms.size() > instanceBufferCapacity)
+    {
+        // Grow geometrically to avoid reallocating every time a few more instances get added
+        instanceBufferCapacity = std::max(instanceTransforms.size(), instanceBufferCapacity * 2);
+    }
+    // NOTE: Orphan the buffer before writing to it, so that the driver does not have to wait on the last frame's draws
+    glBufferData(GL_ARRAY_BUFFER, instanceBufferCapacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instanceTransforms.size() * sizeof(glm::mat4), instanceTransforms.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/// Removes the entries of `map` whose data is gone - checking only the `young` entries, or all of them if
+/// `collectOld`. Entries get out of `young` when older than `youngAge` frames.
+/// Returns the number of entries removed.
+template <typename TMap, typename TData>
+static size_t CollectGarbageIn(TMap &map, std::vector<const TData *> &young, unsigned long frameIndex,
+                               unsigned long youngAge, bool collectOld, size_t &vramUsed)
+{
+    size_t nCollected = 0;
+
+    for(size_t i = 0; i < young.size();)
+    {
+        auto entryIt = map.find(young[i]);
+        bool isGone = entryIt == map.end() || entryIt->second.created + youngAge <= frameIndex;
+        if(!isGone && entryIt->second.source.Expired())
+        {
+            vramUsed -= entryIt->second.vramSize;
+            map.erase(entryIt);
+            nCollected++;
+            isGone = true;
+        }
+        if(isGone)
+        {
+            young[i] = young.back();
+            young.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    if(collectOld)
+    {
+        for(auto entryIt = map.begin(); entryIt != map.end();)
+        {
+            if(entryIt->second.source.Expired())
+            {
+                vramUsed -= entryIt->second.vramSize;
+                entryIt = map.erase(entryIt);
+                nCollected++;
+            }
+            else
+            {
+                ++entryIt;
+            }
+        }
+    }
+    return nCollected;
+}
+
+void BoydGfxState::CollectGarbage()
+{
+    // NOTE: Compiled materials hold references to textures too
+    CollectCompiledMaterials();
+
+    bool collectOld = frameIndex % GC_OLD_INTERVAL == 0;
+    size_t nMeshes = CollectGarbageIn(meshMap, youngMeshes, frameIndex, GC_YOUNG_AGE, collectOld, vramUsed);
+    size_t nTextures = CollectGarbageIn(textureMap, youngTextures, frameIndex, GC_YOUNG_AGE, collectOld, vramUsed);
+    if(nMeshes > 0 || nTextures > 0)
+    {
+        BOYD_LOG(Debug, "Removed {} unused meshes and {} unused textures from the GPU ({} KiB of VRAM in use)",
+                 nMeshes, nTextures, vramUsed / 1024);
+    }
+}
+
+void BoydGfxState::EnforceVramBudget()
+{
+    if(vramBudget == 0 || vramUsed <= vramBudget)
+    {
+        return;
+    }
+
+    struct Candidate
+    {
+        unsigned long lastUsed;
+        GpuMeshEntry *mesh;
+        GpuTextureEntry *texture;
+    };
+    std::vector<Candidate> candidates;
+    for(auto &entry : meshMap)
+    {
+        if(entry.second.vramSize > 0 && entry.second.lastUsed < frameIndex)
+        {
+            candidates.push_back({entry.second.lastUsed, &entry.second, nullptr});
+        }
+    }
+    for(auto &entry : textureMap)
+    {
+        if(entry.second.vramSize > 0 && entry.second.lastUsed < frameIndex)
+        {
+            candidates.push_back({entry.second.lastUsed, nullptr, &entry.second});
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &lhs, const Candidate &rhs) {
+        return lhs.lastUsed < rhs.lastUsed;
+    });
+
+    size_t nEvicted = 0;
+    for(size_t i = 0; i < candidates.size() && vramUsed > vramBudget; i++, nEvicted++)
+    {
+        // Drop the GPU resources, but keep the entry around; `version = 0` makes it be re-uploaded on next use
+        if(candidates[i].mesh)
+        {
+            vramUsed -= candidates[i].mesh->vramSize;
+            candidates[i].mesh->gpuMesh = gl3::SharedMesh{};
+            candidates[i].mesh->version = 0;
+            candidates[i].mesh->vramSize = 0;
+        }
+        else
+        {
+            vramUsed -= candidates[i].texture->vramSize;
+            candidates[i].texture->gpuTexture = gl3::SharedTexture{0};
+            candidates[i].texture->version = 0;
+            candidates[i].texture->vramSize = 0;
+        }
+    }
+
+    BOYD_LOG(Debug, "Evicted {} meshes/textures from VRAM to fit the budget ({} KiB used, {} KiB budget)",
+             nEvicted, vramUsed / 1024, vramBudget / 1024);
+}
+
 void BoydGfxState::Update()
 {
     auto *gameState = Boyd_GameState();
@@ -243,35 +658,89 @@ void BoydGfxState::Update()
         glEnable(GL_DEPTH_TEST);
         auto &stage = pipeline->stages[gl3::Pipeline::Forward];
 
-        glUseProgram(stage.program);
+        stateCache.Invalidate(); // (Anything could have happened to the GL state since the last frame)
+        stateCache.UseProgram(stage.program);
+        GLint viewProjectionLoc = stage.program.uniformLocation("u_ViewProjection");
+        if(stateCache.UniformChanged(viewProjectionLoc, viewProjectionMtx))
+        {
+            glUniformMatrix4fv(viewProjectionLoc, 1, false, &viewProjectionMtx[0][0]);
+        }
+
+        GLint octahedralNormalsLoc = stage.program.uniformLocation("u_OctahedralNormals");
+
+        GatherBatches(gameState->ecs, viewProjectionMtx);
+        SortBatches(stage.program);
+        UploadInstanceTransforms();
 
         unsigned nTextures = 0; // Number of textures bound the previous drawcall
-        gameState->ecs.view<comp::Transform, comp::Mesh, comp::Material>()
-            .each([&](auto entity, const comp::Transform &transform, const comp::Mesh &mesh, const comp::Material &material) {
-                const auto gpuMesh = MapGpuMesh(mesh);
-
-                // Apply uniforms + bind the textures needed for this drawcall
-                // (uploads textures to VRAM if they weren't already there)
-                unsigned nTexturesNow = ApplyMaterialParams(material, stage.program);
-
-                glm::mat4 mvpMtx = viewProjectionMtx * transform.matrix;
-                glUniformMatrix4fv(stage.program.uniformLocation("u_ModelViewProjection"), 1, false, &mvpMtx[0][0]);
-
-                // Unbind all textures that would be unused this drawcall
-                for(unsigned i = nTextures; i > nTexturesNow; i--)
-                {
-                    glActiveTexture(GL_TEXTURE0 + i - 1);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                }
-                nTextures = nTexturesNow;
-
-                // Bind VBO+IBO and render
-                glBindVertexArray(gpuMesh.vao);
-                glDrawElements(GL_TRIANGLES, mesh.data->indices.size(), GL_UNSIGNED_INT, nullptr);
-            });
-
-        glBindVertexArray(0);
-        glUseProgram(0);
+        for(const auto &item : renderQueue.Items())
+        {
+            const auto &batch = batches[item.index];
+            if(batch.gpuMesh.vao == 0)
+            {
+                continue; // (Failed to upload)
+            }
+
+            // Apply uniforms + bind the textures needed for this drawcall
+            // (uploads textures to VRAM if they weren't already there)
+            const auto &material = MapCompiledMaterial(*batch.material, stage.program);
+            unsigned nTexturesNow = ApplyMaterialParams(material);
+
+            // Unbind all textures that would be unused this drawcall
+            for(unsigned i = nTextures; i > nTexturesNow; i--)
+            {
+                stateCache.BindTexture(i - 1, 0);
+            }
+            nTextures = nTexturesNow;
+
+            GLint octahedralNormals = batch.gpuMesh.layout.normal == comp::Mesh::Layout::NormalOct16;
+            if(octahedralNormalsLoc >= 0 && stateCache.UniformChanged(octahedralNormalsLoc, octahedralNormals))
+            {
+                glUniform1i(octahedralNormalsLoc, octahedralNormals);
+            }
+
+            // Bind VBO+IBO+instance transforms and render
+            stateCache.BindVertexArray(batch.gpuMesh.vao);
+            gl3::BindInstanceTransforms(instanceBuffer, batch.firstInstance);
+            glDrawElementsInstanced(GL_TRIANGLES, batch.mesh->data->indices.size(), batch.gpuMesh.indexType, nullptr,
+                                    batch.transforms.size());
+        }
+
+        // -------------------------------------------------------------------------------------------------------------
+        // Skybox pass: fill in the background, i.e. wherever the forward pass did not draw anything
+        // -------------------------------------------------------------------------------------------------------------
+        auto skyboxView = gameState->ecs.view<comp::Skybox>();
+        if(!skyboxView.empty() && MapGpuSkybox(gameState->ecs.get<comp::Skybox>(*skyboxView.begin())))
+        {
+            auto &skyboxStage = pipeline->stages[gl3::Pipeline::Skybox];
+            stateCache.UseProgram(skyboxStage.program);
+
+            // Only the rotation of the camera matters, as the sky is infinitely far away
+            glm::mat4 invViewProjectionMtx = glm::inverse(projMtx * glm::mat4{glm::mat3{viewMtx}});
+            GLint invViewProjectionLoc = skyboxStage.program.uniformLocation("u_InvViewProjection");
+            if(stateCache.UniformChanged(invViewProjectionLoc, invViewProjectionMtx))
+            {
+                glUniformMatrix4fv(invViewProjectionLoc, 1, false, &invViewProjectionMtx[0][0]);
+            }
+            GLint environmentMapLoc = skyboxStage.program.uniformLocation("u_EnvironmentMap");
+            GLint environmentMapUnit = 0;
+            if(stateCache.UniformChanged(environmentMapLoc, environmentMapUnit))
+            {
+                glUniform1i(environmentMapLoc, environmentMapUnit);
+            }
+            stateCache.BindCubemap(GLuint(environmentMapUnit), skybox.environment);
+
+            // The skybox is drawn on the far plane, i.e. at the depth the depth buffer was cleared to
+            glDepthFunc(GL_LEQUAL);
+            glDepthMask(GL_FALSE);
+            stateCache.BindVertexArray(pipeline->emptyVao);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glDepthMask(GL_TRUE);
+            glDepthFunc(GL_LESS);
+        }
+
+        stateCache.BindVertexArray(0);
+        stateCache.UseProgram(0);
         glDisable(GL_DEPTH_TEST);
     }
     // else: Hard to render anything without a camera...
@@ -280,6 +749,10 @@ void BoydGfxState::Update()
 
     glfwSwapBuffers(window);
 
+    CollectGarbage();
+    EnforceVramBudget();
+    frameIndex++;
+
     // Poll input at end of frame to minimize delay between the Gfx system running (that should be the last one in the sequence)
     // and the next frame
     UpdateInput(this);
@@ -1,15 +1,21 @@
 #pragma once
 
+#include <BoydEngine.hh>
 #include <entt/entt.hpp>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
+#include "Culling.hh"
 #include "GL3/GL3.hh"
 #include "GL3/GL3Pipeline.hh"
+#include "GL3/GL3State.hh"
 #include "Glfw.hh"
+#include "RenderQueue.hh"
 
 #include "../../Components/Material.hh"
 #include "../../Components/Mesh.hh"
+#include "../../Components/Skybox.hh"
 #include "../../Components/Texture.hh"
 #include "../../Core/Utils.hh"
 #include "../../Debug/Log.hh"
@@ -17,6 +23,93 @@
 namespace boyd
 {
 
+/// A group of entities that share the same mesh data and material data.
+/// All of them are rendered with a single instanced drawcall.
+struct RenderBatch
+{
+    const comp::Mesh *mesh;             ///< The mesh shared by all entities in the batch
+    const comp::Material *material;     ///< The material shared by all entities in the batch
+    std::vector<glm::mat4> transforms;  ///< The model matrix of each entity (= instance)
+    size_t firstInstance;               ///< Index of `transforms[0]` in the instance buffer
+    float depth;                        ///< Clip-space depth of the instance nearest to the camera
+    gl3::SharedMesh gpuMesh;            ///< The GPU counterpart of `mesh` (see `BoydGfxState::SortBatches()`)
+};
+
+/// Identifies a `RenderBatch` given a <mesh data, material data> pair.
+struct RenderBatchKey
+{
+    const comp::Mesh::Data *meshData;
+    const comp::Material::Data *materialData;
+
+    inline bool operator==(const RenderBatchKey &other) const
+    {
+        return meshData == other.meshData && materialData == other.materialData;
+    }
+};
+
+struct RenderBatchKeyHasher
+{
+    inline size_t operator()(const RenderBatchKey &key) const
+    {
+        return std::hash<const void *>{}(key.meshData) ^ (std::hash<const void *>{}(key.materialData) * 31);
+    }
+};
+
+/// Identifies a `gl3::CompiledMaterial` given a <material data, program> pair.
+struct CompiledMaterialKey
+{
+    const comp::Material::Data *materialData;
+    GLuint program;
+
+    inline bool operator==(const CompiledMaterialKey &other) const
+    {
+        return materialData == other.materialData && program == other.program;
+    }
+};
+
+struct CompiledMaterialKeyHasher
+{
+    inline size_t operator()(const CompiledMaterialKey &key) const
+    {
+        return std::hash<const void *>{}(key.materialData) ^ (size_t(key.program) * 0x9E3779B97F4A7C15ull);
+    }
+};
+
+/// A mesh on VRAM, as mapped by `BoydGfxState::meshMap`.
+struct GpuMeshEntry
+{
+    Versioned<comp::Mesh::Data>::Weak source; ///< The mesh data in RAM (not kept alive by this!)
+    gl3::SharedMesh gpuMesh;     ///< The mesh on the GPU (may not have been uploaded yet, or evicted)
+    unsigned version{0};         ///< Version of `Mesh::Data` last uploaded to `gpuMesh` (0 = never)
+    MeshBounds bounds;           ///< Model-space bounding volumes of the mesh
+    unsigned boundsVersion{0};   ///< Version of `Mesh::Data` that `bounds` were computed from (0 = never)
+    size_t vramSize{0};          ///< Bytes of VRAM taken by `gpuMesh`
+    unsigned long created{0};    ///< Frame in which the entry was created
+    unsigned long lastUsed{0};   ///< Last frame in which `gpuMesh` was used
+};
+
+/// A texture on VRAM, as mapped by `BoydGfxState::textureMap`.
+struct GpuTextureEntry
+{
+    Versioned<comp::Texture::Data>::Weak source; ///< The texture data in RAM (not kept alive by this!)
+    gl3::SharedTexture gpuTexture{0}; ///< The texture on the GPU (may not have been uploaded yet, or evicted)
+    unsigned version{0};              ///< Version of `Texture::Data` last uploaded to `gpuTexture` (0 = never)
+    size_t vramSize{0};               ///< Bytes of VRAM taken by `gpuTexture`
+    unsigned long created{0};         ///< Frame in which the entry was created
+    unsigned long lastUsed{0};        ///< Last frame in which `gpuTexture` was used
+};
+
+/// The cube maps of a skybox on VRAM, see `BoydGfxState::MapGpuSkybox()`.
+struct GpuSkyboxEntry
+{
+    Versioned<comp::Skybox::Data>::Weak source; ///< The skybox data in RAM (not kept alive by this!)
+    unsigned version{0};                        ///< Version of `Skybox::Data` last uploaded (0 = never)
+    gl3::SharedTexture environment{0};          ///< The cube maps on the GPU, one per `Skybox::Data` cube map
+    gl3::SharedTexture irradiance{0};
+    gl3::SharedTexture specular{0};
+    size_t vramSize{0}; ///< Bytes of VRAM taken by all cube maps
+};
+
 struct BoydGfxState
 {
     GLFWwindow *window;
@@ -24,13 +117,54 @@ struct BoydGfxState
     /// The whole rendering pipeline.
     std::unique_ptr<gl3::Pipeline> pipeline;
 
-    /// Maps all mesh data to its respective OpenGL conterpart (= a <SharedMesh, version of Mesh::Data last stored> pair)
+    /// Maps all mesh data to its respective OpenGL conterpart (+ its bounds, see `GpuMeshEntry`)
     /// (This is so implicit sharing for mesh data works seamlessly: 1 comp::Mesh on RAM -> 1 OpenGL mesh on VRAM)
-    std::unordered_map<Versioned<comp::Mesh::Data>, std::pair<gl3::SharedMesh, unsigned>> meshMap;
+    /// NOTE: Does not keep the mesh data alive; entries whose data is gone are removed by `CollectGarbage()`
+    std::unordered_map<const comp::Mesh::Data *, GpuMeshEntry> meshMap;
 
-    /// Maps all textures to their respective OpenGL counterpart (= a SharedTexture, version of Texture::Data last stored> pair)
+    /// Maps all textures to their respective OpenGL counterpart (see `GpuTextureEntry`)
     /// (This is so implicit sharing for texture data works seamlessly: 1 comp::Texture on RAM -> 1 OpenGL texture on VRAM)
-    std::unordered_map<Versioned<comp::Texture::Data>, std::pair<gl3::SharedTexture, unsigned>> textureMap;
+    /// NOTE: Does not keep the texture data alive; entries whose data is gone are removed by `CollectGarbage()`
+    std::unordered_map<const comp::Texture::Data *, GpuTextureEntry> textureMap;
+
+    /// The entries of `meshMap` and `textureMap` that were created recently, see `CollectGarbage()`.
+    std::vector<const comp::Mesh::Data *> youngMeshes;
+    std::vector<const comp::Texture::Data *> youngTextures;
+
+    /// Bytes of VRAM taken by all meshes and textures in `meshMap` and `textureMap`.
+    size_t vramUsed{0};
+    /// Maximum bytes of VRAM to keep meshes and textures in (0 = unlimited), see `EnforceVramBudget()`.
+    size_t vramBudget{size_t(BOYD_GFX_VRAM_BUDGET_MB) * 1024 * 1024};
+
+    /// The batches to render this frame.
+    /// (Kept between frames - but cleared every frame - to minimize reallocations)
+    std::vector<RenderBatch> batches;
+    size_t nBatches{0};
+    std::unordered_map<RenderBatchKey, size_t, RenderBatchKeyHasher> batchIndices; ///< Maps batches to their index in `batches`
+
+    /// The per-instance model matrices of all batches rendered this frame.
+    gl3::SharedBuffer instanceBuffer{0};
+    size_t instanceBufferCapacity{0}; ///< Number of `glm::mat4`s that fit into `instanceBuffer`
+    std::vector<glm::mat4> instanceTransforms;
+
+    /// The batches to render this frame, sorted to minimize state changes. See `SortBatches()`.
+    RenderQueue renderQueue;
+    std::unordered_map<size_t, uint32_t> textureSetIds; ///< Maps hashes of a material's textures to a texture set id
+
+    /// Materials compiled for a program, by <material data, program>. See `MapCompiledMaterial()`.
+    std::unordered_map<CompiledMaterialKey, gl3::CompiledMaterial, CompiledMaterialKeyHasher> compiledMaterials;
+
+    /// The skybox being rendered (there can only be one at a time).
+    GpuSkyboxEntry skybox;
+
+    /// Used to skip redundant OpenGL state changes while rendering.
+    gl3::StateCache stateCache;
+
+    /// Statistics about the last frame rendered.
+    RenderStats stats;
+
+    /// Number of frames rendered so far.
+    unsigned long frameIndex{0};
 
 public:
     BoydGfxState()
@@ -39,13 +173,17 @@ public:
         {
             return;
         }
-        pipeline = std::make_unique<gl3::Pipeline>();
+        ReloadPipeline();
     }
 
     ~BoydGfxState()
     {
         // Important: destroy all OpenGL data before terminating GLFW!
         meshMap.clear();
+        textureMap.clear();
+        compiledMaterials.clear();
+        skybox = GpuSkyboxEntry{};
+        instanceBuffer = gl3::SharedBuffer{0};
         pipeline.reset();
 
         // Deinit GLFW
@@ -57,18 +195,26 @@ public:
         glfwTerminate();
     }
 
-    /// Remove all meshes from the GPU that have are unused.
-    void CollectGarbage()
-    {
-        // FIXME IMPLEMENT: To do this, need a wait to reference-count the meshes in `meshMap`
-        //                  and kill them only when the reference count is one (i.e., just the pointer in the map)
-        //                  - need to store the `shared_ptr` directly as key?
-    }
+    /// Removes all meshes and textures from the GPU whose data in RAM was destroyed (= is not referenced anymore).
+    ///
+    /// Collection is generational: entries created in the last `GC_YOUNG_AGE` frames are checked every frame, all the
+    /// others only every `GC_OLD_INTERVAL` frames (resources tend to either be dropped soon or live for a long time).
+    void CollectGarbage();
+
+    /// Evicts the least recently used meshes and textures from VRAM until `vramUsed <= vramBudget`.
+    /// Only evicts the ones that were not used this frame; evicted ones are re-uploaded if they get used again.
+    void EnforceVramBudget();
 
     /// Does all necessary steps to poll events and render a frame.
     void Update();
 
+    /// (Re)loads the rendering pipeline, recompiling and relinking all of its shaders from their files.
+    void ReloadPipeline();
+
 private:
+    static constexpr unsigned long GC_YOUNG_AGE = 60;
+    static constexpr unsigned long GC_OLD_INTERVAL = 60;
+
     /// Initialize GLFW and flextGL.
     bool InitContext();
 
@@ -80,12 +226,43 @@ private:
     /// If there isn't any GPU mesh on VRAM - or if it is too old - uploads the mesh data to VRAM and returns the freshly-uploaded GPU mesh.
     gl3::SharedMesh MapGpuMesh(const comp::Mesh &mesh);
 
-    /// Applies all of a material's parameters to `program`.
+    /// Makes `skybox` hold the cube maps of the given skybox, uploading them if they are not there yet (or outdated).
+    /// Returns false if they could not be uploaded.
+    bool MapGpuSkybox(const comp::Skybox &skybox);
+
+    /// Gets the entry in `meshMap` for the given mesh, creating it if there isn't one yet.
+    GpuMeshEntry &MapMeshEntry(const comp::Mesh &mesh);
+
+    /// Gets the entry in `textureMap` for the given texture, creating it if there isn't one yet.
+    GpuTextureEntry &MapTextureEntry(const comp::Texture &texture);
+
+    /// Gets the model-space bounds of the given mesh from `meshMap`, (re)computing them if the mesh data has changed.
+    const MeshBounds &MapMeshBounds(const comp::Mesh &mesh);
+
+    /// Gets the compiled version of `material` for `program` from `compiledMaterials`, compiling it if it is not there
+    /// yet - or if the material's data was edited since.
+    const gl3::CompiledMaterial &MapCompiledMaterial(const comp::Material &material, gl3::SharedProgram &program);
+
+    /// Applies all of a compiled material's parameters to the program it was compiled for.
     /// Loads and bits textures (via `MapGpuTexture()`) as necessary.
     /// Returns the number of textures bound.
     ///
-    /// WARNING: Assumes tha `pass.program` is bound!
-    unsigned ApplyMaterialParams(const comp::Material &material, gl3::SharedProgram &program);
+    /// WARNING: Assumes that the program is bound!
+    unsigned ApplyMaterialParams(const gl3::CompiledMaterial &material);
+
+    /// Removes all compiled materials that were not used this frame, if there are too many of them.
+    void CollectCompiledMaterials();
+
+    /// Groups all renderable entities in the ECS that are inside the view frustum into `batches`.
+    /// Fills in `stats` as it goes.
+    void GatherBatches(entt::registry &ecs, const glm::mat4 &viewProjectionMtx);
+
+    /// Maps the meshes of all `batches` to the GPU and sorts the batches into `renderQueue`,
+    /// by <program, textures, mesh, depth>.
+    void SortBatches(const gl3::SharedProgram &program);
+
+    /// Uploads the model matrices of all `batches` to `instanceBuffer`.
+    void UploadInstanceTransforms();
 };
 
 /// Called at every gfx reload
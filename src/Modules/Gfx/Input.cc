@@ -12,6 +12,7 @@ void GLFWMouseCallback(GLFWwindow *window, double xpos, double ypos);
 
 void InitInput(BoydGfxState *state)
 {
+    glfwSetWindowUserPointer(state->window, state);
     glfwSetKeyCallback(state->window, GLFWKeyCallback);
     glfwSetCursorPosCallback(state->window, GLFWMouseCallback);
 #ifdef DEBUG
@@ -93,6 +94,12 @@ void GLFWKeyCallback(GLFWwindow *window, int key, int scancode, int action, int
         BOYD_LOG(Info, "Ungrabbing...");
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     }
+
+    if(key == GLFW_KEY_F5 && action == GLFW_PRESS)
+    {
+        BOYD_LOG(Info, "Reloading shaders...");
+        static_cast<BoydGfxState *>(glfwGetWindowUserPointer(window))->ReloadPipeline();
+    }
 }
 
 void GLFWMouseCallback(GLFWwindow *window, double xpos, double ypos)
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace boyd
+{
+
+/// A list of drawcalls to be sorted by a 64-bit key, so that the ones that share GL state end up next to each other.
+///
+/// Key layout (most to least significant bits):
+///     [63..56] program | [55..36] texture set | [35..16] mesh | [15..0] depth (front to back)
+class RenderQueue
+{
+public:
+    struct Item
+    {
+        uint64_t key;
+        uint32_t index; ///< User data; usually an index into a drawcall array
+    };
+
+    static constexpr unsigned PROGRAM_BITS = 8;
+    static constexpr unsigned TEXTURE_SET_BITS = 20;
+    static constexpr unsigned MESH_BITS = 20;
+    static constexpr unsigned DEPTH_BITS = 16;
+
+    /// Packs a sort key. Ids that do not fit in their fields are wrapped around, which only makes sorting less optimal.
+    /// `depth` can be any float that increases with distance from the camera (e.g. clip-space Z).
+    static inline uint64_t MakeKey(uint32_t programId, uint32_t textureSetId, uint32_t meshId, float depth)
+    {
+        uint64_t key = uint64_t(programId & Mask(PROGRAM_BITS));
+        key = (key << TEXTURE_SET_BITS) | (textureSetId & Mask(TEXTURE_SET_BITS));
+        key = (key << MESH_BITS) | (meshId & Mask(MESH_BITS));
+        key = (key << DEPTH_BITS) | (SortableBits(depth) >> (32 - DEPTH_BITS));
+        return key;
+    }
+
+    inline void Clear()
+    {
+        items.clear();
+    }
+
+    inline void Push(uint64_t key, uint32_t index)
+    {
+        items.push_back({key, index});
+    }
+
+    /// Sorts the items by key (LSD radix sort, 8 bits at a time; stable).
+    void Sort()
+    {
+        scratch.resize(items.size());
+        for(unsigned shift = 0; shift < 64; shift += 8)
+        {
+            size_t counts[256] = {0};
+            for(const auto &item : items)
+            {
+                counts[(item.key >> shift) & 0xFF]++;
+            }
+            if(counts[(items.empty() ? 0 : items[0].key >> shift) & 0xFF] == items.size())
+            {
+                continue; // (All keys have the same digit; this pass would not change anything)
+            }
+
+            size_t offset = 0;
+            for(auto &count : counts)
+            {
+                size_t bucketSize = count;
+                count = offset;
+                offset += bucketSize;
+            }
+            for(const auto &item : items)
+            {
+                scratch[counts[(item.key >> shift) & 0xFF]++] = item;
+            }
+            std::swap(items, scratch);
+        }
+    }
+
+    inline const std::vector<Item> &Items() const
+    {
+        return items;
+    }
+
+private:
+    std::vector<Item> items;
+    std::vector<Item> scratch;
+
+    static constexpr uint64_t Mask(unsigned bits)
+    {
+        return (uint64_t(1) << bits) - 1;
+    }
+
+    /// Maps a float to an uint32 so that the ordering of floats is preserved in the ordering of the integers.
+    static inline uint32_t SortableBits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+};
+
+} // namespace boyd
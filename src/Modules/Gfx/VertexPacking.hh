@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+
+#include "../../Components/Mesh.hh"
+
+namespace boyd
+{
+
+/// Converts a float to a IEEE 754 half float (round to nearest even; overflows to infinity).
+inline uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t absBits = bits & 0x7FFFFFFFu;
+    if(absBits >= 0x7F800000u)
+    {
+        // Inf or NaN (keep NaNs NaNs)
+        return uint16_t(sign | 0x7C00u | (absBits > 0x7F800000u ? 0x200u : 0u));
+    }
+    if(absBits >= 0x477FF000u)
+    {
+        return uint16_t(sign | 0x7C00u); // (Too big; rounds to infinity)
+    }
+    if(absBits < 0x38800000u)
+    {
+        // Subnormal half (or zero): shift the mantissa, with the implicit 1, into place
+        if(absBits < 0x33000000u)
+        {
+            return uint16_t(sign); // (Too small; rounds to zero)
+        }
+        const uint32_t exponent = absBits >> 23;
+        const uint32_t mantissa = (absBits & 0x7FFFFFu) | 0x800000u;
+        const uint32_t shift = 126 - exponent;
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        half += (rest > halfway || (rest == halfway && (half & 1u))) ? 1u : 0u;
+        return uint16_t(sign | half);
+    }
+
+    // Normal half: rebias the exponent and round the mantissa
+    uint32_t half = ((absBits - 0x38000000u) >> 13);
+    const uint32_t rest = absBits & 0x1FFFu;
+    half += (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) ? 1u : 0u;
+    return uint16_t(sign | half);
+}
+
+/// Converts a IEEE 754 half float back to a float (exactly).
+inline float HalfToFloat(uint16_t half)
+{
+    const uint32_t sign = uint32_t(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1Fu;
+    uint32_t mantissa = half & 0x3FFu;
+
+    uint32_t bits;
+    if(exponent == 0x1F)
+    {
+        bits = sign | 0x7F800000u | (mantissa << 13); // Infinity/NaN
+    }
+    else if(exponent == 0)
+    {
+        if(mantissa == 0)
+        {
+            bits = sign; // Zero
+        }
+        else
+        {
+            // Subnormal half: normalize it (all subnormal halves are normal floats)
+            exponent = 127 - 15 + 1;
+            while(!(mantissa & 0x400u))
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+        }
+    }
+    else
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/// Encodes a unit vector with an octahedral mapping to 2 normalized shorts.
+/// (See: Cigolle et al., "A Survey of Efficient Representations for Independent Unit Vectors", JCGT 2014)
+inline void EncodeOctahedral(const glm::vec3 &normal, int16_t out[2])
+{
+    float l1Norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    glm::vec2 oct{0.0f, 0.0f};
+    if(l1Norm > 0.0f)
+    {
+        oct = glm::vec2{normal.x, normal.y} / l1Norm;
+        if(normal.z < 0.0f)
+        {
+            // Fold the lower hemisphere over the diagonals
+            glm::vec2 folded{(1.0f - std::abs(oct.y)) * (oct.x >= 0.0f ? 1.0f : -1.0f),
+                             (1.0f - std::abs(oct.x)) * (oct.y >= 0.0f ? 1.0f : -1.0f)};
+            oct = folded;
+        }
+    }
+    out[0] = int16_t(std::round(std::clamp(oct.x, -1.0f, 1.0f) * 32767.0f));
+    out[1] = int16_t(std::round(std::clamp(oct.y, -1.0f, 1.0f) * 32767.0f));
+}
+
+/// Returns the size of a vertex stored with the given layout, in bytes.
+inline size_t VertexStride(const comp::Mesh::Layout &layout)
+{
+    size_t stride = sizeof(glm::vec3); // position
+    stride += layout.normal == comp::Mesh::Layout::NormalOct16 ? 2 * sizeof(int16_t) : sizeof(glm::vec3);
+    stride += layout.tint == comp::Mesh::Layout::TintRGBA8 ? 4 * sizeof(uint8_t) : sizeof(glm::vec4);
+    stride += layout.texCoord == comp::Mesh::Layout::TexCoordFloat2 ? sizeof(glm::vec2) : 2 * sizeof(uint16_t);
+    return stride;
+}
+
+/// Byte offsets of each attribute inside a vertex stored with a certain layout.
+struct VertexOffsets
+{
+    size_t position, normal, tint, texCoord;
+
+    explicit VertexOffsets(const comp::Mesh::Layout &layout)
+    {
+        position = 0;
+        normal = position + sizeof(glm::vec3);
+        tint = normal + (layout.normal == comp::Mesh::Layout::NormalOct16 ? 2 * sizeof(int16_t) : sizeof(glm::vec3));
+        texCoord = tint + (layout.tint == comp::Mesh::Layout::TintRGBA8 ? 4 * sizeof(uint8_t) : sizeof(glm::vec4));
+    }
+};
+
+/// Packs `count` vertices from `vertices` into `out` (which must be at least `count * VertexStride(layout)` bytes)
+/// according to `layout`.
+inline void PackVertices(const comp::Mesh::Vertex *vertices, size_t count, const comp::Mesh::Layout &layout,
+                         uint8_t *out)
+{
+    if(layout == comp::Mesh::Layout::Full())
+    {
+        static_assert(sizeof(comp::Mesh::Vertex) == 12 * sizeof(float), "Vertex layout != Layout::Full()");
+        std::memcpy(out, vertices, count * sizeof(comp::Mesh::Vertex));
+        return;
+    }
+
+    const size_t stride = VertexStride(layout);
+    const VertexOffsets offsets{layout};
+    for(size_t i = 0; i < count; i++, out += stride)
+    {
+        const auto &vertex = vertices[i];
+
+        std::memcpy(out + offsets.position, &vertex.position, sizeof(glm::vec3));
+
+        if(layout.normal == comp::Mesh::Layout::NormalOct16)
+        {
+            int16_t oct[2];
+            EncodeOctahedral(vertex.normal, oct);
+            std::memcpy(out + offsets.normal, oct, sizeof(oct));
+        }
+        else
+        {
+            std::memcpy(out + offsets.normal, &vertex.normal, sizeof(glm::vec3));
+        }
+
+        if(layout.tint == comp::Mesh::Layout::TintRGBA8)
+        {
+            uint8_t *tint = out + offsets.tint;
+            for(int c = 0; c < 4; c++)
+            {
+                tint[c] = uint8_t(std::round(std::clamp(vertex.tint[c], 0.0f, 1.0f) * 255.0f));
+            }
+        }
+        else
+        {
+            std::memcpy(out + offsets.tint, &vertex.tint, sizeof(glm::vec4));
+        }
+
+        uint16_t texCoord[2];
+        switch(layout.texCoord)
+        {
+        case comp::Mesh::Layout::TexCoordHalf2:
+            texCoord[0] = FloatToHalf(vertex.texCoord.x);
+            texCoord[1] = FloatToHalf(vertex.texCoord.y);
+            std::memcpy(out + offsets.texCoord, texCoord, sizeof(texCoord));
+            break;
+        case comp::Mesh::Layout::TexCoordUnorm16:
+            texCoord[0] = uint16_t(std::round(std::clamp(vertex.texCoord.x, 0.0f, 1.0f) * 65535.0f));
+            texCoord[1] = uint16_t(std::round(std::clamp(vertex.texCoord.y, 0.0f, 1.0f) * 65535.0f));
+            std::memcpy(out + offsets.texCoord, texCoord, sizeof(texCoord));
+            break;
+        default: // comp::Mesh::Layout::TexCoordFloat2
+            std::memcpy(out + offsets.texCoord, &vertex.texCoord, sizeof(glm::vec2));
+            break;
+        }
+    }
+}
+
+/// Narrows `count` indices to 16 bits. All indices must be < 0xFFFF (the primitive restart index on WebGL 2)!
+inline void PackIndices16(const comp::Mesh::Index *indices, size_t count, uint16_t *out)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        out[i] = uint16_t(indices[i]);
+    }
+}
+
+} // namespace boyd
@@ -1,4 +1,7 @@
 #include "Loader.hh"
+#include "Scheduler.hh"
+
+#include <BoydEngine.hh>
 
 #include <thread>
 #include <utility>
@@ -37,22 +40,37 @@ static std::mutex lockUpdates;
 
 vector<Dll> modules;
 
-void RegisterModule(const string& moduleName, int priorityNo)
+void RegisterModule(const string& moduleName, int priorityNo, const ModuleAccess& access)
 {
-    modules.emplace_back(moduleName, priorityNo);
+    modules.emplace_back(moduleName, priorityNo, access);
     InsertionSortLast();
 }
 #endif
 
 
+static ModuleScheduler& GetScheduler()
+{
+#ifdef BOYD_PLATFORM_EMSCRIPTEN
+    // FIXME: Same as in the asset loader; no threads on Emscripten for now -> update all modules serially
+    static ModuleScheduler scheduler{0};
+#else
+    static ModuleScheduler scheduler{ThreadPool::DefaultSize(BOYD_WORKER_THREADS)};
+#endif
+    return scheduler;
+}
+
 void UpdateModules()
 {
 #ifdef BOYD_HOT_RELOADING
     // Avoid updating in case of a reload
     std::unique_lock<std::mutex> lockGuard(lockUpdates);
 #endif
+    static vector<BoydModule*> modulePtrs;
+    modulePtrs.clear();
     for(auto& module: modules)
-        module.Update();
+        modulePtrs.push_back(&module);
+
+    GetScheduler().Update(modulePtrs);
 }
 
 #ifdef BOYD_HOT_RELOADING
@@ -22,9 +22,11 @@ extern std::vector<Dll> modules;
 /// `moduleName` - the filename of the module without the lib/ prefix if any
 /// `priorityNo` - the order of which the module should be executed
 ///                during an update
-void RegisterModule(const string &moduleName, int priorityNo);
+/// `access` - the resources the module uses during an update (see `ModuleAccess`)
+void RegisterModule(const string &moduleName, int priorityNo, const ModuleAccess &access);
 
-#    define BOYD_MODULE(name, priority) RegisterModule(#    name, priority);
+#    define BOYD_MODULE(name, priority, reads, writes, mainThread) \
+        RegisterModule(#name, priority, ModuleAccess::Parse(reads, writes, mainThread));
 
 #else
 
@@ -33,20 +35,22 @@ void RegisterModule(const string &moduleName, int priorityNo);
 // declaration is here for use only in BOYD_MODULE macro.
 extern std::vector<BoydModule> modules;
 
-#    define BOYD_MODULE(name, priority)       \
-        modules.push_back({#name,             \
-                           BoydInit_##name,   \
-                           BoydUpdate_##name, \
-                           BoydHalt_##name,   \
-                           BoydInit_##name(), \
-                           priority});        \
-                                              \
+#    define BOYD_MODULE(name, priority, reads, writes, mainThread)                   \
+        modules.push_back({#name,                                                   \
+                           BoydInit_##name,                                         \
+                           BoydUpdate_##name,                                       \
+                           BoydHalt_##name,                                         \
+                           BoydInit_##name(),                                       \
+                           priority,                                                \
+                           ModuleAccess::Parse(reads, writes, mainThread)});        \
+                                                                                    \
         InsertionSortLast();
 
 #endif
 
 /// Call the modules' `Update` method. The order of the modules was
-/// given by the priority number in `RegisterModule`.
+/// given by the priority number in `RegisterModule`; modules whose
+/// `ModuleAccess`es do not conflict may be updated concurrently.
 void UpdateModules();
 
 #ifdef BOYD_HOT_RELOADING
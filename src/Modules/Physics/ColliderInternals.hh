@@ -47,6 +47,15 @@ struct BOYD_API ColliderInternals
     /// The handler of the proxy shape collider (called Proxy in rp3d, aka a fixture in other physics engines)
     rp3d::ProxyShape *proxyShape;
 
+    /// The transform of the body before the last physics step (see `UpdateTransform()`).
+    rp3d::Transform previousTransform;
+
+    /// Static bodies never move, so their transform is never synced back to the ECS.
+    bool isStatic;
+    /// Whether the transform in the ECS may lag behind the body's: true while it is awake, then until it is synced
+    /// once asleep.
+    bool isDirty{true};
+
     /// Initialize an internal.
     ColliderInternals(reactphysics3d::DynamicsWorld *world,
                       ColliderType &collider, boyd::comp::RigidBody &rigidBody,
@@ -60,6 +69,7 @@ struct BOYD_API ColliderInternals
         rigidBodyHandler = world->createRigidBody(localTransform);
 
         rp3d::BodyType bodyType = static_cast<rp3d::BodyType>(rigidBody.type);
+        isStatic = (bodyType == rp3d::BodyType::STATIC);
 
         rigidBodyHandler->setType(bodyType);
         if(bodyType == rp3d::BodyType::DYNAMIC)
@@ -76,6 +86,7 @@ struct BOYD_API ColliderInternals
 
         colliderHandler = GetCollider(collider);
         proxyShape = rigidBodyHandler->addCollisionShape(colliderHandler, localTransform, rigidBody.mass);
+        previousTransform = localTransform;
     }
 
     /// Empty internals are useless, and colliders should not be shared.
@@ -99,9 +110,35 @@ struct BOYD_API ColliderInternals
         rigidBodyHandler = nullptr;
     }
 
-    void UpdateTransform(boyd::comp::Transform &transform)
+    /// Returns true if the body may have moved since its transform was last written to the ECS.
+    bool NeedsSync() const
+    {
+        return !isStatic && (isDirty || !rigidBodyHandler->isSleeping());
+    }
+
+    /// Remembers the current transform of the body as the previous one; call it right before a physics step.
+    void SaveTransform()
+    {
+        previousTransform = rigidBodyHandler->getTransform();
+    }
+
+    /// Writes the transform of the body to `transform`, interpolated between the one before the last physics step
+    /// (`alpha` = 0) and the current one (`alpha` = 1) - so that it moves smoothly even if rendered more often than
+    /// physics is stepped.
+    /// Once the body is asleep, this writes its final transform and marks it clean - until it wakes up again.
+    void UpdateTransform(boyd::comp::Transform &transform, float alpha)
     {
-        rp3d::Transform temp = rigidBodyHandler->getTransform();
+        const rp3d::Transform &current = rigidBodyHandler->getTransform();
+        isDirty = !rigidBodyHandler->isSleeping();
+        if(!isDirty)
+        {
+            previousTransform = current; // (Snap to where it rests, and stay there while asleep)
+        }
+        rp3d::Transform temp = current;
+        if(previousTransform != current) // (Interpolating between the same transforms would not give exactly it back)
+        {
+            temp = rp3d::Transform::interpolateTransforms(previousTransform, current, alpha);
+        }
         temp.getOpenGLMatrix((float *)&transform.matrix);
     }
 };
@@ -7,9 +7,14 @@
 
 #include "ColliderInternals.hh"
 
+#include <BoydEngine.hh>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <entt/entt.hpp>
 #include <reactphysics3d.h>
+#include <utility>
+#include <vector>
 
 using namespace reactphysics3d;
 
@@ -21,17 +26,24 @@ struct BoydPhysicsState
 
     DynamicsWorld *world;
     entt::observer entt_Colliders[1];
-    float timeStep, timeDelta{0.0f};
-    std::chrono::time_point<std::chrono::system_clock> lastFrame;
+    float timeStep;
+    float accumulator{0.0f}; ///< Time that passed but was not stepped yet (less than a `timeStep` after an update)
+    std::chrono::steady_clock::time_point lastFrame;
+
+    /// The bodies that moved in the last update, and where to. Transforms are read by other modules - that may be
+    /// updated concurrently with this one -, so they are only written once all modules are done (see `Defer()`).
+    std::vector<std::pair<entt::entity, glm::mat4>> moved;
 
     BoydPhysicsState(entt::registry &registry)
     {
         world = new DynamicsWorld(rp3d::Vector3{0.0, 9.81, 0.0});
+        // (Not a component the engine knows of, so its pool is created here - see `ModuleScheduler`)
+        registry.reserve<comp::ColliderInternals<comp::BoxCollider>>(0);
         RegisterCollider<comp::BoxCollider>(registry, Collider::BOX_COLLIDER);
 
         /// TODO: Add the other colliders
-        timeStep = 1.0f / 60.0f;
-        lastFrame = std::chrono::system_clock::now();
+        timeStep = 1.0f / float(BOYD_PHYSICS_STEP_HZ);
+        lastFrame = std::chrono::steady_clock::now();
     }
 
     /// Register a collider into an observer.
@@ -40,24 +52,75 @@ struct BoydPhysicsState
     {
         entt_Colliders[type].connect(registry, entt::collector.group<comp::RigidBody, ColliderComponent>(
                                                    entt::exclude<comp::ColliderInternals<ColliderComponent>>));
+        // (Created now so that EnTT keeps it packed as bodies come and go, instead of sorting it all on first use -
+        // see `SyncTransforms()`)
+        registry.group<comp::ColliderInternals<ColliderComponent>>(entt::get<comp::Transform>);
     }
 
     ~BoydPhysicsState()
     {
         delete world;
     }
+
+    /// Writes the transforms of the bodies that moved in the last update to their Transforms.
+    void ApplyMoved(entt::registry &registry)
+    {
+        for(const auto &[entity, matrix] : moved)
+        {
+            if(registry.valid(entity) && registry.has<comp::Transform>(entity)) // (Could have been destroyed since)
+            {
+                // (Replaced, not edited in place, so that observers of Transform - e.g. the Audio module's - see it
+                // moved)
+                registry.replace<comp::Transform>(entity, matrix);
+            }
+        }
+        moved.clear();
+    }
 };
 
-/// Update the transform of a non-static rigid body.
+/// Remember the transforms of all bodies with the given collider as their previous ones, to interpolate from.
+template <typename ColliderType>
+void SaveTransforms(entt::registry &registry)
+{
+    using Internals = comp::ColliderInternals<ColliderType>;
+
+    registry.view<Internals>().each([](Internals &internals) {
+        // (Bodies that rest and are synced already have the same previous and current transforms)
+        if(internals.NeedsSync())
+        {
+            internals.SaveTransform();
+        }
+    });
+}
+
+/// Append the transforms of all the bodies with the given collider that moved to `moved`, interpolated by `alpha`
+/// between their last two physics steps.
 /// This method is templetized because we do not know which collider is used. Luckily it's only 4 of them ...
 template <typename ColliderType>
-void UpdateTransform(entt::entity entity, entt::registry &registry, comp::RigidBody &rigidBody, comp::Transform &transform)
+void SyncTransforms(entt::registry &registry, float alpha, std::vector<std::pair<entt::entity, glm::mat4>> &moved)
 {
     using Internals = comp::ColliderInternals<ColliderType>;
 
-    if(registry.has<Internals>(entity))
+    // The group owns the internals: those of the bodies with a Transform are packed at the front of their pool, lined
+    // up with the group's entities. Walk them alone: static and resting bodies - usually most of them - are skipped
+    // without even fetching their Transform, and no body is probed for one
+    auto group = registry.group<Internals>(entt::get<comp::Transform>);
+    const entt::entity *entities = group.data();
+    Internals *internals = group.template raw<Internals>();
+    for(size_t i = 0, n = group.size(); i < n; i++)
     {
-        registry.get<Internals>(entity).UpdateTransform(transform);
+        if(!internals[i].NeedsSync())
+        {
+            continue;
+        }
+        const auto &transform = group.template get<comp::Transform>(entities[i]);
+
+        comp::Transform synced = transform;
+        internals[i].UpdateTransform(synced, alpha);
+        if(synced.matrix != transform.matrix)
+        {
+            moved.emplace_back(entities[i], synced.matrix);
+        }
     }
 }
 
@@ -91,27 +154,41 @@ BOYD_API void BoydUpdate_Physics(void *state)
                                                                                rigidBody, transform);
     }
 
-    auto curFrame = chrono::system_clock::now();
-    physicsState->timeDelta += chrono::duration<float>{curFrame - physicsState->lastFrame}.count();
+    auto curFrame = chrono::steady_clock::now();
+    physicsState->accumulator += chrono::duration<float>{curFrame - physicsState->lastFrame}.count();
     physicsState->lastFrame = curFrame;
 
-    if(physicsState->timeDelta >= physicsState->timeStep)
+    // Step the simulation by fixed steps - so that it behaves the same at any framerate -, as many as fit in the time
+    // that passed (but at most BOYD_PHYSICS_MAX_STEPS, so that a slow frame doesn't make the next one even slower...)
+    const float timeStep = physicsState->timeStep;
+    const int nSteps = std::min(int(physicsState->accumulator / timeStep), int(BOYD_PHYSICS_MAX_STEPS));
+    for(int step = 0; step < nSteps; step++)
+    {
+        if(step == nSteps - 1)
+        {
+            // Transforms are interpolated from the ones before the last step
+            /// TODO: add the other colliders
+            SaveTransforms<comp::BoxCollider>(registry);
+        }
+        physicsState->world->update(timeStep);
+        physicsState->accumulator -= timeStep;
+    }
+    if(physicsState->accumulator >= timeStep)
     {
-        /// TODO: add the other colliders
-        physicsState->world->update(physicsState->timeDelta);
-        physicsState->timeDelta = 0.0f;
+        // (...and drop the time that it could not catch up with: the simulation slows down instead)
+        BOYD_LOG(Debug, "Physics: {} steps behind, dropping them", int(physicsState->accumulator / timeStep));
+        physicsState->accumulator = std::fmod(physicsState->accumulator, timeStep);
     }
+    const float alpha = physicsState->accumulator / timeStep;
 
     /// Copy the transforms
-    for(auto entity : rigidBodiesView)
+    /// TODO: add the other colliders
+    SyncTransforms<comp::BoxCollider>(registry, alpha, physicsState->moved);
+    if(!physicsState->moved.empty())
     {
-        auto &rigidBody = rigidBodiesView.get<comp::RigidBody>(entity);
-        auto &transform = rigidBodiesView.get<comp::Transform>(entity);
-
-        if(rigidBody.type != comp::RigidBody::STATIC)
-        {
-            UpdateTransform<comp::BoxCollider>(entity, registry, rigidBody, transform);
-        }
+        Boyd_GameState()->Defer([physicsState](entt::registry &registry) {
+            physicsState->ApplyMoved(registry);
+        });
     }
 }
 
@@ -0,0 +1,203 @@
+#include "Scheduler.hh"
+
+#include "../Components/AudioClip.hh"
+#include "../Components/AudioSource.hh"
+#include "../Components/BoxCollider.hh"
+#include "../Components/Camera.hh"
+#include "../Components/ComponentLoadRequest.hh"
+#include "../Components/Gltf.hh"
+#include "../Components/LuaBehaviour.hh"
+#include "../Components/Material.hh"
+#include "../Components/Mesh.hh"
+#include "../Components/Parent.hh"
+#include "../Components/RigidBody.hh"
+#include "../Components/Skybox.hh"
+#include "../Components/String.hh"
+#include "../Components/Transform.hh"
+#include "../Components/Voxels.hh"
+#include "../Core/GameState.hh"
+#include "../Debug/Log.hh"
+
+#include <string_view>
+#include <unordered_map>
+
+namespace boyd
+{
+
+ModuleScheduler::ModuleScheduler(unsigned nThreads)
+    : nodes{}, pending{}, mainQueue{}, remaining{0}, pool{nThreads}
+{
+    BOYD_LOG(Debug, "Module scheduler started with {} worker threads", pool.Size());
+}
+
+ModuleScheduler::~ModuleScheduler() = default;
+
+template <typename TComponent>
+static void PreparePool(entt::registry &registry)
+{
+    registry.reserve<TComponent>(0);
+}
+
+/// Creates the EnTT pools of all the components that a module accesses, as far as the engine knows of them.
+/// EnTT creates pools lazily - the first time a component type is used -, and doing so is not thread-safe: it must not
+/// happen while modules are updated concurrently. (Pools of components that are private to a module - e.g.
+/// "AudioInternals" - are created by the module itself, when it is initialized)
+static void PreparePools(entt::registry &registry, const std::vector<std::string> &names)
+{
+    static const std::unordered_map<std::string_view, void (*)(entt::registry &)> PREPARERS = {
+        {"AudioClip", PreparePool<comp::AudioClip>},
+        {"AudioSource", PreparePool<comp::AudioSource>},
+        {"BoxCollider", PreparePool<comp::BoxCollider>},
+        {"Camera", PreparePool<comp::Camera>},
+        {"ActiveCamera", PreparePool<comp::ActiveCamera>},
+        {"ComponentLoadRequest", PreparePool<comp::ComponentLoadRequest>},
+        {"Gltf", PreparePool<comp::Gltf>},
+        {"LuaBehaviour", PreparePool<comp::LuaBehaviour>},
+        {"Material", PreparePool<comp::Material>},
+        {"Mesh", PreparePool<comp::Mesh>},
+        {"Parent", PreparePool<comp::Parent>},
+        {"RigidBody", PreparePool<comp::RigidBody>},
+        {"Skybox", PreparePool<comp::Skybox>},
+        {"String", PreparePool<comp::String>},
+        {"Transform", PreparePool<comp::Transform>},
+        {"Voxels", PreparePool<comp::Voxels>},
+        {"VoxelsDirty", PreparePool<comp::VoxelsDirty>},
+    };
+
+    for(const auto &name : names)
+    {
+        auto it = PREPARERS.find(name);
+        if(it != PREPARERS.end())
+        {
+            it->second(registry);
+        }
+    }
+}
+
+void ModuleScheduler::Rebuild(const std::vector<BoydModule *> &modules)
+{
+    nodes.clear();
+    nodes.reserve(modules.size());
+    for(BoydModule *module : modules)
+    {
+        nodes.push_back({module, {}, 0});
+    }
+
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        for(size_t j = i + 1; j < nodes.size(); j++)
+        {
+            if(nodes[i].module->access.ConflictsWith(nodes[j].module->access))
+            {
+                nodes[i].successors.push_back(j);
+                nodes[j].nPredecessors++;
+            }
+        }
+        BOYD_LOG(Debug, "Module {} (priority {}): {} dependencies, {} dependants",
+                 nodes[i].module->modname, nodes[i].module->priority, nodes[i].nPredecessors, nodes[i].successors.size());
+    }
+
+    pending.reset(new std::atomic<unsigned>[nodes.size()]);
+
+    auto &registry = Boyd_GameState()->ecs;
+    for(const auto &node : nodes)
+    {
+        PreparePools(registry, node.module->access.reads);
+        PreparePools(registry, node.module->access.writes);
+    }
+}
+
+void ModuleScheduler::Update(const std::vector<BoydModule *> &modules)
+{
+    bool changed = modules.size() != nodes.size();
+    for(size_t i = 0; !changed && i < modules.size(); i++)
+    {
+        changed = modules[i] != nodes[i].module;
+    }
+    if(changed)
+    {
+        Rebuild(modules);
+    }
+
+    if(pool.Size() == 0)
+    {
+        for(auto &node : nodes)
+        {
+            node.module->Update();
+        }
+        Boyd_GameState()->RunDeferred();
+        return;
+    }
+
+    remaining = nodes.size();
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        pending[i] = nodes[i].nPredecessors;
+    }
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        if(nodes[i].nPredecessors == 0)
+        {
+            Dispatch(i);
+        }
+    }
+
+    // Update the main-thread modules as they become ready, until all modules were updated
+    std::unique_lock<std::mutex> lock{mutex};
+    while(remaining > 0)
+    {
+        if(!mainQueue.empty())
+        {
+            size_t iNode = mainQueue.front();
+            mainQueue.pop_front();
+
+            lock.unlock();
+            Run(iNode);
+            lock.lock();
+        }
+        else
+        {
+            condVar.wait(lock);
+        }
+    }
+    lock.unlock();
+
+    // Apply the changes that modules deferred, now that none of them is running
+    Boyd_GameState()->RunDeferred();
+}
+
+void ModuleScheduler::Dispatch(size_t iNode)
+{
+    if(nodes[iNode].module->access.mainThread)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        mainQueue.push_back(iNode);
+        condVar.notify_all();
+    }
+    else
+    {
+        pool.Submit([this, iNode]() {
+            Run(iNode);
+        });
+    }
+}
+
+void ModuleScheduler::Run(size_t iNode)
+{
+    nodes[iNode].module->Update();
+
+    for(size_t iSuccessor : nodes[iNode].successors)
+    {
+        if(--pending[iSuccessor] == 0)
+        {
+            Dispatch(iSuccessor);
+        }
+    }
+
+    // NOTE: Notify with the lock held, or `Update()` could return (and `this` be destroyed) before the notification
+    std::unique_lock<std::mutex> lock{mutex};
+    remaining--;
+    condVar.notify_all();
+}
+
+} // namespace boyd
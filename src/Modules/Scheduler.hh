@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../Core/ThreadPool.hh"
+#include "Dll.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace boyd
+{
+
+/// Updates modules concurrently, as long as their `ModuleAccess`es do not conflict.
+///
+/// The modules (sorted by priority) are arranged in a dependency graph where a module depends on all the modules with
+/// a lower priority number that it conflicts with; every frame, each module is updated on the thread pool as soon as
+/// all of its dependencies have been updated. Modules that conflict are thus still updated in priority order.
+/// Once all modules have been updated, the changes they deferred (see `GameState::Defer()`) are applied on the main
+/// thread.
+class ModuleScheduler
+{
+public:
+    /// Creates a scheduler that runs modules on `nThreads` worker threads (+ the main thread).
+    explicit ModuleScheduler(unsigned nThreads);
+    ~ModuleScheduler();
+
+    ModuleScheduler(const ModuleScheduler &toCopy) = delete;
+    ModuleScheduler &operator=(const ModuleScheduler &toCopy) = delete;
+
+    /// Updates all `modules` (sorted by priority) once, returning when all of them have been updated.
+    /// Must be called from the main thread.
+    void Update(const std::vector<BoydModule *> &modules);
+
+private:
+    struct Node
+    {
+        BoydModule *module;
+        std::vector<size_t> successors; ///< Modules that can only be updated after this one
+        unsigned nPredecessors;         ///< Number of modules that must be updated before this one
+    };
+
+    std::vector<Node> nodes;
+    std::unique_ptr<std::atomic<unsigned>[]> pending; ///< Per-node number of predecessors not yet updated this frame
+
+    std::deque<size_t> mainQueue; ///< Ready nodes that must run on the main thread
+    size_t remaining;             ///< Number of nodes not yet updated this frame
+    std::mutex mutex;             ///< Guards `mainQueue` and `remaining`
+    std::condition_variable condVar;
+
+    ThreadPool pool; // NOTE: Declared last so that workers are joined before the rest is destroyed
+
+    /// Rebuilds the dependency graph for the given modules, and creates the pools of the components they access.
+    void Rebuild(const std::vector<BoydModule *> &modules);
+
+    /// Sends a node that is ready to be updated either to the thread pool or to the main thread.
+    void Dispatch(size_t iNode);
+
+    /// Updates the node's module, then dispatches all of its successors that are now ready.
+    void Run(size_t iNode);
+};
+
+} // namespace boyd
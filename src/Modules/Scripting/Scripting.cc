@@ -3,6 +3,7 @@
 #include "../../Components/ComponentLoadRequest.hh"
 #include "../../Components/Gltf.hh"
 #include "../../Components/LuaBehaviour.hh"
+#include "../../Components/Skybox.hh"
 #include "../../Components/Transform.hh"
 #include "../../Core/GameState.hh"
 #include "../../Core/Platform.hh"
@@ -160,6 +161,12 @@ BOYD_API void *BoydInit_Scripting()
     };
     registry.assign<boyd::comp::ComponentLoadRequest>(testCube, std::move(cubeReq));
 
+    auto sky = registry.create();
+    boyd::comp::ComponentLoadRequest skyReq{
+        {boyd::comp::ComponentLoadRequest::TypeOf<boyd::comp::Skybox>(), "assets/Textures/dresden_square.hdr"},
+    };
+    registry.assign<boyd::comp::ComponentLoadRequest>(sky, std::move(skyReq));
+
     return state;
 }
 